@@ -1,4 +1,13 @@
 #include "Compiler.h"
+#include "ir/IRBuilder.h"
+#include "ir/IRPass.h"
+#include "ir/SparseConditionalConstantPropagation.h"
+#include "ir/LocalValueNumbering.h"
+#include "ir/IRDeadCodeElimination.h"
+#include "ir/BytecodeEmitter.h"
+#include "codegen/BytecodeOptimizer.h"
+#include "vm/PartialEvaluator.h"
+#include <chrono>
 #include <sstream>
 #include <iomanip>
 
@@ -34,56 +43,177 @@ std::string CompilationResult::toJSON() const {
         oss << "  \"error\": \"" << escapeJSON(errorMessage) << "\",\n";
     }
     
-    oss << "  \"tokens\": " << tokensJSON << ",\n";
-    oss << "  \"ast\": " << astJSON << ",\n";
+    // Left out unless CompilerOptions::includeSyntax asked for them
+    if (!tokensJSON.empty()) {
+        oss << "  \"tokens\": " << tokensJSON << ",\n";
+    }
+    if (!astJSON.empty()) {
+        oss << "  \"ast\": " << astJSON << ",\n";
+    }
     oss << "  \"semantic\": \"" << escapeJSON(semanticReport) << "\",\n";
     oss << "  \"optimization\": \"" << escapeJSON(optimizationReport) << "\",\n";
-    oss << "  \"bytecode\": " << bytecodeJSON << ",\n";
+    oss << "  \"ir\": \"" << escapeJSON(irText) << "\",\n";
+    oss << "  \"bytecode\": " << (bytecodeJSON.empty() ? "[]" : bytecodeJSON) << ",\n";
     oss << "  \"bytecodeText\": \"" << escapeJSON(bytecodeText) << "\",\n";
-    oss << "  \"output\": \"" << escapeJSON(executionOutput) << "\"\n";
+    oss << "  \"output\": \"" << escapeJSON(executionOutput) << "\",\n";
+    oss << "  \"executedInstructions\": " << executedInstructions << ",\n";
+    oss << "  \"optimizationLevel\": " << optimizationLevel << "\n";
     oss << "}";
     
     return oss.str();
 }
 
-CompilationResult Compiler::compile(const std::string& source) {
-    result = CompilationResult();
-    result.success = true;
+static std::string tokensToJSON(const std::vector<Token>& tokens) {
+    std::ostringstream oss;
+    oss << "[\n";
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        oss << "  {\"type\": \"" << tokens[i].getTypeName() 
+           << "\", \"lexeme\": \"" << tokens[i].lexeme 
+           << "\", \"line\": " << tokens[i].line 
+           << ", \"column\": " << tokens[i].column << "}";
+        if (i < tokens.size() - 1) oss << ",";
+        oss << "\n";
+    }
+    oss << "]";
+    return oss.str();
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Stage 4: the AST passes of the optimization level (none at level 0)
+static std::unique_ptr<Program> optimizeProgram(std::unique_ptr<Program> program, int level,
+                                                const Profile* profile,
+                                                std::string* report = nullptr) {
+    if (level <= 0) {
+        if (report) {
+            *report += "Optimization level 0: optimizer skipped\n";
+        }
+        return program;
+    }
     
-    try {
-        // Stage 1: Lexical Analysis
-        Lexer lexer(source);
-        auto tokens = lexer.tokenize();
-        
-        std::ostringstream tokensOss;
-        tokensOss << "[\n";
-        for (size_t i = 0; i < tokens.size(); ++i) {
-            tokensOss << "  {\"type\": \"" << tokens[i].getTypeName() 
-                     << "\", \"lexeme\": \"" << tokens[i].lexeme 
-                     << "\", \"line\": " << tokens[i].line 
-                     << ", \"column\": " << tokens[i].column << "}";
-            if (i < tokens.size() - 1) tokensOss << ",";
-            tokensOss << "\n";
-        }
-        tokensOss << "]";
-        result.tokensJSON = tokensOss.str();
-        
-        // Stage 2: Syntax Analysis
-        Parser parser(tokens);
-        auto program = parser.parse();
+    Optimizer optimizer(level, profile);
+    program = optimizer.optimize(std::move(program));
+    if (report) {
+        *report += "Optimization level " + std::to_string(level) + "\n" +
+                   optimizer.getOptimizationReport();
+    }
+    return program;
+}
+
+// Stage 5: lowers the optimized program to SSA form (laid out by profile,
+// if any), runs the IR passes, emits bytecode from the result and runs
+// the peephole optimizer over it; level 0 skips the IR passes and the
+// peephole optimizer. Local value numbering may add up to maxTemporaries
+// frame slots. The IR pass log and the statistics of both are appended to
+// report, the final IR is stored in irText and the bytecode before the
+// peephole optimizer in unoptimized, unless the peephole optimizer changed
+// nothing.
+static Bytecode generateBytecode(Program& program, int level, const Profile* profile,
+                                 int maxTemporaries,
+                                 std::string* report = nullptr,
+                                 std::string* irText = nullptr,
+                                 Bytecode* unoptimized = nullptr) {
+    IRBuilder builder(profile);
+    IRFunction function = builder.build(program);
+    if (report && builder.getHotThenBranches() > 0) {
+        *report += "Profile-guided layout: " + std::to_string(builder.getHotThenBranches()) +
+                   " if statements laid out with their hot then branch last\n";
+    }
+    
+    if (level > 0) {
+        IRPassManager passManager;
+        passManager.addPass(std::make_unique<SparseConditionalConstantPropagation>());
+        if (level >= 2) {
+            passManager.addPass(std::make_unique<LocalValueNumbering>(maxTemporaries));
+        }
+        passManager.addPass(std::make_unique<IRDeadCodeElimination>());
+        std::vector<std::string> log;
+        passManager.run(function, log);
         
-        if (parser.hasErrors()) {
-            result.success = false;
-            std::ostringstream errOss;
-            for (const auto& err : parser.getErrors()) {
-                errOss << err << "\\n";
+        if (report) {
+            std::ostringstream oss;
+            oss << "IR passes (" << passManager.getRounds() << " rounds, "
+                << function.instructionCount() << " instructions left):\n";
+            for (const auto& line : log) {
+                oss << "  - " << line << "\n";
             }
-            result.errorMessage = errOss.str();
-            result.astJSON = "{}";
-            return result;
+            for (const auto& stats : passManager.getStatistics()) {
+                oss << "  - " << stats.name << ": " << stats.runs << " runs, "
+                    << stats.rewrites << " rewrites, " << std::fixed << std::setprecision(3)
+                    << stats.milliseconds << " ms\n";
+            }
+            *report += oss.str();
+        }
+    }
+    if (irText) {
+        *irText = function.toString();
+    }
+    
+    BytecodeEmitter emitter;
+    Bytecode bytecode = emitter.emit(function);
+    if (report && emitter.getWebCount() > 0) {
+        *report += "Frame slot coloring: " + std::to_string(emitter.getWebCount()) +
+                   " webs of stored values in " + std::to_string(bytecode.getFrameSize()) + " slots\n";
+    }
+    if (level <= 0) {
+        return bytecode;
+    }
+    Bytecode emitted;
+    if (unoptimized) {
+        emitted = bytecode;
+    }
+    
+    size_t before = bytecode.getInstructions().size();
+    auto start = std::chrono::steady_clock::now();
+    BytecodeOptimizer peephole;
+    if (peephole.optimize(bytecode) > 0 && unoptimized) {
+        *unoptimized = std::move(emitted);
+    }
+    double milliseconds = millisecondsSince(start);
+    
+    if (report) {
+        std::ostringstream oss;
+        oss << "Bytecode peephole (" << peephole.getRounds() << " rounds, " << before
+            << " -> " << bytecode.getInstructions().size() << " instructions, "
+            << std::fixed << std::setprecision(3) << milliseconds << " ms):\n";
+        for (const auto& stats : peephole.getStatistics()) {
+            if (stats.rewrites > 0) {
+                oss << "  - " << stats.name << ": " << stats.rewrites << "\n";
+            }
+        }
+        *report += oss.str();
+    }
+    return bytecode;
+}
+
+void Compiler::reportParseErrors(const std::vector<std::string>& errors) {
+    result.success = false;
+    std::ostringstream errOss;
+    for (const auto& err : errors) {
+        errOss << err << "\\n";
+    }
+    result.errorMessage = errOss.str();
+    if (options.includeSyntax) {
+        result.astJSON = "{}";
+    }
+}
+
+std::unique_ptr<Program> Compiler::compileProgram(std::unique_ptr<Program> program, bool run) {
+    int level = options.instrument ? 0 : options.optimizationLevel;
+    const Profile* profile = options.instrument ? nullptr : options.profile.get();
+    result.optimizationLevel = level;
+    Bytecode bytecode;
+    Bytecode unoptimized;
+    PartialEvaluator evaluator(options.evaluationInstructions, options.evaluationMemory);
+    bool evaluated = false;
+    
+    try {
+        if (options.includeSyntax) {
+            result.astJSON = program->toJSON();
         }
-        
-        result.astJSON = program->toJSON();
         
         // Stage 3: Semantic Analysis
         SemanticAnalyzer analyzer;
@@ -93,83 +223,187 @@ CompilationResult Compiler::compile(const std::string& source) {
         if (analyzer.hasErrors()) {
             result.success = false;
             result.errorMessage = result.semanticReport;
-            return result;
+            return program;
         }
         
         // Stage 4: Optimization
-        Optimizer optimizer;
-        program = optimizer.optimize(std::move(program));
-        result.optimizationReport = optimizer.getOptimizationReport();
+        if (profile) {
+            result.optimizationReport = "Using a profile of " + std::to_string(profile->size()) +
+                                        " if and for statements\n";
+        }
+        program = optimizeProgram(std::move(program), level, profile, &result.optimizationReport);
         
         // Stage 5: Code Generation
-        CodeGenerator codegen;
-        Bytecode bytecode = codegen.generate(*program);
+        bytecode = generateBytecode(*program, level, profile, options.maxTemporaries,
+                                    &result.optimizationReport, &result.irText,
+                                    options.measurePeephole ? &unoptimized : nullptr);
+        if (options.instrument) {
+            result.optimizationReport += "Instrumented build: " +
+                std::to_string(bytecode.getProbes().size()) + " branch probes\n";
+        }
+        
+        // Stage 5b: Partial evaluation, which runs the program once
+        // and keeps only what it prints if it halts within its fuel
+        if (level >= 3) {
+            auto start = std::chrono::steady_clock::now();
+            evaluated = evaluator.evaluate(bytecode);
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(3) << millisecondsSince(start);
+            result.optimizationReport += evaluator.getReport() + "Partial evaluation took " +
+                                         oss.str() + " ms\n";
+        }
         result.bytecodeJSON = bytecode.toJSON();
         result.bytecodeText = bytecode.toString();
         
     } catch (const std::exception& e) {
         result.success = false;
         result.errorMessage = std::string("Compilation error: ") + e.what();
+        return program;
     }
     
-    return result;
-}
-
-CompilationResult Compiler::compileAndRun(const std::string& source) {
-    result = compile(source);
-    
-    if (!result.success) {
-        return result;
+    if (!run) {
+        return program;
     }
     
     try {
         // Stage 6: Execution
-        // Recompile to get bytecode
-        Lexer lexer(source);
-        auto tokens = lexer.tokenize();
-        Parser parser(tokens);
-        auto program = parser.parse();
-        SemanticAnalyzer analyzer;
-        analyzer.analyze(*program);
-        Optimizer optimizer;
-        program = optimizer.optimize(std::move(program));
-        CodeGenerator codegen;
-        Bytecode bytecode = codegen.generate(*program);
-        
         VirtualMachine vm;
+        vm.setProfiling(options.instrument);
         vm.execute(bytecode);
         result.executionOutput = vm.getOutputString();
+        result.executedInstructions = vm.getExecutedInstructions();
+        if (options.instrument) {
+            result.profile.addRun(bytecode, vm.getInstructionCounts(), vm.getJumpCounts());
+        }
+        
+        // The peephole optimizer cannot tell how often its rewrites run, so
+        // on request the bytecode it started from is run again for the
+        // comparison
+        long long compiled = evaluated ? evaluator.getExecutedInstructions()
+                                       : result.executedInstructions;
+        long long before = compiled;
+        if (!unoptimized.getInstructions().empty()) {
+            VirtualMachine baseline;
+            baseline.execute(unoptimized);
+            before = baseline.getExecutedInstructions();
+        }
+        if (level > 0 && options.measurePeephole) {
+            result.optimizationReport += "Bytecode peephole: " + std::to_string(before) + " -> " +
+                std::to_string(compiled) + " instructions executed\n";
+        }
+        if (evaluated) {
+            result.optimizationReport += "Partial evaluation: " + std::to_string(compiled) +
+                " -> " + std::to_string(result.executedInstructions) + " instructions executed\n";
+        }
         
     } catch (const std::exception& e) {
         result.success = false;
         result.errorMessage = std::string("Execution error: ") + e.what();
     }
+    return program;
+}
+
+CompilationResult Compiler::compileSource(const std::string& source, bool run) {
+    result = CompilationResult();
+    result.success = true;
+    
+    std::unique_ptr<Program> program;
+    try {
+        // Stage 1: Lexical Analysis
+        Lexer lexer(source);
+        auto tokens = lexer.tokenize();
+        if (options.includeSyntax) {
+            result.tokensJSON = tokensToJSON(tokens);
+        }
+        
+        // Stage 2: Syntax Analysis
+        Parser parser(tokens, lexer.getSymbols());
+        program = parser.parse();
+        
+        if (parser.hasErrors()) {
+            reportParseErrors(parser.getErrors());
+            return result;
+        }
+    } catch (const std::exception& e) {
+        result.success = false;
+        result.errorMessage = std::string("Compilation error: ") + e.what();
+        return result;
+    }
     
+    compileProgram(std::move(program), run);
     return result;
 }
 
-std::string Compiler::tokenize(const std::string& source) {
-    Lexer lexer(source);
-    auto tokens = lexer.tokenize();
+CompilationResult Compiler::compile(const std::string& source) {
+    return compileSource(source, false);
+}
+
+CompilationResult Compiler::compileAndRun(const std::string& source) {
+    return compileSource(source, true);
+}
+
+CompilationResult Compiler::compileAndRun(IncrementalParser& session) {
+    result = CompilationResult();
+    result.success = true;
+    if (options.includeSyntax) {
+        result.tokensJSON = tokensToJSON(session.getTokens());
+    }
     
-    std::ostringstream oss;
-    oss << "[\n";
-    for (size_t i = 0; i < tokens.size(); ++i) {
-        oss << "  {\"type\": \"" << tokens[i].getTypeName() 
-           << "\", \"lexeme\": \"" << tokens[i].lexeme 
-           << "\", \"line\": " << tokens[i].line 
-           << ", \"column\": " << tokens[i].column << "}";
-        if (i < tokens.size() - 1) oss << ",";
-        oss << "\n";
+    if (session.hasErrors()) {
+        reportParseErrors(session.getErrors());
+        return result;
     }
-    oss << "]";
-    return oss.str();
+    
+    if (options.instrument || options.optimizationLevel <= 0) {
+        // Without AST passes the tree keeps its shape, so the session's
+        // own tree is compiled instead of a copy
+        auto program = compileProgram(session.releaseProgram(), true);
+        if (program) {
+            session.restoreProgram(std::move(program));
+        } else {
+            session.reset(session.getSource());
+        }
+    } else {
+        // The AST passes rewrite the tree; the session must keep its own copy
+        compileProgram(session.getProgram().clone(), true);
+    }
+    return result;
+}
+
+CompilationResult Compiler::compileEdit(IncrementalParser& session, size_t offset,
+                                        size_t removedLength, const std::string& insertedText) {
+    if (!session.applyEdit(offset, removedLength, insertedText)) {
+        result = CompilationResult();
+        result.success = false;
+        result.errorMessage = "Edit does not match the session source";
+        return result;
+    }
+    
+    return compileAndRun(session);
+}
+
+CompilationResult Compiler::describeSyntax(const IncrementalParser& session) {
+    result = CompilationResult();
+    result.success = true;
+    result.tokensJSON = tokensToJSON(session.getTokens());
+    if (session.hasErrors()) {
+        reportParseErrors(session.getErrors());
+        result.astJSON = "{}";
+    } else {
+        result.astJSON = session.getProgram().toJSON();
+    }
+    return result;
+}
+
+std::string Compiler::tokenize(const std::string& source) {
+    Lexer lexer(source);
+    return tokensToJSON(lexer.tokenize());
 }
 
 std::string Compiler::parse(const std::string& source) {
     Lexer lexer(source);
     auto tokens = lexer.tokenize();
-    Parser parser(tokens);
+    Parser parser(tokens, lexer.getSymbols());
     auto program = parser.parse();
     return program->toJSON();
 }
@@ -177,7 +411,7 @@ std::string Compiler::parse(const std::string& source) {
 std::string Compiler::analyze(const std::string& source) {
     Lexer lexer(source);
     auto tokens = lexer.tokenize();
-    Parser parser(tokens);
+    Parser parser(tokens, lexer.getSymbols());
     auto program = parser.parse();
     SemanticAnalyzer analyzer;
     analyzer.analyze(*program);
@@ -187,40 +421,39 @@ std::string Compiler::analyze(const std::string& source) {
 std::string Compiler::optimize(const std::string& source) {
     Lexer lexer(source);
     auto tokens = lexer.tokenize();
-    Parser parser(tokens);
+    Parser parser(tokens, lexer.getSymbols());
     auto program = parser.parse();
     SemanticAnalyzer analyzer;
     analyzer.analyze(*program);
-    Optimizer optimizer;
-    program = optimizer.optimize(std::move(program));
-    return optimizer.getOptimizationReport();
+    std::string report;
+    program = optimizeProgram(std::move(program), options.optimizationLevel, options.profile.get(),
+                              &report);
+    return report;
 }
 
 std::string Compiler::generateCode(const std::string& source) {
     Lexer lexer(source);
     auto tokens = lexer.tokenize();
-    Parser parser(tokens);
+    Parser parser(tokens, lexer.getSymbols());
     auto program = parser.parse();
     SemanticAnalyzer analyzer;
     analyzer.analyze(*program);
-    Optimizer optimizer;
-    program = optimizer.optimize(std::move(program));
-    CodeGenerator codegen;
-    Bytecode bytecode = codegen.generate(*program);
+    program = optimizeProgram(std::move(program), options.optimizationLevel, options.profile.get());
+    Bytecode bytecode = generateBytecode(*program, options.optimizationLevel, options.profile.get(),
+                                         options.maxTemporaries);
     return bytecode.toString();
 }
 
 std::string Compiler::execute(const std::string& source) {
     Lexer lexer(source);
     auto tokens = lexer.tokenize();
-    Parser parser(tokens);
+    Parser parser(tokens, lexer.getSymbols());
     auto program = parser.parse();
     SemanticAnalyzer analyzer;
     analyzer.analyze(*program);
-    Optimizer optimizer;
-    program = optimizer.optimize(std::move(program));
-    CodeGenerator codegen;
-    Bytecode bytecode = codegen.generate(*program);
+    program = optimizeProgram(std::move(program), options.optimizationLevel, options.profile.get());
+    Bytecode bytecode = generateBytecode(*program, options.optimizationLevel, options.profile.get(),
+                                         options.maxTemporaries);
     VirtualMachine vm;
     vm.execute(bytecode);
     return vm.getOutputString();
@@ -5,10 +5,50 @@
 #include <memory>
 #include "lexer/Lexer.h"
 #include "parser/Parser.h"
+#include "parser/IncrementalParser.h"
 #include "semantic/SemanticAnalyzer.h"
 #include "optimizer/Optimizer.h"
-#include "codegen/CodeGenerator.h"
+#include "codegen/Bytecode.h"
+#include "ir/IR.h"
 #include "vm/VirtualMachine.h"
+#include "vm/Profile.h"
+
+// Choices that trade compile time for run time
+struct CompilerOptions {
+    // 0: no optimization; the program is lowered to IR and emitted as is
+    // 1: constant propagation and folding and dead code elimination on
+    //    the AST and the IR, and the bytecode peephole optimizer
+    // 2: also scalar evolution, strength reduction, dead store
+    //    elimination, loop-invariant code motion and local value numbering
+    // 3: also loop unrolling and partial evaluation
+    int optimizationLevel = 2;
+    
+    // Frame slots local value numbering may add to keep reused values
+    // (level 2 and up); every slot is a STORE and LOADs at run time
+    int maxTemporaries = 16;
+    
+    // Fuel of partial evaluation (level 3): the instructions and the bytes
+    // of frame, stack and output the program may use at compile time
+    long long evaluationInstructions = 1000000;
+    size_t evaluationMemory = 64 * 1024;
+    
+    // Run the bytecode from before the peephole optimizer as well, to
+    // report the instructions its rewrites save at run time
+    bool measurePeephole = false;
+    
+    // Fill in CompilationResult::tokensJSON and astJSON, which serialize
+    // the whole source; an editor that is not showing them can skip both
+    bool includeSyntax = true;
+    
+    // Counts of earlier runs of the same source, which lay out if
+    // statements so that their hot branch falls through and pick the
+    // loops worth unrolling (hot loops are unrolled from level 2 on)
+    std::shared_ptr<const Profile> profile;
+    
+    // Build an instrumented program instead: level 0, with a BranchProbe
+    // for every if and for, whose run fills in CompilationResult::profile
+    bool instrument = false;
+};
 
 struct CompilationResult {
     bool success;
@@ -19,24 +59,48 @@ struct CompilationResult {
     std::string astJSON;
     std::string semanticReport;
     std::string optimizationReport;
+    std::string irText;           // SSA form the bytecode was emitted from
     std::string bytecodeJSON;
     std::string bytecodeText;
     std::string executionOutput;
+    long long executedInstructions = 0; // Dynamic instruction count of the run
+    int optimizationLevel = 0;
+    Profile profile; // Counts of the run of an instrumented build
     
     std::string toJSON() const;
 };
 
 class Compiler {
 private:
+    CompilerOptions options;
     std::string sourceCode;
     CompilationResult result;
     
+    CompilationResult compileSource(const std::string& source, bool run);
+    void reportParseErrors(const std::vector<std::string>& errors);
+    // Stages 3-6 on a parsed program; fills in result and returns the
+    // program as the optimizer left it
+    std::unique_ptr<Program> compileProgram(std::unique_ptr<Program> program, bool run);
+    
 public:
-    Compiler() = default;
+    explicit Compiler(const CompilerOptions& compilerOptions = CompilerOptions())
+        : options(compilerOptions) {}
+    
+    const CompilerOptions& getOptions() const { return options; }
     
     CompilationResult compile(const std::string& source);
     CompilationResult compileAndRun(const std::string& source);
     
+    // Edit-based compilation for editors. The session keeps tokens and AST
+    // between calls; compileEdit applies one text edit to it, which re-lexes
+    // and re-parses only the affected top-level statements, then compiles
+    // and runs the updated program like compileAndRun.
+    CompilationResult compileAndRun(IncrementalParser& session);
+    CompilationResult compileEdit(IncrementalParser& session, size_t offset,
+                                  size_t removedLength, const std::string& insertedText);
+    // Tokens and AST of the session's current source, without compiling it
+    CompilationResult describeSyntax(const IncrementalParser& session);
+    
     // Individual stage access for step-by-step visualization
     std::string tokenize(const std::string& source);
     std::string parse(const std::string& source);
@@ -10,6 +10,10 @@ void NumberExpression::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Expression> NumberExpression::clone() const {
+    return std::make_unique<NumberExpression>(value);
+}
+
 std::string NumberExpression::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -24,6 +28,12 @@ void VariableExpression::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Expression> VariableExpression::clone() const {
+    auto copy = std::make_unique<VariableExpression>(name, symbol);
+    copy->slot = slot;
+    return copy;
+}
+
 std::string VariableExpression::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -34,15 +44,36 @@ std::string VariableExpression::toJSON(int indent) const {
 }
 
 // BinaryExpression
+BinaryExpression::~BinaryExpression() {
+    // Release operand chains iteratively so that destroying a very long or
+    // deeply nested expression does not recurse once per level
+    std::vector<std::unique_ptr<Expression>> pending;
+    pending.push_back(std::move(left));
+    pending.push_back(std::move(right));
+    
+    while (!pending.empty()) {
+        std::unique_ptr<Expression> expr = std::move(pending.back());
+        pending.pop_back();
+        if (auto* binary = dynamic_cast<BinaryExpression*>(expr.get())) {
+            if (binary->left) pending.push_back(std::move(binary->left));
+            if (binary->right) pending.push_back(std::move(binary->right));
+        }
+    }
+}
+
 void BinaryExpression::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Expression> BinaryExpression::clone() const {
+    return std::make_unique<BinaryExpression>(op, left->clone(), right->clone());
+}
+
 std::string BinaryExpression::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
     oss << indent_str(indent + 1) << "\"type\": \"BinaryExpression\",\n";
-    oss << indent_str(indent + 1) << "\"operator\": \"" << op << "\",\n";
+    oss << indent_str(indent + 1) << "\"operator\": \"" << binaryOpSymbol(op) << "\",\n";
     oss << indent_str(indent + 1) << "\"left\": \n" << left->toJSON(indent + 1) << ",\n";
     oss << indent_str(indent + 1) << "\"right\": \n" << right->toJSON(indent + 1) << "\n";
     oss << indent_str(indent) << "}";
@@ -54,6 +85,12 @@ void VariableDeclaration::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Statement> VariableDeclaration::clone() const {
+    auto copy = std::make_unique<VariableDeclaration>(name, initializer->clone(), symbol);
+    copy->slot = slot;
+    return copy;
+}
+
 std::string VariableDeclaration::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -69,6 +106,10 @@ void PrintStatement::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Statement> PrintStatement::clone() const {
+    return std::make_unique<PrintStatement>(expression->clone());
+}
+
 std::string PrintStatement::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -83,6 +124,15 @@ void BlockStatement::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Statement> BlockStatement::clone() const {
+    auto copy = std::make_unique<BlockStatement>();
+    copy->statements.reserve(statements.size());
+    for (const auto& stmt : statements) {
+        copy->statements.push_back(stmt->clone());
+    }
+    return copy;
+}
+
 std::string BlockStatement::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -105,6 +155,13 @@ void IfStatement::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Statement> IfStatement::clone() const {
+    auto copy = std::make_unique<IfStatement>(condition->clone(), thenBranch->clone(),
+                                              elseBranch ? elseBranch->clone() : nullptr);
+    copy->location = location;
+    return copy;
+}
+
 std::string IfStatement::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -125,6 +182,14 @@ void ForStatement::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Statement> ForStatement::clone() const {
+    auto copy = std::make_unique<ForStatement>(variable, start->clone(), end->clone(),
+                                               body->clone(), symbol);
+    copy->slot = slot;
+    copy->location = location;
+    return copy;
+}
+
 std::string ForStatement::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -142,6 +207,17 @@ void Program::accept(ASTVisitor& visitor) {
     visitor.visit(*this);
 }
 
+std::unique_ptr<Program> Program::clone() const {
+    auto copy = std::make_unique<Program>();
+    copy->statements.reserve(statements.size());
+    for (const auto& stmt : statements) {
+        copy->statements.push_back(stmt->clone());
+    }
+    copy->symbols = symbols;
+    copy->frameSize = frameSize;
+    return copy;
+}
+
 std::string Program::toJSON(int indent) const {
     std::ostringstream oss;
     oss << indent_str(indent) << "{\n";
@@ -4,6 +4,9 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include "../lexer/Symbol.h"
+#include "BinaryOp.h"
+#include "SourceLocation.h"
 
 // Forward declarations
 class ASTVisitor;
@@ -20,6 +23,7 @@ public:
 class Expression : public ASTNode {
 public:
     virtual ~Expression() = default;
+    virtual std::unique_ptr<Expression> clone() const = 0;
 };
 
 class NumberExpression : public Expression {
@@ -29,48 +33,60 @@ public:
     NumberExpression(int val) : value(val) {}
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Expression> clone() const override;
 };
 
 class VariableExpression : public Expression {
 public:
     std::string name;
+    SymbolId symbol;
+    int slot; // Frame slot, resolved by semantic analysis (-1 before)
     
-    VariableExpression(const std::string& n) : name(n) {}
+    VariableExpression(const std::string& n, SymbolId sym = INVALID_SYMBOL)
+        : name(n), symbol(sym), slot(-1) {}
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Expression> clone() const override;
 };
 
 class BinaryExpression : public Expression {
 public:
-    std::string op;
+    BinaryOp op;
     std::unique_ptr<Expression> left;
     std::unique_ptr<Expression> right;
     
-    BinaryExpression(const std::string& operation, 
+    BinaryExpression(BinaryOp operation, 
                      std::unique_ptr<Expression> l, 
                      std::unique_ptr<Expression> r)
         : op(operation), left(std::move(l)), right(std::move(r)) {}
+    ~BinaryExpression() override;
     
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Expression> clone() const override;
 };
 
 // Statement Nodes
 class Statement : public ASTNode {
 public:
     virtual ~Statement() = default;
+    virtual std::unique_ptr<Statement> clone() const = 0;
 };
 
 class VariableDeclaration : public Statement {
 public:
     std::string name;
+    SymbolId symbol;
+    int slot; // Frame slot, resolved by semantic analysis (-1 before)
     std::unique_ptr<Expression> initializer;
     
-    VariableDeclaration(const std::string& n, std::unique_ptr<Expression> init)
-        : name(n), initializer(std::move(init)) {}
+    VariableDeclaration(const std::string& n, std::unique_ptr<Expression> init,
+                        SymbolId sym = INVALID_SYMBOL)
+        : name(n), symbol(sym), slot(-1), initializer(std::move(init)) {}
     
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Statement> clone() const override;
 };
 
 class PrintStatement : public Statement {
@@ -82,6 +98,7 @@ public:
     
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Statement> clone() const override;
 };
 
 class BlockStatement : public Statement {
@@ -92,6 +109,7 @@ public:
     
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Statement> clone() const override;
 };
 
 class IfStatement : public Statement {
@@ -99,6 +117,7 @@ public:
     std::unique_ptr<Expression> condition;
     std::unique_ptr<Statement> thenBranch;
     std::unique_ptr<Statement> elseBranch;
+    SourceLocation location;
     
     IfStatement(std::unique_ptr<Expression> cond,
                 std::unique_ptr<Statement> thenBr,
@@ -109,33 +128,43 @@ public:
     
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Statement> clone() const override;
 };
 
 class ForStatement : public Statement {
 public:
     std::string variable;
+    SymbolId symbol;
+    int slot; // Frame slot, resolved by semantic analysis (-1 before)
     std::unique_ptr<Expression> start;
     std::unique_ptr<Expression> end;
     std::unique_ptr<Statement> body;
+    SourceLocation location;
     
     ForStatement(const std::string& var,
                  std::unique_ptr<Expression> s,
                  std::unique_ptr<Expression> e,
-                 std::unique_ptr<Statement> b)
-        : variable(var), start(std::move(s)), end(std::move(e)), body(std::move(b)) {}
+                 std::unique_ptr<Statement> b,
+                 SymbolId sym = INVALID_SYMBOL)
+        : variable(var), symbol(sym), slot(-1), start(std::move(s)), end(std::move(e)), body(std::move(b)) {}
     
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    std::unique_ptr<Statement> clone() const override;
 };
 
 class Program : public ASTNode {
 public:
     std::vector<std::unique_ptr<Statement>> statements;
+    SymbolInterner symbols; // Names of all SymbolIds used in the tree
+    int frameSize;          // Number of variable slots, set by semantic analysis
     
-    Program() = default;
+    Program() : frameSize(0) {}
     
     void accept(ASTVisitor& visitor) override;
     std::string toJSON(int indent = 0) const override;
+    // Deep copy, including the symbol table
+    std::unique_ptr<Program> clone() const;
 };
 
 // Visitor Pattern
@@ -0,0 +1,134 @@
+#ifndef BINARY_OP_H
+#define BINARY_OP_H
+
+#include <cstdint>
+
+// Binary operators of the language. The parser sets these on
+// BinaryExpression; passes switch on them instead of comparing strings.
+// SHL and SHR have no source syntax: only the optimizer introduces them,
+// always with a literal shift amount as the right operand.
+enum class BinaryOp : uint8_t {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    GT,
+    LT,
+    EQ,
+    SHL,  // Left shift
+    SHR   // Arithmetic right shift
+};
+
+const int BINARY_OP_COUNT = 9;
+
+// Per-operator evaluators shared by the optimizer (constant folding) and
+// the VM, so compile-time and run-time results are always identical.
+// Arithmetic wraps around on 32-bit overflow instead of being undefined.
+namespace BinaryOps {
+    constexpr int32_t add(int32_t l, int32_t r) {
+        return static_cast<int32_t>(static_cast<uint32_t>(l) + static_cast<uint32_t>(r));
+    }
+    constexpr int32_t sub(int32_t l, int32_t r) {
+        return static_cast<int32_t>(static_cast<uint32_t>(l) - static_cast<uint32_t>(r));
+    }
+    constexpr int32_t mul(int32_t l, int32_t r) {
+        return static_cast<int32_t>(static_cast<uint32_t>(l) * static_cast<uint32_t>(r));
+    }
+    // Caller must rule out r == 0; INT32_MIN / -1 wraps to INT32_MIN
+    constexpr int32_t div(int32_t l, int32_t r) {
+        return r == -1 ? sub(0, l) : l / r;
+    }
+    constexpr int32_t gt(int32_t l, int32_t r) { return l > r ? 1 : 0; }
+    constexpr int32_t lt(int32_t l, int32_t r) { return l < r ? 1 : 0; }
+    constexpr int32_t eq(int32_t l, int32_t r) { return l == r ? 1 : 0; }
+    // Caller must keep r in [0, 31]
+    constexpr int32_t shl(int32_t l, int32_t r) {
+        return static_cast<int32_t>(static_cast<uint32_t>(l) << r);
+    }
+    constexpr int32_t shr(int32_t l, int32_t r) {
+        return l >= 0 ? l >> r : ~(~l >> r);
+    }
+    constexpr int32_t neg(int32_t v) { return sub(0, v); }
+}
+
+// Evaluates op on constant operands. Returns false when the operation
+// would fail at run time (division by zero) or has no defined result (a
+// shift amount outside [0, 31]), in which case it cannot be folded.
+constexpr bool evaluateBinaryOp(BinaryOp op, int32_t l, int32_t r, int32_t& result) {
+    switch (op) {
+        case BinaryOp::ADD: result = BinaryOps::add(l, r); return true;
+        case BinaryOp::SUB: result = BinaryOps::sub(l, r); return true;
+        case BinaryOp::MUL: result = BinaryOps::mul(l, r); return true;
+        case BinaryOp::DIV:
+            if (r == 0) return false;
+            result = BinaryOps::div(l, r);
+            return true;
+        case BinaryOp::GT: result = BinaryOps::gt(l, r); return true;
+        case BinaryOp::LT: result = BinaryOps::lt(l, r); return true;
+        case BinaryOp::EQ: result = BinaryOps::eq(l, r); return true;
+        case BinaryOp::SHL:
+        case BinaryOp::SHR:
+            if (r < 0 || r > 31) return false;
+            result = op == BinaryOp::SHL ? BinaryOps::shl(l, r) : BinaryOps::shr(l, r);
+            return true;
+    }
+    return false;
+}
+
+// Signed division by a constant as a multiplication by its fixed-point
+// reciprocal (Hacker's Delight, 10-1): n / d is the high half of
+// multiplier * n, corrected by n and shifted right. Valid for 2 <= |d| < 2^31.
+struct DivisionMagic {
+    int32_t multiplier;
+    int shift;
+};
+
+constexpr DivisionMagic computeDivisionMagic(int32_t d) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? 0u - static_cast<uint32_t>(d) : static_cast<uint32_t>(d);
+    uint32_t t = two31 + (static_cast<uint32_t>(d) >> 31);
+    uint32_t anc = t - 1 - t % ad; // Absolute value of the largest useful n
+    int p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta = 0;
+    do {
+        p++;
+        q1 *= 2; r1 *= 2;
+        if (r1 >= anc) { q1++; r1 -= anc; }
+        q2 *= 2; r2 *= 2;
+        if (r2 >= ad) { q2++; r2 -= ad; }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    
+    uint32_t multiplier = q2 + 1;
+    if (d < 0) multiplier = 0u - multiplier;
+    return {static_cast<int32_t>(multiplier), p - 32};
+}
+
+// Same result as BinaryOps::div(n, d) for the d the magic was computed for
+constexpr int32_t divideByMagic(int32_t n, int32_t d, DivisionMagic magic) {
+    int64_t q = (static_cast<int64_t>(magic.multiplier) * n) >> 32;
+    if (d > 0 && magic.multiplier < 0) q += n;
+    if (d < 0 && magic.multiplier > 0) q -= n;
+    int32_t quotient = static_cast<int32_t>(q);
+    quotient = BinaryOps::shr(quotient, magic.shift);
+    return quotient + static_cast<int32_t>(static_cast<uint32_t>(quotient) >> 31);
+}
+
+constexpr const char* binaryOpSymbol(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::ADD: return "+";
+        case BinaryOp::SUB: return "-";
+        case BinaryOp::MUL: return "*";
+        case BinaryOp::DIV: return "/";
+        case BinaryOp::GT:  return ">";
+        case BinaryOp::LT:  return "<";
+        case BinaryOp::EQ:  return "==";
+        case BinaryOp::SHL: return "<<";
+        case BinaryOp::SHR: return ">>";
+    }
+    return "?";
+}
+
+#endif // BINARY_OP_H
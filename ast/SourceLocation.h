@@ -0,0 +1,21 @@
+#ifndef SOURCE_LOCATION_H
+#define SOURCE_LOCATION_H
+
+// Line and column of the keyword an if or for statement starts with. The
+// parser sets it; statements the optimizer makes up keep the location of
+// the statement they replace, or none (line 0). Execution profiles are
+// keyed by it, so it is carried from the AST to the IR and the bytecode.
+struct SourceLocation {
+    int line = 0;
+    int column = 0;
+
+    bool isKnown() const { return line > 0; }
+    bool operator<(const SourceLocation& other) const {
+        return line != other.line ? line < other.line : column < other.column;
+    }
+    bool operator==(const SourceLocation& other) const {
+        return line == other.line && column == other.column;
+    }
+};
+
+#endif // SOURCE_LOCATION_H
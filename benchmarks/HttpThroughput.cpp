@@ -0,0 +1,236 @@
+// Load generator for the --server mode: a number of clients send requests
+// to the server at the same time, each waiting for its answer before it
+// sends the next, and the throughput and latencies are printed.
+//
+//   http_throughput [--clients=N] [--requests=N] [--port=N] [--static[=PATH]]
+//                   [--keep-alive] [--server-pid=PID]
+//
+// Every request is a POST /compile of a small program, or with --static a
+// GET of the editor page (or of PATH). Each one opens a connection of its own, or with
+// --keep-alive each client sends all its requests on one. With the pid of
+// the server, the CPU time it spent per response is printed too (Linux,
+// from /proc, counted in clock ticks: runs need thousands of responses).
+// POSIX only.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Settings {
+    int clients = 16;
+    int requests = 50; // Per client
+    int port = 8080;
+    bool staticPage = false;
+    std::string path = "/";
+    bool keepAlive = false;
+    int serverPid = 0;
+};
+
+const char* SOURCE =
+    "source=let+total+%3D+0%3B%0Afor+i+%3D+1+to+2000+%7B%0A++if+i+%3E+1000+%7B%0A"
+    "++++let+total+%3D+total+%2B+i%3B%0A++%7D%0A%7D%0Aprint+total%3B%0A";
+
+std::string buildRequest(const Settings& settings) {
+    std::string connection = settings.keepAlive ? "keep-alive" : "close";
+    if (settings.staticPage) {
+        return "GET " + settings.path + " HTTP/1.1\r\nHost: localhost\r\nConnection: " + connection + "\r\n\r\n";
+    }
+    std::string body = SOURCE;
+    return "POST /compile HTTP/1.1\r\nHost: localhost\r\n"
+           "Content-Type: application/x-www-form-urlencoded\r\n"
+           "Content-Length: " + std::to_string(body.length()) + "\r\n"
+           "Connection: " + connection + "\r\n\r\n" + body;
+}
+
+int openConnection(const Settings& settings) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(settings.port));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Reads one response framed by its Content-Length
+bool readResponse(int fd, std::string& response) {
+    char buffer[16384];
+    size_t headEnd = std::string::npos;
+    size_t total = std::string::npos;
+    while (total == std::string::npos || response.length() < total) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return false;
+        }
+        response.append(buffer, static_cast<size_t>(n));
+        if (headEnd == std::string::npos && (headEnd = response.find("\r\n\r\n")) != std::string::npos) {
+            size_t field = response.find("Content-Length: ");
+            if (field == std::string::npos || field > headEnd) {
+                return false;
+            }
+            total = headEnd + 4 + std::strtoull(response.c_str() + field + 16, nullptr, 10);
+        }
+    }
+    return true;
+}
+
+// Sends request on the client's connection, opening one if it has none,
+// and reads the answer; true if the status is 200. The connection is
+// closed again unless both sides keep it alive.
+bool exchange(const Settings& settings, const std::string& request, int& fd) {
+    if (fd < 0 && (fd = openConnection(settings)) < 0) {
+        return false;
+    }
+
+    size_t sent = 0;
+    std::string response;
+    bool ok = true;
+    while (ok && sent < request.length()) {
+        ssize_t n = send(fd, request.data() + sent, request.length() - sent, MSG_NOSIGNAL);
+        ok = n > 0;
+        sent += ok ? static_cast<size_t>(n) : 0;
+    }
+    ok = ok && readResponse(fd, response);
+    if (!ok || !settings.keepAlive || response.find("Connection: close") != std::string::npos) {
+        close(fd);
+        fd = -1;
+    }
+    return ok && response.compare(0, 12, "HTTP/1.1 200") == 0;
+}
+
+// User plus system CPU seconds the process has used; -1 if unknown
+double cpuSeconds(int pid) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line) || line.rfind(')') == std::string::npos) {
+        return -1;
+    }
+    // Past the command name: state is field 3, utime 14 and stime 15
+    std::istringstream fields(line.substr(line.rfind(')') + 2));
+    std::string field;
+    double ticks = 0;
+    for (int i = 3; i <= 15 && fields >> field; ++i) {
+        if (i >= 14) {
+            ticks += std::strtod(field.c_str(), nullptr);
+        }
+    }
+    return ticks / static_cast<double>(sysconf(_SC_CLK_TCK));
+}
+
+bool parseFlag(const char* arg, const char* name, int& value) {
+    size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0) {
+        return false;
+    }
+    value = std::atoi(arg + length);
+    return value > 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    for (int i = 1; i < argc; ++i) {
+        if (parseFlag(argv[i], "--clients=", settings.clients) ||
+            parseFlag(argv[i], "--requests=", settings.requests) ||
+            parseFlag(argv[i], "--port=", settings.port) ||
+            parseFlag(argv[i], "--server-pid=", settings.serverPid)) {
+            continue;
+        }
+        if (std::strcmp(argv[i], "--static") == 0) {
+            settings.staticPage = true;
+            continue;
+        }
+        if (std::strncmp(argv[i], "--static=", 9) == 0 && argv[i][9] == '/') {
+            settings.staticPage = true;
+            settings.path = argv[i] + 9;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--keep-alive") == 0) {
+            settings.keepAlive = true;
+            continue;
+        }
+        std::cerr << "Unknown option: " << argv[i] << std::endl;
+        return 1;
+    }
+
+    const std::string request = buildRequest(settings);
+    std::vector<double> latencies;
+    std::mutex latenciesMutex;
+    std::atomic<int> failures(0);
+
+    double cpuBefore = settings.serverPid ? cpuSeconds(settings.serverPid) : -1;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (int c = 0; c < settings.clients; ++c) {
+        clients.emplace_back([&] {
+            std::vector<double> own;
+            int fd = -1;
+            for (int r = 0; r < settings.requests; ++r) {
+                auto sentAt = std::chrono::steady_clock::now();
+                if (!exchange(settings, request, fd)) {
+                    failures++;
+                    continue;
+                }
+                std::chrono::duration<double, std::milli> latency =
+                    std::chrono::steady_clock::now() - sentAt;
+                own.push_back(latency.count());
+            }
+            if (fd >= 0) {
+                close(fd);
+            }
+            std::lock_guard<std::mutex> lock(latenciesMutex);
+            latencies.insert(latencies.end(), own.begin(), own.end());
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double cpuAfter = cpuBefore >= 0 ? cpuSeconds(settings.serverPid) : -1;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        if (latencies.empty()) return 0.0;
+        size_t index = static_cast<size_t>(p * (latencies.size() - 1));
+        return latencies[index];
+    };
+
+    std::cout << std::fixed << std::setprecision(1)
+              << settings.clients << " clients x " << settings.requests << " requests ("
+              << (settings.staticPage ? "GET " + settings.path : "POST /compile")
+              << (settings.keepAlive ? ", keep-alive" : "") << "): "
+              << latencies.size() << " ok, " << failures << " failed, "
+              << latencies.size() / elapsed.count() << " requests/s, latency p50 "
+              << std::setprecision(2) << percentile(0.5) << " ms, p99 " << percentile(0.99)
+              << " ms";
+    if (cpuAfter >= 0 && !latencies.empty()) {
+        std::cout << ", server CPU " << std::setprecision(1)
+                  << (cpuAfter - cpuBefore) * 1e6 / latencies.size() << " us/response";
+    }
+    std::cout << std::endl;
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Throughput of the --server mode under concurrent clients. Starts the
+# server with each worker count in $THREADS (default: 1 and one per core),
+# runs benchmarks/http_throughput against it with 1 to 64 clients, and
+# stops it again. Arguments go to http_throughput (e.g. --keep-alive or
+# --static). Port 8080 must be free.
+set -e
+cd "$(dirname "$0")/.."
+CORES=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 4)
+THREADS=${THREADS:-"1 $CORES"}
+REQUESTS=${REQUESTS:-50}
+
+for threads in $THREADS; do
+    ./compiler --server --threads="$threads" > /dev/null &
+    server=$!
+    trap 'kill $server 2>/dev/null || true' EXIT
+    sleep 1
+    echo "== $threads worker threads"
+    for clients in 1 4 16 64; do
+        ./benchmarks/http_throughput --clients="$clients" --requests="$REQUESTS" \
+            --server-pid="$server" "$@" || true
+    done
+    kill "$server"
+    wait "$server" 2>/dev/null || true
+done
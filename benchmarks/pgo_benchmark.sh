@@ -0,0 +1,24 @@
+#!/bin/sh
+# Profile-guided optimization on branchy programs. Each program in
+# benchmarks/pgo is compiled and run at -O2 (or $LEVEL), run once more as
+# an instrumented build that writes a profile, and compiled and run at the
+# same level with that profile. Prints the VM instructions executed.
+set -e
+cd "$(dirname "$0")/.."
+COMPILER=./compiler
+LEVEL=${LEVEL:--O2}
+PROFILE=$(mktemp)
+trap 'rm -f "$PROFILE"' EXIT
+
+executed() {
+    "$COMPILER" "$@" | sed -n 's/^Executed instructions: //p'
+}
+
+printf "%-16s %12s %12s %8s\n" program "$LEVEL" "+profile" saved
+for program in benchmarks/pgo/*.txt; do
+    before=$(executed "$LEVEL" "$program")
+    "$COMPILER" --profile-generate="$PROFILE" "$program" > /dev/null
+    after=$(executed "$LEVEL" --profile-use="$PROFILE" "$program")
+    printf "%-16s %12s %12s %7s%%\n" "$(basename "$program" .txt)" "$before" "$after" \
+        "$(( (before - after) * 100 / before ))"
+done
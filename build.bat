@@ -2,7 +2,7 @@
 echo Building Educational Mini Compiler...
 echo.
 
-g++ -std=c++17 -I. main.cpp Compiler.cpp lexer/Lexer.cpp ast/AST.cpp parser/Parser.cpp semantic/SemanticAnalyzer.cpp optimizer/Optimizer.cpp codegen/Bytecode.cpp codegen/CodeGenerator.cpp vm/VirtualMachine.cpp -o compiler.exe -lws2_32
+g++ -std=c++17 -I. main.cpp Compiler.cpp lexer/Lexer.cpp ast/AST.cpp parser/Parser.cpp parser/IncrementalParser.cpp semantic/SemanticAnalyzer.cpp optimizer/Optimizer.cpp optimizer/ASTRewriter.cpp optimizer/PassManager.cpp optimizer/ConstantFolding.cpp optimizer/ConstantPropagation.cpp optimizer/DeadCodeElimination.cpp optimizer/DeadStoreElimination.cpp optimizer/LoopInvariantCodeMotion.cpp optimizer/ScalarEvolution.cpp optimizer/StrengthReduction.cpp optimizer/LoopUnrolling.cpp codegen/Bytecode.cpp codegen/BytecodeOptimizer.cpp ir/IR.cpp ir/Dominators.cpp ir/IRBuilder.cpp ir/IRPass.cpp ir/SparseConditionalConstantPropagation.cpp ir/LocalValueNumbering.cpp ir/IRDeadCodeElimination.cpp ir/BytecodeEmitter.cpp vm/VirtualMachine.cpp vm/PartialEvaluator.cpp vm/Profile.cpp server/WorkerPool.cpp server/HttpMessage.cpp server/HttpRequestParser.cpp server/HttpServer.cpp server/StaticAssetCache.cpp -o compiler.exe -lws2_32
 
 if %errorlevel% == 0 (
     echo.
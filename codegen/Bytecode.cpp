@@ -2,10 +2,12 @@
 #include <sstream>
 #include <map>
 
-static std::map<OpCode, std::string> opcodeNames = {
+// Read-only, so compilers on different threads can share it
+static const std::map<OpCode, std::string> opcodeNames = {
     {OpCode::PUSH, "PUSH"},
     {OpCode::LOAD, "LOAD"},
     {OpCode::STORE, "STORE"},
+    {OpCode::DUP, "DUP"},
     {OpCode::ADD, "ADD"},
     {OpCode::SUB, "SUB"},
     {OpCode::MUL, "MUL"},
@@ -13,18 +15,40 @@ static std::map<OpCode, std::string> opcodeNames = {
     {OpCode::GT, "GT"},
     {OpCode::LT, "LT"},
     {OpCode::EQ, "EQ"},
+    {OpCode::NEG, "NEG"},
+    {OpCode::SHL, "SHL"},
+    {OpCode::SHR, "SHR"},
+    {OpCode::MULI, "MULI"},
+    {OpCode::DIVI, "DIVI"},
     {OpCode::JMP, "JMP"},
     {OpCode::JMP_IF_FALSE, "JMP_IF_FALSE"},
+    {OpCode::JMP_IF_TRUE, "JMP_IF_TRUE"},
     {OpCode::PRINT, "PRINT"},
     {OpCode::HALT, "HALT"}
 };
 
+bool Instruction::hasOperand() const {
+    switch (opcode) {
+        case OpCode::PUSH:
+        case OpCode::LOAD:
+        case OpCode::STORE:
+        case OpCode::SHL:
+        case OpCode::SHR:
+        case OpCode::MULI:
+        case OpCode::DIVI:
+        case OpCode::JMP:
+        case OpCode::JMP_IF_FALSE:
+        case OpCode::JMP_IF_TRUE:
+            return true;
+        default:
+            return false;
+    }
+}
+
 std::string Instruction::toString() const {
     std::ostringstream oss;
-    oss << opcodeNames[opcode];
-    if (opcode == OpCode::PUSH || opcode == OpCode::LOAD || 
-        opcode == OpCode::STORE || opcode == OpCode::JMP || 
-        opcode == OpCode::JMP_IF_FALSE) {
+    oss << opcodeNames.at(opcode);
+    if (hasOperand()) {
         oss << " " << operand;
     }
     return oss.str();
@@ -54,13 +78,9 @@ std::string Bytecode::toJSON() const {
     for (size_t i = 0; i < instructions.size(); ++i) {
         oss << "  {\n";
         oss << "    \"address\": " << i << ",\n";
-        oss << "    \"opcode\": \"" << opcodeNames[instructions[i].opcode] << "\"";
+        oss << "    \"opcode\": \"" << opcodeNames.at(instructions[i].opcode) << "\"";
         
-        if (instructions[i].opcode == OpCode::PUSH || 
-            instructions[i].opcode == OpCode::LOAD || 
-            instructions[i].opcode == OpCode::STORE || 
-            instructions[i].opcode == OpCode::JMP || 
-            instructions[i].opcode == OpCode::JMP_IF_FALSE) {
+        if (instructions[i].hasOperand()) {
             oss << ",\n    \"operand\": " << instructions[i].operand;
         }
         
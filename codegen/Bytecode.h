@@ -3,11 +3,14 @@
 
 #include <string>
 #include <vector>
+#include "../ast/BinaryOp.h"
+#include "../ast/SourceLocation.h"
 
 enum class OpCode {
     PUSH,        // Push constant onto stack
     LOAD,        // Load variable onto stack
     STORE,       // Store top of stack to variable
+    DUP,         // Push a copy of the top of stack
     ADD,         // Add top two stack values
     SUB,         // Subtract
     MUL,         // Multiply
@@ -15,30 +18,63 @@ enum class OpCode {
     GT,          // Greater than
     LT,          // Less than
     EQ,          // Equal
+    NEG,         // Negate top of stack
+    SHL,         // Shift left by the operand
+    SHR,         // Arithmetic shift right by the operand
+    MULI,        // Multiply by the operand
+    DIVI,        // Divide by the operand (never zero), using its reciprocal
     JMP,         // Unconditional jump
     JMP_IF_FALSE,// Jump if top of stack is false
+    JMP_IF_TRUE, // Jump if top of stack is true
     PRINT,       // Print top of stack
     HALT         // Stop execution
 };
 
 struct Instruction {
     OpCode opcode;
-    int operand;  // Used for PUSH (value), LOAD/STORE (var index), JMP (address)
+    int operand;  // Used for PUSH/MULI/DIVI (value), SHL/SHR (shift amount),
+                  // LOAD/STORE (frame slot), jumps (address)
+    DivisionMagic magic; // DIVI: reciprocal of the operand
     
-    Instruction(OpCode op, int oper = 0) : opcode(op), operand(oper) {}
+    Instruction(OpCode op, int oper = 0)
+        : opcode(op), operand(oper), 
+          magic(op == OpCode::DIVI ? computeDivisionMagic(oper) : DivisionMagic{0, 0}) {}
     
+    bool hasOperand() const;
     std::string toString() const;
 };
 
+// The conditional jump that the condition of an if, or the exit test of
+// a for, compiled to. An instrumented build records these, so that the
+// jumps counted by the VM can be traced back to the source (see Profile).
+struct BranchProbe {
+    int address;
+    SourceLocation location;
+    bool loop; // The jump tests whether a for loop is done
+};
+
 class Bytecode {
 private:
     std::vector<Instruction> instructions;
+    int frameSize; // Number of variable slots LOAD/STORE address
+    std::vector<BranchProbe> probes;
     
 public:
+    Bytecode() : frameSize(0) {}
+    
     void emit(OpCode opcode, int operand = 0);
     void patchJump(int jumpIndex, int targetAddress);
     int getCurrentAddress() const { return instructions.size(); }
     const std::vector<Instruction>& getInstructions() const { return instructions; }
+    // Replacing the code moves the jumps, so it drops the probes
+    void setInstructions(std::vector<Instruction> code) {
+        instructions = std::move(code);
+        probes.clear();
+    }
+    void setFrameSize(int size) { frameSize = size; }
+    int getFrameSize() const { return frameSize; }
+    void addProbe(const BranchProbe& probe) { probes.push_back(probe); }
+    const std::vector<BranchProbe>& getProbes() const { return probes; }
     
     std::string toString() const;
     std::string toJSON() const;
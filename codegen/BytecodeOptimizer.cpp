@@ -0,0 +1,423 @@
+#include "BytecodeOptimizer.h"
+#include <algorithm>
+#include <set>
+
+const BytecodeOptimizer::Rule BytecodeOptimizer::rules[] = {
+    {"jump threading", &BytecodeOptimizer::threadJump},
+    {"jump to next instruction", &BytecodeOptimizer::removeJumpToNext},
+    {"branch inversion", &BytecodeOptimizer::invertBranch},
+    {"constant branch", &BytecodeOptimizer::foldConstantBranch},
+    {"identity", &BytecodeOptimizer::removeIdentity},
+    {"store/load forwarding", &BytecodeOptimizer::forwardStore},
+    {"dead code before halt", &BytecodeOptimizer::removeBeforeHalt},
+};
+
+int BytecodeOptimizer::optimize(Bytecode& bytecode) {
+    const size_t ruleCount = sizeof(rules) / sizeof(rules[0]);
+    code = bytecode.getInstructions();
+    statistics.clear();
+    for (const Rule& rule : rules) {
+        statistics.push_back({rule.name, 0});
+    }
+    statistics.push_back({"copied loop test", 0});
+    statistics.push_back({"unreachable code", 0});
+
+    int total = 0;
+    rounds = 0;
+    while (rounds < maxRounds) {
+        rounds++;
+        removed.assign(code.size(), false);
+        int unreachable = removeUnreachable();
+        statistics.back().rewrites += unreachable;
+        int changes = unreachable;
+        beginRound();
+
+        // Backwards, so that a rewrite can complete the window of the
+        // instruction before it in the same round
+        for (size_t index = code.size(); index-- > 0;) {
+            bool fired = true;
+            while (fired && !removed[index]) {
+                fired = false;
+                for (size_t r = 0; r < ruleCount; ++r) {
+                    auto apply = rules[r].apply;
+                    if ((this->*apply)(index)) {
+                        statistics[r].rewrites++;
+                        changes++;
+                        fired = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        compact();
+        int copies = copyLoopTests();
+        statistics[ruleCount].rewrites += copies;
+        changes += copies;
+        total += changes;
+        if (changes == 0) break;
+    }
+
+    bytecode.setInstructions(std::move(code));
+    code.clear();
+    return total;
+}
+
+size_t BytecodeOptimizer::nextLive(size_t index) const {
+    return landing(index + 1);
+}
+
+size_t BytecodeOptimizer::landing(int address) const {
+    size_t index = std::min(static_cast<size_t>(std::max(address, 0)), code.size());
+    while (index < code.size() && removed[index]) {
+        index++;
+    }
+    return index;
+}
+
+bool BytecodeOptimizer::isJump(size_t index) const {
+    OpCode opcode = code[index].opcode;
+    return opcode == OpCode::JMP || opcode == OpCode::JMP_IF_FALSE || opcode == OpCode::JMP_IF_TRUE;
+}
+
+// Jumps to a removed instruction land on the next kept one, which becomes
+// a target in its place
+void BytecodeOptimizer::remove(size_t index) {
+    removed[index] = true;
+    if (code[index].opcode == OpCode::LOAD) {
+        loads[code[index].operand]--;
+    }
+    if (targets[index]) {
+        size_t next = nextLive(index);
+        if (next < code.size()) {
+            targets[next] = true;
+        }
+    }
+}
+
+void BytecodeOptimizer::beginRound() {
+    targets.assign(code.size(), false);
+    loads.clear();
+    for (size_t index = 0; index < code.size(); ++index) {
+        if (removed[index]) continue;
+        const Instruction& instruction = code[index];
+        if (isJump(index)) {
+            size_t target = landing(instruction.operand);
+            if (target < code.size()) {
+                targets[target] = true;
+            }
+        } else if (instruction.opcode == OpCode::LOAD || instruction.opcode == OpCode::STORE) {
+            if (static_cast<size_t>(instruction.operand) >= loads.size()) {
+                loads.resize(instruction.operand + 1, 0);
+            }
+            if (instruction.opcode == OpCode::LOAD) {
+                loads[instruction.operand]++;
+            }
+        }
+    }
+}
+
+int BytecodeOptimizer::removeUnreachable() {
+    std::vector<bool> reached(code.size(), false);
+    std::vector<size_t> worklist = {landing(0)};
+    while (!worklist.empty()) {
+        size_t index = worklist.back();
+        worklist.pop_back();
+        if (index >= code.size() || reached[index]) continue;
+        reached[index] = true;
+
+        OpCode opcode = code[index].opcode;
+        if (isJump(index)) {
+            worklist.push_back(landing(code[index].operand));
+        }
+        if (opcode != OpCode::JMP && opcode != OpCode::HALT) {
+            worklist.push_back(nextLive(index));
+        }
+    }
+
+    int count = 0;
+    for (size_t index = 0; index < code.size(); ++index) {
+        if (!reached[index] && !removed[index]) {
+            removed[index] = true;
+            count++;
+        }
+    }
+    return count;
+}
+
+// Drops removed instructions and moves every jump to the new address of
+// the instruction it lands on
+void BytecodeOptimizer::compact() {
+    std::vector<int> addresses(code.size() + 1, 0);
+    int next = 0;
+    for (size_t index = 0; index < code.size(); ++index) {
+        addresses[index] = next;
+        if (!removed[index]) next++;
+    }
+    addresses[code.size()] = next;
+
+    std::vector<Instruction> kept;
+    kept.reserve(next);
+    for (size_t index = 0; index < code.size(); ++index) {
+        if (removed[index]) continue;
+        Instruction instruction = code[index];
+        if (isJump(index)) {
+            instruction.operand = addresses[landing(instruction.operand)];
+        }
+        kept.push_back(instruction);
+    }
+    code = std::move(kept);
+}
+
+// On compacted code:
+//   t: test; JMP_IF_TRUE exit; body...; JMP t; exit:
+// becomes
+//   t: test; JMP_IF_TRUE exit; body...; test; JMP_IF_FALSE body; exit:
+int BytecodeOptimizer::copyLoopTests() {
+    std::vector<std::vector<Instruction>> copies(code.size());
+    int count = 0;
+    for (size_t index = 0; index < code.size(); ++index) {
+        if (code[index].opcode != OpCode::JMP || code[index].operand < 0 ||
+            static_cast<size_t>(code[index].operand) > index) {
+            continue;
+        }
+
+        size_t test = code[index].operand;
+        size_t branch = test;
+        while (branch < index && branch - test <= maxCopiedTest &&
+               !isJump(branch) && code[branch].opcode != OpCode::HALT) {
+            branch++;
+        }
+        if (branch >= index || branch - test > maxCopiedTest ||
+            (code[branch].opcode != OpCode::JMP_IF_FALSE && code[branch].opcode != OpCode::JMP_IF_TRUE)) {
+            continue;
+        }
+
+        OpCode opcode = code[branch].opcode;
+        OpCode inverted = opcode == OpCode::JMP_IF_FALSE ? OpCode::JMP_IF_TRUE : OpCode::JMP_IF_FALSE;
+        int taken = code[branch].operand;
+        int fallthrough = branch + 1;
+        std::vector<Instruction> copy(code.begin() + test, code.begin() + branch);
+        if (fallthrough == static_cast<int>(index) + 1) {
+            copy.push_back(Instruction(opcode, taken));
+        } else if (taken == static_cast<int>(index) + 1) {
+            copy.push_back(Instruction(inverted, fallthrough));
+        } else if (code[fallthrough].opcode == OpCode::HALT) {
+            copy.push_back(Instruction(opcode, taken));
+            copy.push_back(Instruction(OpCode::HALT));
+        } else {
+            continue;
+        }
+        copies[index] = std::move(copy);
+        count++;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    std::vector<int> addresses(code.size() + 1, 0);
+    int next = 0;
+    for (size_t index = 0; index < code.size(); ++index) {
+        addresses[index] = next;
+        next += copies[index].empty() ? 1 : copies[index].size();
+    }
+    addresses[code.size()] = next;
+
+    auto relocate = [&](Instruction instruction) {
+        if (instruction.opcode == OpCode::JMP || instruction.opcode == OpCode::JMP_IF_FALSE ||
+            instruction.opcode == OpCode::JMP_IF_TRUE) {
+            instruction.operand = addresses[std::min(static_cast<size_t>(std::max(instruction.operand, 0)),
+                                                     code.size())];
+        }
+        return instruction;
+    };
+    std::vector<Instruction> expanded;
+    expanded.reserve(next);
+    for (size_t index = 0; index < code.size(); ++index) {
+        if (copies[index].empty()) {
+            expanded.push_back(relocate(code[index]));
+        } else {
+            for (const Instruction& instruction : copies[index]) {
+                expanded.push_back(relocate(instruction));
+            }
+        }
+    }
+    code = std::move(expanded);
+    return count;
+}
+
+// JMP, JMP_IF_FALSE or JMP_IF_TRUE to a chain of JMPs goes to the end of
+// the chain; a JMP to HALT halts. Chains that loop forever are left alone.
+bool BytecodeOptimizer::threadJump(size_t index) {
+    if (!isJump(index)) {
+        return false;
+    }
+
+    size_t target = landing(code[index].operand);
+    if (target >= code.size()) {
+        return false;
+    }
+    if (code[index].opcode == OpCode::JMP && code[target].opcode == OpCode::HALT) {
+        code[index] = Instruction(OpCode::HALT);
+        return true;
+    }
+
+    std::set<size_t> visited = {index};
+    size_t end = target;
+    while (end < code.size() && code[end].opcode == OpCode::JMP) {
+        if (!visited.insert(end).second) {
+            return false;
+        }
+        end = landing(code[end].operand);
+    }
+    if (end == target) {
+        return false;
+    }
+    code[index].operand = static_cast<int>(end);
+    return true;
+}
+
+bool BytecodeOptimizer::removeJumpToNext(size_t index) {
+    if (code[index].opcode != OpCode::JMP || landing(code[index].operand) != nextLive(index)) {
+        return false;
+    }
+    remove(index);
+    return true;
+}
+
+// JMP_IF_FALSE a; JMP b; a:  ->  JMP_IF_TRUE b; a:
+bool BytecodeOptimizer::invertBranch(size_t index) {
+    OpCode opcode = code[index].opcode;
+    if (opcode != OpCode::JMP_IF_FALSE && opcode != OpCode::JMP_IF_TRUE) {
+        return false;
+    }
+    size_t jump = nextLive(index);
+    if (jump >= code.size() || code[jump].opcode != OpCode::JMP || targets[jump] ||
+        landing(code[index].operand) != nextLive(jump)) {
+        return false;
+    }
+
+    OpCode inverted = opcode == OpCode::JMP_IF_FALSE ? OpCode::JMP_IF_TRUE : OpCode::JMP_IF_FALSE;
+    code[index] = Instruction(inverted, code[jump].operand);
+    remove(jump);
+    return true;
+}
+
+// PUSH c; JMP_IF_FALSE a  ->  JMP a when c is 0, nothing otherwise
+bool BytecodeOptimizer::foldConstantBranch(size_t index) {
+    if (code[index].opcode != OpCode::PUSH) {
+        return false;
+    }
+    size_t branch = nextLive(index);
+    if (branch >= code.size() || targets[branch] ||
+        (code[branch].opcode != OpCode::JMP_IF_FALSE && code[branch].opcode != OpCode::JMP_IF_TRUE)) {
+        return false;
+    }
+
+    bool taken = (code[index].operand != 0) == (code[branch].opcode == OpCode::JMP_IF_TRUE);
+    remove(index);
+    if (taken) {
+        code[branch] = Instruction(OpCode::JMP, code[branch].operand);
+    } else {
+        remove(branch);
+    }
+    return true;
+}
+
+bool BytecodeOptimizer::removeIdentity(size_t index) {
+    const Instruction& instruction = code[index];
+    switch (instruction.opcode) {
+        case OpCode::MULI:
+            if (instruction.operand != 1) return false;
+            remove(index);
+            return true;
+        case OpCode::SHL:
+        case OpCode::SHR:
+            if (instruction.operand != 0) return false;
+            remove(index);
+            return true;
+        default:
+            break;
+    }
+
+    size_t next = nextLive(index);
+    if (next >= code.size() || targets[next]) {
+        return false;
+    }
+    OpCode second = code[next].opcode;
+    bool identity = false;
+    if (instruction.opcode == OpCode::PUSH && instruction.operand == 0) {
+        identity = second == OpCode::ADD || second == OpCode::SUB;
+    } else if (instruction.opcode == OpCode::PUSH && instruction.operand == 1) {
+        identity = second == OpCode::MUL || second == OpCode::DIV;
+    } else if (instruction.opcode == OpCode::NEG) {
+        identity = second == OpCode::NEG;
+    }
+    if (!identity) {
+        return false;
+    }
+    remove(index);
+    remove(next);
+    return true;
+}
+
+// STORE x; LOAD x  ->  DUP; STORE x, or nothing if x is not loaded elsewhere
+// LOAD x; STORE x  ->  nothing
+// PUSH/LOAD/DUP; STORE x  ->  nothing, if x is never loaded
+bool BytecodeOptimizer::forwardStore(size_t index) {
+    size_t next = nextLive(index);
+    if (next >= code.size() || targets[next]) {
+        return false;
+    }
+    const Instruction& first = code[index];
+    const Instruction& second = code[next];
+
+    if (first.opcode == OpCode::STORE && second.opcode == OpCode::LOAD &&
+        first.operand == second.operand) {
+        int slot = first.operand;
+        if (loads[slot] == 1) {
+            remove(index);
+            remove(next);
+        } else {
+            loads[slot]--;
+            code[index] = Instruction(OpCode::DUP);
+            code[next] = Instruction(OpCode::STORE, slot);
+        }
+        return true;
+    }
+
+    if (second.opcode != OpCode::STORE) {
+        return false;
+    }
+    bool copy = first.opcode == OpCode::LOAD && first.operand == second.operand;
+    bool dead = loads[second.operand] == 0 &&
+                (first.opcode == OpCode::PUSH || first.opcode == OpCode::LOAD ||
+                 first.opcode == OpCode::DUP);
+    if (!copy && !dead) {
+        return false;
+    }
+    remove(index);
+    remove(next);
+    return true;
+}
+
+// Nothing is observable after HALT except output and failures, so an
+// instruction right before it that can neither print nor fail is dead
+bool BytecodeOptimizer::removeBeforeHalt(size_t index) {
+    size_t next = nextLive(index);
+    if (next >= code.size() || code[next].opcode != OpCode::HALT) {
+        return false;
+    }
+    switch (code[index].opcode) {
+        case OpCode::DIV:
+        case OpCode::PRINT:
+        case OpCode::HALT:
+        case OpCode::JMP:
+        case OpCode::JMP_IF_FALSE:
+        case OpCode::JMP_IF_TRUE:
+            return false;
+        default:
+            remove(index);
+            return true;
+    }
+}
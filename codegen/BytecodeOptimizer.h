@@ -0,0 +1,88 @@
+#ifndef BYTECODE_OPTIMIZER_H
+#define BYTECODE_OPTIMIZER_H
+
+#include <string>
+#include <vector>
+#include "Bytecode.h"
+
+// Peephole optimizer over finished bytecode. It cleans up what the
+// emitters leave at the seams between blocks and statements, which the
+// AST and IR passes cannot see. Each rule of a pattern table looks at a
+// short window of instructions and rewrites it in place:
+// - jump threading: a jump to a JMP goes straight to its target, and a
+//   JMP to HALT becomes HALT
+// - a JMP to the next instruction is removed
+// - branch inversion: JMP_IF_FALSE a; JMP b; a: becomes JMP_IF_TRUE b
+// - a conditional jump on a pushed constant is taken or removed
+// - identities: PUSH 0; ADD/SUB, PUSH 1; MUL/DIV, MULI 1, SHL 0,
+//   SHR 0 and NEG; NEG are removed
+// - store/load forwarding: STORE x; LOAD x becomes DUP; STORE x, or
+//   nothing if no other instruction loads x; LOAD x; STORE x is removed,
+//   and so is a pushed value stored to a slot that is never loaded
+// - instructions before HALT that cannot fail or print are removed
+// A JMP back to a loop test of at most maxCopiedTest instructions and a
+// conditional jump is replaced by a copy of the test, so each iteration
+// saves the JMP, as long as one way out of the copy is the instruction
+// after the JMP or a HALT (no other jump is needed).
+// Instructions no path from address 0 reaches (code after JMP and HALT)
+// are removed at the start of every round. A window only matches if no
+// jump lands inside it, so deletions never change what a jump reaches;
+// jumps to deleted instructions move to the next kept one when the code
+// is compacted at the end of the round. Rounds repeat until one changes
+// nothing.
+class BytecodeOptimizer {
+public:
+    struct Statistics {
+        std::string name;
+        int rewrites;
+    };
+
+private:
+    // A rule tries to rewrite the window starting at a live index and
+    // returns whether it did
+    struct Rule {
+        const char* name;
+        bool (BytecodeOptimizer::*apply)(size_t index);
+    };
+    static const Rule rules[];
+
+    std::vector<Instruction> code;
+    std::vector<bool> removed;
+    std::vector<bool> targets; // A jump lands here (may over-approximate)
+    std::vector<int> loads;    // Number of LOADs per frame slot
+    std::vector<Statistics> statistics;
+    int maxRounds;
+    int rounds;
+
+    size_t nextLive(size_t index) const;  // First kept index after index
+    size_t landing(int address) const;    // Where a jump to address ends up
+    bool isJump(size_t index) const;
+    void remove(size_t index);
+    void beginRound();
+    int removeUnreachable();
+    void compact();
+    int copyLoopTests();
+
+    bool threadJump(size_t index);
+    bool removeJumpToNext(size_t index);
+    bool invertBranch(size_t index);
+    bool foldConstantBranch(size_t index);
+    bool removeIdentity(size_t index);
+    bool forwardStore(size_t index);
+    bool removeBeforeHalt(size_t index);
+
+public:
+    static const int maxCopiedTest = 4;
+
+    explicit BytecodeOptimizer(int maxRoundCount = 16) : maxRounds(maxRoundCount), rounds(0) {}
+
+    // Rewrites bytecode in place; returns the number of rewrites
+    int optimize(Bytecode& bytecode);
+
+    // One entry per rule, in table order, then copied loop tests and
+    // unreachable code
+    const std::vector<Statistics>& getStatistics() const { return statistics; }
+    int getRounds() const { return rounds; }
+};
+
+#endif // BYTECODE_OPTIMIZER_H
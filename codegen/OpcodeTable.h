@@ -0,0 +1,45 @@
+#ifndef OPCODE_TABLE_H
+#define OPCODE_TABLE_H
+
+#include <cstdint>
+#include "../ast/BinaryOp.h"
+#include "Bytecode.h"
+
+// Instruction selection for binary operators, shared by BytecodeEmitter
+// and by the AST passes that count the instructions a subtree costs
+namespace OpcodeTable {
+    // Opcode emitted for each BinaryOp, indexed by the enum value. The
+    // second column is the form taking a literal right operand as its
+    // immediate operand (PUSH is used when there is none).
+    inline constexpr OpCode binaryOpcodes[BINARY_OP_COUNT][2] = {
+        {OpCode::ADD, OpCode::PUSH},  // BinaryOp::ADD
+        {OpCode::SUB, OpCode::PUSH},  // BinaryOp::SUB
+        {OpCode::MUL, OpCode::MULI},  // BinaryOp::MUL
+        {OpCode::DIV, OpCode::DIVI},  // BinaryOp::DIV
+        {OpCode::GT,  OpCode::PUSH},  // BinaryOp::GT
+        {OpCode::LT,  OpCode::PUSH},  // BinaryOp::LT
+        {OpCode::EQ,  OpCode::PUSH},  // BinaryOp::EQ
+        {OpCode::SHL, OpCode::SHL},   // BinaryOp::SHL (always immediate)
+        {OpCode::SHR, OpCode::SHR}    // BinaryOp::SHR (always immediate)
+    };
+
+    // Whether op with this literal right operand is emitted as a single
+    // instruction taking the literal as its operand (MULI, DIVI, SHL, SHR).
+    // Division by 0 keeps DIV so it still fails at run time; DIVI's
+    // reciprocal needs 2 <= |divisor| < 2^31.
+    constexpr bool hasImmediateForm(BinaryOp op, int32_t right) {
+        OpCode immediate = binaryOpcodes[static_cast<int>(op)][1];
+        if (immediate == OpCode::DIVI) {
+            return right != 0 && right != 1 && right != -1 && right != INT32_MIN;
+        }
+        return immediate != OpCode::PUSH;
+    }
+
+    // Opcode computing op, in its immediate form or taking both operands
+    // from the stack
+    constexpr OpCode binaryOpcode(BinaryOp op, bool immediate) {
+        return binaryOpcodes[static_cast<int>(op)][immediate ? 1 : 0];
+    }
+}
+
+#endif // OPCODE_TABLE_H
@@ -0,0 +1,476 @@
+#include "BytecodeEmitter.h"
+#include "../codegen/OpcodeTable.h"
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+namespace {
+
+// Position of the phi copies and the terminator, after every instruction
+const int END = INT_MAX;
+
+}
+
+Bytecode BytecodeEmitter::emit(IRFunction& target) {
+    function = &target;
+    bytecode = Bytecode();
+    function->splitCriticalEdges();
+
+    size_t count = function->values.size();
+    size_t blockCount = function->blocks.size();
+    findReachableBlocks();
+    uses = function->countUses();
+    positions.assign(count, -1);
+    useBlock.assign(count, -1);
+    usePosition.assign(count, -1);
+    user.assign(count, NO_VALUE);
+    inlined.assign(count, false);
+    effectful.assign(count, false);
+    slots.assign(count, -1);
+    scratchSlot = -1;
+    roots.assign(blockCount, {});
+    copies.assign(blockCount, {});
+
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        const BasicBlock& block = function->blocks[b];
+        for (size_t i = 0; i < block.instructions.size(); ++i) {
+            ValueId value = block.instructions[i];
+            const IRInstruction& instruction = function->values[value];
+            positions[value] = i;
+            for (size_t k = 0; k < instruction.operands.size(); ++k) {
+                ValueId operand = instruction.operands[k];
+                bool phi = instruction.opcode == IROpcode::PHI;
+                useBlock[operand] = phi ? block.predecessors[k] : b;
+                usePosition[operand] = phi ? END : static_cast<int>(i);
+                user[operand] = phi ? NO_VALUE : value;
+            }
+        }
+        if (block.terminator.kind == IRTerminator::Kind::BRANCH) {
+            useBlock[block.terminator.condition] = b;
+            usePosition[block.terminator.condition] = END;
+            user[block.terminator.condition] = NO_VALUE;
+        }
+    }
+
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        if (reachable[b]) chooseInlinedValues(b);
+    }
+
+    // Copies into the phis of the next block; critical edges are split, so
+    // a block with phi copies has no other successor
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        const BasicBlock& block = function->blocks[b];
+        if (!reachable[b] || block.terminator.kind != IRTerminator::Kind::JUMP) continue;
+
+        const BasicBlock& next = function->blocks[block.terminator.target];
+        for (size_t k = 0; k < next.predecessors.size(); ++k) {
+            if (next.predecessors[k] != b) continue;
+            for (ValueId phi : next.instructions) {
+                if (function->values[phi].opcode != IROpcode::PHI) break;
+                if (isStored(phi)) {
+                    copies[b].push_back({phi, function->values[phi].operands[k]});
+                }
+            }
+        }
+    }
+
+    assignSlots();
+
+    // A copy from the phi's own slot is no copy at all
+    for (auto& list : copies) {
+        std::vector<std::pair<ValueId, ValueId>> kept;
+        for (auto& copy : list) {
+            if (!isStored(copy.second) || slots[copy.second] != slots[copy.first]) {
+                kept.push_back(copy);
+            }
+        }
+        list = kept;
+    }
+
+    std::vector<BlockId> layout;
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        if (reachable[b] && resolveTarget(b) == b) {
+            layout.push_back(b);
+        }
+    }
+
+    std::vector<int> addresses(blockCount, -1);
+    std::vector<std::pair<int, BlockId>> jumps; // Jump instruction, target block
+    auto jumpTo = [&](OpCode opcode, BlockId block) {
+        jumps.push_back({bytecode.getCurrentAddress(), block});
+        bytecode.emit(opcode, 0); // Placeholder
+    };
+
+    for (size_t index = 0; index < layout.size(); ++index) {
+        BlockId b = layout[index];
+        BlockId next = index + 1 < layout.size() ? layout[index + 1] : -1;
+        const BasicBlock& block = function->blocks[b];
+        addresses[b] = bytecode.getCurrentAddress();
+
+        for (ValueId root : roots[b]) {
+            const IRInstruction& instruction = function->values[root];
+            if (instruction.opcode == IROpcode::PRINT) {
+                emitValue(instruction.operands[0]);
+                bytecode.emit(OpCode::PRINT);
+            } else {
+                emitComputation(root);
+                bytecode.emit(OpCode::STORE, slots[root] >= 0 ? slots[root] : scratchSlot);
+            }
+        }
+
+        // Every source is read before any phi slot is written
+        for (auto& copy : copies[b]) {
+            emitValue(copy.second);
+        }
+        for (auto copy = copies[b].rbegin(); copy != copies[b].rend(); ++copy) {
+            bytecode.emit(OpCode::STORE, slots[copy->first]);
+        }
+
+        const IRTerminator& terminator = block.terminator;
+        switch (terminator.kind) {
+            case IRTerminator::Kind::JUMP:
+                if (resolveTarget(terminator.target) != next) {
+                    jumpTo(OpCode::JMP, resolveTarget(terminator.target));
+                }
+                break;
+            case IRTerminator::Kind::BRANCH:
+                emitValue(terminator.condition);
+                if (terminator.location.isKnown()) {
+                    bytecode.addProbe({bytecode.getCurrentAddress(), terminator.location,
+                                       terminator.loopTest});
+                }
+                if (resolveTarget(terminator.falseTarget) == next) {
+                    jumpTo(OpCode::JMP_IF_TRUE, resolveTarget(terminator.target));
+                    break;
+                }
+                jumpTo(OpCode::JMP_IF_FALSE, resolveTarget(terminator.falseTarget));
+                if (resolveTarget(terminator.target) != next) {
+                    jumpTo(OpCode::JMP, resolveTarget(terminator.target));
+                }
+                break;
+            case IRTerminator::Kind::HALT:
+                bytecode.emit(OpCode::HALT);
+                break;
+        }
+    }
+
+    for (auto& jump : jumps) {
+        bytecode.patchJump(jump.first, addresses[jump.second]);
+    }
+    return bytecode;
+}
+
+void BytecodeEmitter::findReachableBlocks() {
+    reachable.assign(function->blocks.size(), false);
+    std::vector<BlockId> worklist = {0};
+    reachable[0] = true;
+    while (!worklist.empty()) {
+        BlockId block = worklist.back();
+        worklist.pop_back();
+        for (BlockId successor : function->blocks[block].successors()) {
+            if (!reachable[successor]) {
+                reachable[successor] = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+}
+
+// Inlines the values used once later in the same block, then takes back
+// the ones with side effects that would move past another side effect
+void BytecodeEmitter::chooseInlinedValues(BlockId b) {
+    const auto& list = function->blocks[b].instructions;
+    int size = list.size();
+    for (int i = 0; i < size; ++i) {
+        ValueId value = list[i];
+        if (function->values[value].opcode == IROpcode::BINARY && uses[value] == 1 &&
+            useBlock[value] == b && usePosition[value] > i) {
+            inlined[value] = true;
+        }
+    }
+
+    // Position size stands for END
+    auto positionOf = [&](int position) { return position == END ? size : position; };
+    std::vector<int> anchors(size, -1); // Position of the root evaluating each inlined value
+    std::vector<bool> effects(size + 1, false);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = size - 1; i >= 0; --i) {
+            ValueId value = list[i];
+            if (!inlined[value]) continue;
+            ValueId parent = user[value];
+            anchors[i] = parent != NO_VALUE && inlined[parent] ? anchors[positions[parent]]
+                                                               : positionOf(usePosition[value]);
+        }
+
+        std::fill(effects.begin(), effects.end(), false);
+        for (int i = 0; i < size; ++i) {
+            ValueId value = list[i];
+            if (function->hasSideEffects(value)) {
+                effects[inlined[value] ? anchors[i] : i] = true;
+            }
+        }
+        std::vector<int> before(size + 2, 0); // Roots with side effects before a position
+        for (int i = 0; i <= size; ++i) {
+            before[i + 1] = before[i] + (effects[i] ? 1 : 0);
+        }
+
+        for (int i = 0; i < size; ++i) {
+            ValueId value = list[i];
+            if (inlined[value] && function->hasSideEffects(value) &&
+                before[anchors[i]] - before[i + 1] > 0) {
+                inlined[value] = false;
+                changed = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < size; ++i) {
+        ValueId value = list[i];
+        IROpcode opcode = function->values[value].opcode;
+        if (inlined[value] || opcode == IROpcode::CONST || opcode == IROpcode::PHI) continue;
+
+        effectful[value] = effects[i];
+        // A root nobody reads is still evaluated for its side effects
+        if (uses[value] > 0 || effectful[value]) {
+            roots[b].push_back(value);
+        }
+    }
+}
+
+bool BytecodeEmitter::isStored(ValueId value) const {
+    const IRInstruction& instruction = function->values[value];
+    return (instruction.opcode == IROpcode::BINARY || instruction.opcode == IROpcode::PHI) &&
+           !inlined[value] && uses[value] > 0 && reachable[instruction.block];
+}
+
+// The stored values that evaluating value reads
+void BytecodeEmitter::collectLeaves(ValueId value, std::set<ValueId>& leaves) const {
+    if (isStored(value)) {
+        leaves.insert(value);
+        return;
+    }
+    if (inlined[value]) {
+        for (ValueId operand : function->values[value].operands) {
+            collectLeaves(operand, leaves);
+        }
+    }
+}
+
+// Liveness of the stored values, interference between them, phi
+// coalescing, and coloring of the coalesced webs into frame slots
+void BytecodeEmitter::assignSlots() {
+    size_t count = function->values.size();
+    size_t blockCount = function->blocks.size();
+
+    // Reads at the end of each block: phi copies and the branch condition
+    std::vector<std::set<ValueId>> endUses(blockCount);
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        for (auto& copy : copies[b]) {
+            collectLeaves(copy.second, endUses[b]);
+        }
+        const IRTerminator& terminator = function->blocks[b].terminator;
+        if (terminator.kind == IRTerminator::Kind::BRANCH) {
+            collectLeaves(terminator.condition, endUses[b]);
+        }
+    }
+
+    std::vector<std::set<ValueId>> gen(blockCount), kill(blockCount);
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        if (!reachable[b]) continue;
+        for (ValueId value : function->blocks[b].instructions) {
+            if (function->values[value].opcode == IROpcode::PHI && isStored(value)) {
+                kill[b].insert(value);
+            }
+        }
+        for (ValueId root : roots[b]) {
+            std::set<ValueId> leaves;
+            for (ValueId operand : function->values[root].operands) {
+                collectLeaves(operand, leaves);
+            }
+            for (ValueId leaf : leaves) {
+                if (!kill[b].count(leaf)) gen[b].insert(leaf);
+            }
+            if (isStored(root)) kill[b].insert(root);
+        }
+        for (ValueId leaf : endUses[b]) {
+            if (!kill[b].count(leaf)) gen[b].insert(leaf);
+        }
+    }
+
+    std::vector<std::set<ValueId>> liveIn(blockCount), liveOut(blockCount);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BlockId b = blockCount - 1; b >= 0; --b) {
+            if (!reachable[b]) continue;
+            std::set<ValueId> out;
+            for (BlockId successor : function->blocks[b].successors()) {
+                out.insert(liveIn[successor].begin(), liveIn[successor].end());
+            }
+            std::set<ValueId> in = gen[b];
+            for (ValueId value : out) {
+                if (!kill[b].count(value)) in.insert(value);
+            }
+            if (in != liveIn[b] || out != liveOut[b]) {
+                liveIn[b] = std::move(in);
+                liveOut[b] = std::move(out);
+                changed = true;
+            }
+        }
+    }
+
+    // Two values interfere when one is live where the other is defined
+    std::vector<std::set<ValueId>> interference(count);
+    auto interfere = [&](ValueId value, const std::set<ValueId>& live) {
+        for (ValueId other : live) {
+            if (other == value) continue;
+            interference[value].insert(other);
+            interference[other].insert(value);
+        }
+    };
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        if (!reachable[b]) continue;
+        std::set<ValueId> live = liveOut[b];
+        live.insert(endUses[b].begin(), endUses[b].end());
+        for (auto root = roots[b].rbegin(); root != roots[b].rend(); ++root) {
+            if (isStored(*root)) {
+                interfere(*root, live);
+                live.erase(*root);
+            }
+            for (ValueId operand : function->values[*root].operands) {
+                collectLeaves(operand, live);
+            }
+        }
+        for (ValueId value : function->blocks[b].instructions) {
+            if (function->values[value].opcode == IROpcode::PHI && isStored(value)) {
+                interfere(value, live);
+            }
+        }
+    }
+
+    // Coalesce each phi with the operands it does not interfere with
+    std::vector<ValueId> parent(count);
+    std::iota(parent.begin(), parent.end(), 0);
+    std::vector<std::vector<ValueId>> members(count);
+    for (ValueId value = 0; value < static_cast<ValueId>(count); ++value) {
+        members[value] = {value};
+    }
+    auto find = [&](ValueId value) {
+        while (parent[value] != value) value = parent[value];
+        return value;
+    };
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        if (!reachable[b]) continue;
+        for (ValueId phi : function->blocks[b].instructions) {
+            if (function->values[phi].opcode != IROpcode::PHI) break;
+            if (!isStored(phi)) continue;
+
+            for (ValueId operand : function->values[phi].operands) {
+                if (!isStored(operand)) continue;
+                ValueId left = find(phi);
+                ValueId right = find(operand);
+                if (left == right) continue;
+
+                bool disjoint = true;
+                for (ValueId a : members[left]) {
+                    for (ValueId c : members[right]) {
+                        if (interference[a].count(c)) disjoint = false;
+                    }
+                }
+                if (disjoint) {
+                    parent[right] = left;
+                    members[left].insert(members[left].end(), members[right].begin(),
+                                         members[right].end());
+                    members[right].clear();
+                }
+            }
+        }
+    }
+
+    // Greedy coloring in order of definition: each web takes the lowest
+    // slot that no web it interferes with holds
+    int frameSize = 0;
+    webCount = 0;
+    std::vector<int> webSlots(count, -1);
+    std::vector<bool> taken;
+    for (ValueId value = 0; value < static_cast<ValueId>(count); ++value) {
+        if (!isStored(value)) continue;
+        ValueId web = find(value);
+        if (webSlots[web] < 0) {
+            taken.assign(frameSize + 1, false);
+            for (ValueId member : members[web]) {
+                for (ValueId other : interference[member]) {
+                    int slot = webSlots[find(other)];
+                    if (slot >= 0) taken[slot] = true;
+                }
+            }
+            int slot = 0;
+            while (taken[slot]) slot++;
+            webSlots[web] = slot;
+            frameSize = std::max(frameSize, slot + 1);
+            webCount++;
+        }
+        slots[value] = webSlots[web];
+    }
+    for (const auto& list : roots) {
+        for (ValueId root : list) {
+            if (function->values[root].opcode == IROpcode::BINARY && slots[root] < 0 &&
+                scratchSlot < 0) {
+                scratchSlot = frameSize++;
+            }
+        }
+    }
+    bytecode.setFrameSize(frameSize);
+}
+
+bool BytecodeEmitter::emitsCode(BlockId block) const {
+    return block == 0 || !roots[block].empty() || !copies[block].empty() ||
+           function->blocks[block].terminator.kind != IRTerminator::Kind::JUMP;
+}
+
+// The first block from block on that emits code, following jumps through
+// empty blocks
+BlockId BytecodeEmitter::resolveTarget(BlockId block) const {
+    BlockId target = block;
+    for (size_t steps = 0; !emitsCode(target); ++steps) {
+        if (steps == function->blocks.size()) {
+            return block; // A cycle of empty blocks loops forever in place
+        }
+        target = function->blocks[target].terminator.target;
+    }
+    return target;
+}
+
+void BytecodeEmitter::emitValue(ValueId value) {
+    const IRInstruction& instruction = function->values[value];
+    if (instruction.opcode == IROpcode::CONST) {
+        bytecode.emit(OpCode::PUSH, instruction.constant);
+    } else if (slots[value] >= 0) {
+        bytecode.emit(OpCode::LOAD, slots[value]);
+    } else {
+        emitComputation(value);
+    }
+}
+
+// A literal right operand goes into the instruction when it has an
+// immediate form, and 0 - x becomes NEG
+void BytecodeEmitter::emitComputation(ValueId value) {
+    const IRInstruction& instruction = function->values[value];
+    const IRInstruction& left = function->values[instruction.operands[0]];
+    const IRInstruction& right = function->values[instruction.operands[1]];
+    BinaryOp op = instruction.binaryOp;
+
+    if (right.opcode == IROpcode::CONST && OpcodeTable::hasImmediateForm(op, right.constant)) {
+        emitValue(instruction.operands[0]);
+        bytecode.emit(OpcodeTable::binaryOpcode(op, true), right.constant);
+    } else if (op == BinaryOp::SUB && left.opcode == IROpcode::CONST && left.constant == 0) {
+        emitValue(instruction.operands[1]);
+        bytecode.emit(OpCode::NEG);
+    } else {
+        emitValue(instruction.operands[0]);
+        emitValue(instruction.operands[1]);
+        bytecode.emit(OpcodeTable::binaryOpcode(op, false));
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef BYTECODE_EMITTER_H
+#define BYTECODE_EMITTER_H
+
+#include <set>
+#include <vector>
+#include "../codegen/Bytecode.h"
+#include "IR.h"
+
+// Translates an IR function out of SSA form into stack bytecode:
+// - a value used once, later in its own block, is computed where it is
+//   used, so expression trees are evaluated on the stack; a value that
+//   can fail is not moved past a print or another value that can fail
+// - constants are pushed at every use
+// - every other value gets a frame slot. Phis are resolved by copies at
+//   the end of each predecessor (all sources are pushed before any slot
+//   is stored, so the copies happen at once), and a phi shares its slot
+//   with each operand whose lifetime does not overlap its own, which
+//   removes most copies
+// - the webs of values that share a slot are then colored by backward
+//   liveness: webs whose lifetimes never overlap get the same slot, so
+//   the frame only has as many slots as values live at once
+// - blocks are laid out in order; those that would hold only a jump are
+//   skipped, jumps to the next block become fallthroughs, and a branch
+//   whose false target is next jumps on true instead
+// - the conditional jump of every branch that comes from an if or a for
+//   gets a BranchProbe
+class BytecodeEmitter {
+private:
+    IRFunction* function;
+    Bytecode bytecode;
+
+    std::vector<bool> reachable;
+    std::vector<int> uses;
+    std::vector<int> positions;  // Index of each value in its block
+    // Where the last use of each value is (the only one, for values used
+    // once): block, position in it (END for phi copies and the terminator)
+    // and the using instruction (NO_VALUE at END)
+    std::vector<BlockId> useBlock;
+    std::vector<int> usePosition;
+    std::vector<ValueId> user;
+    std::vector<bool> inlined;   // Computed at its only use instead of being stored
+    std::vector<bool> effectful; // Root whose evaluation has side effects
+    std::vector<int> slots;      // Frame slot of each stored value, -1 if none
+    int scratchSlot;             // Result of a root with side effects nobody reads
+    int webCount;                // Slots needed without coloring
+
+    // Per block: instructions that are emitted in order (not inlined and
+    // not constants or phis), and the phi copies at its end
+    std::vector<std::vector<ValueId>> roots;
+    std::vector<std::vector<std::pair<ValueId, ValueId>>> copies; // Phi, source
+
+    void findReachableBlocks();
+    void chooseInlinedValues(BlockId block);
+    bool isStored(ValueId value) const;
+    void collectLeaves(ValueId value, std::set<ValueId>& leaves) const;
+    void assignSlots();
+
+    bool emitsCode(BlockId block) const;
+    BlockId resolveTarget(BlockId block) const;
+    void emitValue(ValueId value);
+    void emitComputation(ValueId value);
+
+public:
+    BytecodeEmitter() : function(nullptr), scratchSlot(-1), webCount(0) {}
+
+    // Splits the critical edges of function before translating it
+    Bytecode emit(IRFunction& function);
+
+    // Webs of coalesced values of the last emit(), each of which would
+    // need its own slot if they were not colored
+    int getWebCount() const { return webCount; }
+};
+
+#endif // BYTECODE_EMITTER_H
@@ -0,0 +1,98 @@
+#include "Dominators.h"
+#include <algorithm>
+
+DominatorTree::DominatorTree(const IRFunction& function)
+    : orderIndex(function.blocks.size(), -1), idom(function.blocks.size(), -1),
+      children(function.blocks.size()), enter(function.blocks.size(), -1),
+      leave(function.blocks.size(), -1) {
+    if (function.blocks.empty()) {
+        return;
+    }
+
+    // Postorder by an explicit depth-first search from the entry
+    std::vector<bool> visited(function.blocks.size(), false);
+    std::vector<std::pair<BlockId, size_t>> stack = {{0, 0}};
+    std::vector<std::vector<BlockId>> successors(function.blocks.size());
+    visited[0] = true;
+    successors[0] = function.blocks[0].successors();
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < successors[block].size()) {
+            BlockId successor = successors[block][next++];
+            if (!visited[successor]) {
+                visited[successor] = true;
+                successors[successor] = function.blocks[successor].successors();
+                stack.push_back({successor, 0});
+            }
+        } else {
+            order.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    for (size_t i = 0; i < order.size(); ++i) {
+        orderIndex[order[i]] = i;
+    }
+
+    // Each block's dominator is the common dominator of its processed
+    // predecessors; repeat until nothing changes (loops need a second pass)
+    idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            BlockId block = order[i];
+            BlockId dominator = -1;
+            for (BlockId pred : function.blocks[block].predecessors) {
+                if (!isReachable(pred) || idom[pred] < 0) continue;
+                dominator = dominator < 0 ? pred : intersect(pred, dominator);
+            }
+            if (idom[block] != dominator) {
+                idom[block] = dominator;
+                changed = true;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < order.size(); ++i) {
+        children[idom[order[i]]].push_back(order[i]);
+    }
+
+    // Preorder intervals make dominance queries constant time
+    int counter = 0;
+    std::vector<std::pair<BlockId, size_t>> walk = {{0, 0}};
+    enter[0] = counter++;
+    while (!walk.empty()) {
+        auto& [block, next] = walk.back();
+        if (next < children[block].size()) {
+            BlockId child = children[block][next++];
+            enter[child] = counter++;
+            walk.push_back({child, 0});
+        } else {
+            leave[block] = counter;
+            walk.pop_back();
+        }
+    }
+}
+
+BlockId DominatorTree::intersect(BlockId a, BlockId b) const {
+    while (a != b) {
+        while (orderIndex[a] > orderIndex[b]) a = idom[a];
+        while (orderIndex[b] > orderIndex[a]) b = idom[b];
+    }
+    return a;
+}
+
+BlockId DominatorTree::immediateDominator(BlockId block) const {
+    if (block == 0 || !isReachable(block)) {
+        return -1;
+    }
+    return idom[block];
+}
+
+bool DominatorTree::dominates(BlockId a, BlockId b) const {
+    if (!isReachable(a) || !isReachable(b)) {
+        return false;
+    }
+    return enter[a] <= enter[b] && leave[b] <= leave[a];
+}
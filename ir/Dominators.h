@@ -0,0 +1,34 @@
+#ifndef DOMINATORS_H
+#define DOMINATORS_H
+
+#include <vector>
+#include "IR.h"
+
+// Dominator tree of the blocks reachable from the entry. Block a
+// dominates block b when every path from the entry to b passes through
+// a. Computed with the iterative algorithm of Cooper, Harvey and Kennedy
+// ("A Simple, Fast Dominance Algorithm") over reverse postorder.
+class DominatorTree {
+private:
+    std::vector<BlockId> order;      // Reverse postorder of the reachable blocks
+    std::vector<int> orderIndex;     // Block -> position in order, -1 if unreachable
+    std::vector<BlockId> idom;       // Immediate dominator; the entry is its own
+    std::vector<std::vector<BlockId>> children;
+    std::vector<int> enter, leave;   // Preorder interval of each block in the tree
+
+    BlockId intersect(BlockId a, BlockId b) const;
+
+public:
+    explicit DominatorTree(const IRFunction& function);
+
+    bool isReachable(BlockId block) const { return orderIndex[block] >= 0; }
+    // -1 for the entry and for unreachable blocks
+    BlockId immediateDominator(BlockId block) const;
+    // Reflexive: every reachable block dominates itself
+    bool dominates(BlockId a, BlockId b) const;
+
+    const std::vector<BlockId>& reversePostorder() const { return order; }
+    const std::vector<BlockId>& getChildren(BlockId block) const { return children[block]; }
+};
+
+#endif // DOMINATORS_H
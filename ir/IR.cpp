@@ -0,0 +1,322 @@
+#include "IR.h"
+#include "Dominators.h"
+#include <algorithm>
+#include <sstream>
+
+std::vector<BlockId> BasicBlock::successors() const {
+    switch (terminator.kind) {
+        case IRTerminator::Kind::JUMP:
+            return {terminator.target};
+        case IRTerminator::Kind::BRANCH:
+            return {terminator.target, terminator.falseTarget};
+        default:
+            return {};
+    }
+}
+
+BlockId IRFunction::addBlock() {
+    blocks.emplace_back();
+    return blocks.size() - 1;
+}
+
+void IRFunction::addEdge(BlockId from, BlockId to) {
+    blocks[to].predecessors.push_back(from);
+}
+
+void IRFunction::removeEdge(BlockId from, BlockId to) {
+    auto& preds = blocks[to].predecessors;
+    size_t k = std::find(preds.begin(), preds.end(), from) - preds.begin();
+    preds.erase(preds.begin() + k);
+    for (ValueId value : blocks[to].instructions) {
+        if (values[value].opcode != IROpcode::PHI) break;
+        values[value].operands.erase(values[value].operands.begin() + k);
+    }
+}
+
+ValueId IRFunction::addConstant(BlockId block, int32_t constant) {
+    IRInstruction instruction(IROpcode::CONST, block);
+    instruction.constant = constant;
+    values.push_back(instruction);
+    blocks[block].instructions.push_back(values.size() - 1);
+    return values.size() - 1;
+}
+
+ValueId IRFunction::addBinary(BlockId block, BinaryOp op, ValueId left, ValueId right) {
+    IRInstruction instruction(IROpcode::BINARY, block);
+    instruction.binaryOp = op;
+    instruction.operands = {left, right};
+    values.push_back(instruction);
+    blocks[block].instructions.push_back(values.size() - 1);
+    return values.size() - 1;
+}
+
+ValueId IRFunction::addPrint(BlockId block, ValueId operand) {
+    IRInstruction instruction(IROpcode::PRINT, block);
+    instruction.operands = {operand};
+    values.push_back(instruction);
+    blocks[block].instructions.push_back(values.size() - 1);
+    return values.size() - 1;
+}
+
+ValueId IRFunction::addPhi(BlockId block) {
+    values.push_back(IRInstruction(IROpcode::PHI, block));
+    ValueId phi = values.size() - 1;
+
+    auto& list = blocks[block].instructions;
+    auto position = list.begin();
+    while (position != list.end() && values[*position].opcode == IROpcode::PHI) {
+        ++position;
+    }
+    list.insert(position, phi);
+    return phi;
+}
+
+bool IRFunction::hasSideEffects(ValueId value) const {
+    const IRInstruction& instruction = values[value];
+    if (instruction.opcode == IROpcode::PRINT) {
+        return true;
+    }
+    if (instruction.opcode != IROpcode::BINARY || instruction.binaryOp != BinaryOp::DIV) {
+        return false;
+    }
+    const IRInstruction& divisor = values[instruction.operands[1]];
+    return divisor.opcode != IROpcode::CONST || divisor.constant == 0;
+}
+
+void IRFunction::replaceAllUses(ValueId from, ValueId to) {
+    for (auto& instruction : values) {
+        if (instruction.opcode == IROpcode::REMOVED) continue;
+        for (auto& operand : instruction.operands) {
+            if (operand == from) operand = to;
+        }
+    }
+    for (auto& block : blocks) {
+        if (block.terminator.condition == from) {
+            block.terminator.condition = to;
+        }
+    }
+}
+
+void IRFunction::remove(ValueId value) {
+    auto& list = blocks[values[value].block].instructions;
+    list.erase(std::find(list.begin(), list.end(), value));
+    values[value].opcode = IROpcode::REMOVED;
+    values[value].operands.clear();
+}
+
+int IRFunction::splitCriticalEdges() {
+    int added = 0;
+    for (BlockId from = 0; from < static_cast<BlockId>(blocks.size()); ++from) {
+        if (blocks[from].terminator.kind != IRTerminator::Kind::BRANCH) continue;
+
+        for (bool taken : {true, false}) {
+            IRTerminator& terminator = blocks[from].terminator;
+            BlockId to = taken ? terminator.target : terminator.falseTarget;
+            if (blocks[to].predecessors.size() < 2) continue;
+
+            BlockId edge = addBlock(); // Invalidates terminator
+            blocks[edge].terminator.kind = IRTerminator::Kind::JUMP;
+            blocks[edge].terminator.target = to;
+            blocks[edge].predecessors.push_back(from);
+            (taken ? blocks[from].terminator.target : blocks[from].terminator.falseTarget) = edge;
+
+            auto& preds = blocks[to].predecessors;
+            *std::find(preds.begin(), preds.end(), from) = edge;
+            added++;
+        }
+    }
+    return added;
+}
+
+std::vector<int> IRFunction::countUses() const {
+    std::vector<int> uses(values.size(), 0);
+    for (const auto& instruction : values) {
+        if (instruction.opcode == IROpcode::REMOVED) continue;
+        for (ValueId operand : instruction.operands) {
+            uses[operand]++;
+        }
+    }
+    for (const auto& block : blocks) {
+        if (block.terminator.kind == IRTerminator::Kind::BRANCH) {
+            uses[block.terminator.condition]++;
+        }
+    }
+    return uses;
+}
+
+int IRFunction::instructionCount() const {
+    int count = 0;
+    for (const auto& block : blocks) {
+        count += block.instructions.size();
+    }
+    return count;
+}
+
+std::vector<std::string> IRFunction::verify() const {
+    std::vector<std::string> errors;
+    auto fail = [&](const std::string& message) { errors.push_back(message); };
+
+    // Predecessor lists must list every edge once
+    std::vector<std::vector<BlockId>> expected(blocks.size());
+    for (BlockId b = 0; b < static_cast<BlockId>(blocks.size()); ++b) {
+        for (BlockId successor : blocks[b].successors()) {
+            if (successor < 0 || successor >= static_cast<BlockId>(blocks.size())) {
+                fail("b" + std::to_string(b) + " jumps to a missing block");
+                return errors;
+            }
+            expected[successor].push_back(b);
+        }
+    }
+    for (BlockId b = 0; b < static_cast<BlockId>(blocks.size()); ++b) {
+        auto actual = blocks[b].predecessors;
+        std::sort(actual.begin(), actual.end());
+        std::sort(expected[b].begin(), expected[b].end());
+        if (actual != expected[b]) {
+            fail("predecessors of b" + std::to_string(b) + " do not match the terminators");
+        }
+    }
+    if (!errors.empty()) {
+        return errors;
+    }
+
+    DominatorTree dominators(*this);
+    std::vector<int> position(values.size(), -1);
+    for (BlockId b = 0; b < static_cast<BlockId>(blocks.size()); ++b) {
+        for (size_t i = 0; i < blocks[b].instructions.size(); ++i) {
+            position[blocks[b].instructions[i]] = i;
+        }
+    }
+
+    // Whether operand is available at position index of block b
+    auto available = [&](ValueId operand, BlockId b, int index) {
+        if (operand < 0 || operand >= static_cast<ValueId>(values.size()) ||
+            values[operand].opcode == IROpcode::REMOVED) {
+            return false;
+        }
+        BlockId defBlock = values[operand].block;
+        if (defBlock == b) {
+            return position[operand] < index;
+        }
+        return dominators.dominates(defBlock, b);
+    };
+
+    for (BlockId b = 0; b < static_cast<BlockId>(blocks.size()); ++b) {
+        if (!dominators.isReachable(b)) continue;
+        const BasicBlock& block = blocks[b];
+        bool phis = true;
+
+        for (size_t i = 0; i < block.instructions.size(); ++i) {
+            ValueId value = block.instructions[i];
+            const IRInstruction& instruction = values[value];
+            std::string name = "%" + std::to_string(value);
+            if (instruction.block != b || instruction.opcode == IROpcode::REMOVED) {
+                fail(name + " is listed in b" + std::to_string(b) + " but does not belong there");
+                continue;
+            }
+
+            if (instruction.opcode == IROpcode::PHI) {
+                if (!phis) fail(name + " is a phi after other instructions");
+                if (instruction.operands.size() != block.predecessors.size()) {
+                    fail(name + " has " + std::to_string(instruction.operands.size()) +
+                         " operands for " + std::to_string(block.predecessors.size()) +
+                         " predecessors");
+                    continue;
+                }
+                for (size_t k = 0; k < instruction.operands.size(); ++k) {
+                    BlockId pred = block.predecessors[k];
+                    if (dominators.isReachable(pred) &&
+                        !available(instruction.operands[k], pred, blocks[pred].instructions.size())) {
+                        fail(name + " uses a value that is not available at the end of b" +
+                             std::to_string(pred));
+                    }
+                }
+                continue;
+            }
+
+            phis = false;
+            for (ValueId operand : instruction.operands) {
+                if (!available(operand, b, i)) {
+                    fail(name + " uses a value that does not dominate it");
+                }
+            }
+        }
+
+        if (block.terminator.kind == IRTerminator::Kind::BRANCH &&
+            !available(block.terminator.condition, b, block.instructions.size())) {
+            fail("the branch of b" + std::to_string(b) + " uses a value that does not dominate it");
+        }
+    }
+    return errors;
+}
+
+std::string IRFunction::valueToString(ValueId value) const {
+    const IRInstruction& instruction = values[value];
+    std::ostringstream oss;
+    if (instruction.opcode != IROpcode::PRINT) {
+        oss << "%" << value << " = ";
+    }
+
+    switch (instruction.opcode) {
+        case IROpcode::CONST:
+            oss << instruction.constant;
+            break;
+        case IROpcode::BINARY:
+            oss << "%" << instruction.operands[0] << " " << binaryOpSymbol(instruction.binaryOp)
+                << " %" << instruction.operands[1];
+            break;
+        case IROpcode::PHI: {
+            const auto& preds = blocks[instruction.block].predecessors;
+            oss << "phi";
+            for (size_t k = 0; k < instruction.operands.size(); ++k) {
+                oss << (k == 0 ? " " : ", ") << "[%" << instruction.operands[k] << ", b"
+                    << (k < preds.size() ? preds[k] : -1) << "]";
+            }
+            break;
+        }
+        case IROpcode::PRINT:
+            oss << "print %" << instruction.operands[0];
+            break;
+        case IROpcode::REMOVED:
+            oss << "removed";
+            break;
+    }
+
+    if (!instruction.variable.empty()) {
+        oss << "  ; " << instruction.variable;
+    }
+    return oss.str();
+}
+
+std::string IRFunction::toString() const {
+    std::ostringstream oss;
+    for (BlockId b = 0; b < static_cast<BlockId>(blocks.size()); ++b) {
+        const BasicBlock& block = blocks[b];
+        oss << "b" << b << ":";
+        if (!block.predecessors.empty()) {
+            oss << "  ; preds";
+            for (BlockId pred : block.predecessors) {
+                oss << " b" << pred;
+            }
+        }
+        oss << "\n";
+
+        for (ValueId value : block.instructions) {
+            oss << "  " << valueToString(value) << "\n";
+        }
+
+        const IRTerminator& terminator = block.terminator;
+        switch (terminator.kind) {
+            case IRTerminator::Kind::JUMP:
+                oss << "  jump b" << terminator.target << "\n";
+                break;
+            case IRTerminator::Kind::BRANCH:
+                oss << "  branch %" << terminator.condition << ", b" << terminator.target
+                    << ", b" << terminator.falseTarget << "\n";
+                break;
+            case IRTerminator::Kind::HALT:
+                oss << "  halt\n";
+                break;
+        }
+    }
+    return oss.str();
+}
@@ -0,0 +1,112 @@
+#ifndef IR_H
+#define IR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../ast/BinaryOp.h"
+#include "../ast/SourceLocation.h"
+
+// Mid-level intermediate representation between the AST and bytecode: a
+// control flow graph of basic blocks over values in static single
+// assignment (SSA) form. Every instruction defines one value, numbered by
+// its index in the function, and values never change once defined. The
+// variables of the source program disappear; each assignment produces a
+// new value, and phi instructions choose between the values that reach a
+// block along different edges.
+
+using ValueId = int;
+using BlockId = int;
+
+const ValueId NO_VALUE = -1;
+
+enum class IROpcode {
+    CONST,   // The literal constant
+    BINARY,  // binaryOp applied to operands[0] and operands[1]
+    PHI,     // operands[k] when control came from predecessors[k]
+    PRINT,   // Prints operands[0]; its value is never used
+    REMOVED  // Deleted by a pass; the number is not reused
+};
+
+struct IRInstruction {
+    IROpcode opcode;
+    BinaryOp binaryOp;             // BINARY
+    int32_t constant;              // CONST
+    std::vector<ValueId> operands;
+    BlockId block;
+    std::string variable;          // Source variable holding the value, for printing
+
+    IRInstruction(IROpcode op, BlockId parent)
+        : opcode(op), binaryOp(BinaryOp::ADD), constant(0), block(parent) {}
+};
+
+struct IRTerminator {
+    enum class Kind { JUMP, BRANCH, HALT };
+
+    Kind kind;
+    ValueId condition;   // BRANCH
+    BlockId target;      // JUMP, or BRANCH when the condition is nonzero
+    BlockId falseTarget; // BRANCH when the condition is 0
+    // BRANCH: the if or for statement it comes from, and whether it is
+    // the test of a for loop (whose condition is "done")
+    SourceLocation location;
+    bool loopTest;
+
+    IRTerminator()
+        : kind(Kind::HALT), condition(NO_VALUE), target(-1), falseTarget(-1), loopTest(false) {}
+};
+
+struct BasicBlock {
+    std::vector<ValueId> instructions; // Phis first, then in execution order
+    IRTerminator terminator;
+    std::vector<BlockId> predecessors; // In the order of phi operands
+
+    std::vector<BlockId> successors() const;
+};
+
+class IRFunction {
+public:
+    std::vector<IRInstruction> values; // Indexed by ValueId
+    std::vector<BasicBlock> blocks;    // Indexed by BlockId; block 0 is the entry
+
+    BlockId addBlock();
+    // Records from as a predecessor of to; the terminator of from must
+    // be set to match
+    void addEdge(BlockId from, BlockId to);
+    // Removes from from the predecessors of to, with the matching phi
+    // operands; the terminator of from must be changed to match
+    void removeEdge(BlockId from, BlockId to);
+
+    // Append to the end of block
+    ValueId addConstant(BlockId block, int32_t constant);
+    ValueId addBinary(BlockId block, BinaryOp op, ValueId left, ValueId right);
+    ValueId addPrint(BlockId block, ValueId operand);
+    // Inserted after the existing phis of block, with no operands yet
+    ValueId addPhi(BlockId block);
+
+    // Whether executing value can do something besides computing it:
+    // print, or fail on a division by zero
+    bool hasSideEffects(ValueId value) const;
+
+    void replaceAllUses(ValueId from, ValueId to);
+    void remove(ValueId value);
+
+    // Puts an empty block on every edge from a block with several
+    // successors to a block with several predecessors, so that code for
+    // the edge has a place of its own. Returns the number of new blocks.
+    int splitCriticalEdges();
+
+    // Number of uses of each value by instructions and terminators
+    std::vector<int> countUses() const;
+    int instructionCount() const;
+
+    // Broken invariants (operands that are undefined or do not dominate
+    // their uses, phis out of place, predecessor lists that disagree with
+    // the terminators), one message each; empty when the function is valid
+    std::vector<std::string> verify() const;
+
+    std::string valueToString(ValueId value) const;
+    std::string toString() const;
+};
+
+#endif // IR_H
@@ -0,0 +1,305 @@
+#include "IRBuilder.h"
+
+IRFunction IRBuilder::build(Program& program) {
+    function = IRFunction();
+    definitions.clear();
+    sealed.clear();
+    incompletePhis.clear();
+    replacements.clear();
+    slotNames.clear();
+    hotThenBranches = 0;
+
+    program.accept(*this);
+    return std::move(function);
+}
+
+BlockId IRBuilder::newBlock() {
+    BlockId block = function.addBlock();
+    definitions.emplace_back(frameSize, NO_VALUE);
+    sealed.push_back(false);
+    incompletePhis.emplace_back();
+    return block;
+}
+
+// All predecessors of block are known: fill in the placeholder phis
+void IRBuilder::sealBlock(BlockId block) {
+    auto pending = std::move(incompletePhis[block]);
+    incompletePhis[block].clear();
+    for (auto& [slot, phi] : pending) {
+        addPhiOperands(slot, phi);
+    }
+    sealed[block] = true;
+}
+
+ValueId IRBuilder::lower(Expression& expr) {
+    expr.accept(*this);
+    return result;
+}
+
+void IRBuilder::writeVariable(int slot, BlockId block, ValueId value) {
+    definitions[block][slot] = value;
+}
+
+ValueId IRBuilder::readVariable(int slot, BlockId block) {
+    ValueId value = definitions[block][slot];
+    if (value != NO_VALUE) {
+        return resolve(value);
+    }
+    return readVariableRecursive(slot, block);
+}
+
+ValueId IRBuilder::readVariableRecursive(int slot, BlockId block) {
+    const auto& preds = function.blocks[block].predecessors;
+    ValueId value;
+    if (!sealed[block]) {
+        value = function.addPhi(block);
+        function.values[value].variable = slotNames[slot];
+        incompletePhis[block].push_back({slot, value});
+    } else if (preds.empty()) {
+        value = function.addConstant(block, 0);
+    } else if (preds.size() == 1) {
+        value = readVariable(slot, preds[0]);
+    } else {
+        // Written before the operands are read, so that a cycle through a
+        // loop ends at this phi
+        value = function.addPhi(block);
+        function.values[value].variable = slotNames[slot];
+        writeVariable(slot, block, value);
+        value = addPhiOperands(slot, value);
+    }
+    writeVariable(slot, block, value);
+    return value;
+}
+
+ValueId IRBuilder::addPhiOperands(int slot, ValueId phi) {
+    BlockId block = function.values[phi].block;
+    for (size_t k = 0; k < function.blocks[block].predecessors.size(); ++k) {
+        ValueId operand = readVariable(slot, function.blocks[block].predecessors[k]);
+        function.values[phi].operands.push_back(operand);
+    }
+    return tryRemoveTrivialPhi(phi);
+}
+
+// A phi whose operands are all the same value (or the phi itself) stands
+// for that value
+ValueId IRBuilder::tryRemoveTrivialPhi(ValueId phi) {
+    ValueId same = NO_VALUE;
+    for (ValueId operand : function.values[phi].operands) {
+        operand = resolve(operand);
+        if (operand == same || operand == phi) continue;
+        if (same != NO_VALUE) {
+            return phi;
+        }
+        same = operand;
+    }
+    if (same == NO_VALUE) {
+        same = function.addConstant(0, 0); // Never assigned on any path
+    }
+
+    replacements.resize(function.values.size(), NO_VALUE);
+    replacements[phi] = same;
+    function.remove(phi);
+    return same;
+}
+
+ValueId IRBuilder::resolve(ValueId value) const {
+    while (value < static_cast<ValueId>(replacements.size()) && replacements[value] != NO_VALUE) {
+        value = replacements[value];
+    }
+    return value;
+}
+
+// Points every use of a removed phi at its value, then removes the phis
+// that became trivial because of that
+void IRBuilder::removeTrivialPhis() {
+    for (auto& instruction : function.values) {
+        for (auto& operand : instruction.operands) {
+            operand = resolve(operand);
+        }
+    }
+    for (auto& block : function.blocks) {
+        if (block.terminator.kind == IRTerminator::Kind::BRANCH) {
+            block.terminator.condition = resolve(block.terminator.condition);
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (ValueId phi = 0; phi < static_cast<ValueId>(function.values.size()); ++phi) {
+            if (function.values[phi].opcode != IROpcode::PHI) continue;
+
+            ValueId same = NO_VALUE;
+            bool trivial = true;
+            for (ValueId operand : function.values[phi].operands) {
+                if (operand == same || operand == phi) continue;
+                if (same != NO_VALUE) {
+                    trivial = false;
+                    break;
+                }
+                same = operand;
+            }
+            if (trivial && same != NO_VALUE) {
+                function.replaceAllUses(phi, same);
+                function.remove(phi);
+                changed = true;
+            }
+        }
+    }
+}
+
+void IRBuilder::visit(NumberExpression& node) {
+    result = function.addConstant(current, node.value);
+}
+
+void IRBuilder::visit(VariableExpression& node) {
+    result = readVariable(node.slot, current);
+}
+
+void IRBuilder::visit(BinaryExpression& node) {
+    ValueId left = lower(*node.left);
+    ValueId right = lower(*node.right);
+    result = function.addBinary(current, node.op, left, right);
+}
+
+void IRBuilder::visit(VariableDeclaration& node) {
+    ValueId value = lower(*node.initializer);
+    if (function.values[value].variable.empty()) {
+        function.values[value].variable = node.name;
+    }
+    slotNames[node.slot] = node.name;
+    writeVariable(node.slot, current, value);
+}
+
+void IRBuilder::visit(PrintStatement& node) {
+    function.addPrint(current, lower(*node.expression));
+}
+
+void IRBuilder::visit(BlockStatement& node) {
+    for (auto& stmt : node.statements) {
+        stmt->accept(*this);
+    }
+}
+
+void IRBuilder::visit(IfStatement& node) {
+    ValueId condition = lower(*node.condition);
+    BlockId conditionBlock = current;
+
+    // Lowers one branch into new blocks; returns its first and last block
+    auto lowerBranch = [&](Statement& branch) {
+        BlockId first = newBlock();
+        function.addEdge(conditionBlock, first);
+        sealBlock(first);
+        current = first;
+        branch.accept(*this);
+        return std::make_pair(first, current);
+    };
+
+    bool thenLast = false;
+    if (profile && node.elseBranch) {
+        const ProfileSite* site = profile->find(node.location, ProfileSite::Kind::IF);
+        thenLast = site && site->takenRatio() > 0.5;
+    }
+
+    std::pair<BlockId, BlockId> thenBlocks, elseBlocks(-1, -1);
+    if (thenLast) {
+        elseBlocks = lowerBranch(*node.elseBranch);
+        thenBlocks = lowerBranch(*node.thenBranch);
+        hotThenBranches++;
+    } else {
+        thenBlocks = lowerBranch(*node.thenBranch);
+        if (node.elseBranch) {
+            elseBlocks = lowerBranch(*node.elseBranch);
+        }
+    }
+    BlockId thenBlock = thenBlocks.first;
+    BlockId thenEnd = thenBlocks.second;
+    BlockId elseBlock = elseBlocks.first;
+    BlockId elseEnd = elseBlocks.second;
+
+    BlockId join = newBlock();
+    if (elseBlock < 0) {
+        elseBlock = join;
+        function.addEdge(conditionBlock, join);
+    }
+    function.addEdge(thenEnd, join);
+    function.blocks[thenEnd].terminator.kind = IRTerminator::Kind::JUMP;
+    function.blocks[thenEnd].terminator.target = join;
+    if (elseEnd >= 0) {
+        function.addEdge(elseEnd, join);
+        function.blocks[elseEnd].terminator.kind = IRTerminator::Kind::JUMP;
+        function.blocks[elseEnd].terminator.target = join;
+    }
+
+    IRTerminator& branch = function.blocks[conditionBlock].terminator;
+    branch.kind = IRTerminator::Kind::BRANCH;
+    branch.condition = condition;
+    branch.target = thenBlock;
+    branch.falseTarget = elseBlock;
+    branch.location = node.location;
+
+    sealBlock(join);
+    current = join;
+}
+
+void IRBuilder::visit(ForStatement& node) {
+    ValueId start = lower(*node.start);
+    if (function.values[start].variable.empty()) {
+        function.values[start].variable = node.variable;
+    }
+    slotNames[node.slot] = node.variable;
+    writeVariable(node.slot, current, start);
+
+    // The header compares the variable with the end, evaluated again
+    // every iteration; its second predecessor is the end of the body
+    BlockId header = newBlock();
+    function.addEdge(current, header);
+    function.blocks[current].terminator.kind = IRTerminator::Kind::JUMP;
+    function.blocks[current].terminator.target = header;
+    current = header;
+    ValueId variable = readVariable(node.slot, header);
+    ValueId end = lower(*node.end);
+    ValueId done = function.addBinary(header, BinaryOp::GT, variable, end);
+
+    BlockId body = newBlock();
+    function.addEdge(header, body);
+    sealBlock(body);
+    current = body;
+    node.body->accept(*this);
+
+    ValueId last = readVariable(node.slot, current);
+    ValueId next = function.addBinary(current, BinaryOp::ADD, last,
+                                      function.addConstant(current, 1));
+    writeVariable(node.slot, current, next);
+    function.addEdge(current, header);
+    function.blocks[current].terminator.kind = IRTerminator::Kind::JUMP;
+    function.blocks[current].terminator.target = header;
+    sealBlock(header);
+
+    BlockId exit = newBlock();
+    function.addEdge(header, exit);
+    sealBlock(exit);
+
+    IRTerminator& branch = function.blocks[header].terminator;
+    branch.kind = IRTerminator::Kind::BRANCH;
+    branch.condition = done;
+    branch.target = exit;
+    branch.falseTarget = body;
+    branch.location = node.location;
+    branch.loopTest = true;
+    current = exit;
+}
+
+void IRBuilder::visit(Program& node) {
+    frameSize = node.frameSize;
+    slotNames.assign(frameSize, "");
+
+    current = newBlock();
+    sealBlock(current);
+    for (auto& stmt : node.statements) {
+        stmt->accept(*this);
+    }
+    function.blocks[current].terminator.kind = IRTerminator::Kind::HALT;
+
+    removeTrivialPhis();
+}
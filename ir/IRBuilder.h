@@ -0,0 +1,72 @@
+#ifndef IR_BUILDER_H
+#define IR_BUILDER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "../ast/AST.h"
+#include "IR.h"
+#include "../vm/Profile.h"
+
+// Lowers an analyzed program (variables must have their frame slots) into
+// SSA form, in one pass over the tree with the algorithm of Braun et al.
+// ("Simple and Efficient Construction of Static Single Assignment Form"):
+// each block remembers the value last assigned to every slot, a read
+// looks the value up through the predecessors, and phis are placed only
+// where different values meet. A loop header is "sealed" once the end of
+// the body is known; until then reads through it get placeholder phis
+// whose operands are filled in at sealing.
+//
+// Blocks are laid out in the order they are made. Given a profile, an if
+// whose then branch ran more often than its else branch gets its else
+// branch made first, so that the hot path jumps straight to the then
+// branch and falls through to the join instead of jumping over the else.
+class IRBuilder : public ASTVisitor {
+private:
+    IRFunction function;
+    BlockId current;
+    ValueId result; // Value of the last expression visited
+    int frameSize;
+    const Profile* profile;
+    int hotThenBranches; // Ifs laid out with the then branch last
+
+    std::vector<std::vector<ValueId>> definitions; // [block][slot] -> value
+    std::vector<bool> sealed;
+    std::vector<std::vector<std::pair<int, ValueId>>> incompletePhis; // Per block: slot, phi
+    std::vector<ValueId> replacements; // Removed phi -> the value it stood for
+    std::vector<std::string> slotNames; // Variable last declared in each slot
+
+    BlockId newBlock();
+    void sealBlock(BlockId block);
+    ValueId lower(Expression& expr);
+
+    void writeVariable(int slot, BlockId block, ValueId value);
+    ValueId readVariable(int slot, BlockId block);
+    ValueId readVariableRecursive(int slot, BlockId block);
+    ValueId addPhiOperands(int slot, ValueId phi);
+    ValueId tryRemoveTrivialPhi(ValueId phi);
+    ValueId resolve(ValueId value) const;
+    void removeTrivialPhis();
+
+public:
+    explicit IRBuilder(const Profile* branchProfile = nullptr)
+        : current(0), result(NO_VALUE), frameSize(0), profile(branchProfile),
+          hotThenBranches(0) {}
+
+    // Slots never assigned before a read hold 0, as in the VM
+    IRFunction build(Program& program);
+
+    int getHotThenBranches() const { return hotThenBranches; }
+
+    void visit(NumberExpression& node) override;
+    void visit(VariableExpression& node) override;
+    void visit(BinaryExpression& node) override;
+    void visit(VariableDeclaration& node) override;
+    void visit(PrintStatement& node) override;
+    void visit(BlockStatement& node) override;
+    void visit(IfStatement& node) override;
+    void visit(ForStatement& node) override;
+    void visit(Program& node) override;
+};
+
+#endif // IR_BUILDER_H
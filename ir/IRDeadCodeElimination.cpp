@@ -0,0 +1,45 @@
+#include "IRDeadCodeElimination.h"
+
+int IRDeadCodeElimination::run(IRFunction& function, std::vector<std::string>& log) {
+    std::vector<bool> live(function.values.size(), false);
+    std::vector<ValueId> worklist;
+
+    for (const auto& block : function.blocks) {
+        for (ValueId value : block.instructions) {
+            if (function.hasSideEffects(value)) {
+                live[value] = true;
+                worklist.push_back(value);
+            }
+        }
+        if (block.terminator.kind == IRTerminator::Kind::BRANCH &&
+            !live[block.terminator.condition]) {
+            live[block.terminator.condition] = true;
+            worklist.push_back(block.terminator.condition);
+        }
+    }
+
+    while (!worklist.empty()) {
+        ValueId value = worklist.back();
+        worklist.pop_back();
+        for (ValueId operand : function.values[value].operands) {
+            if (!live[operand]) {
+                live[operand] = true;
+                worklist.push_back(operand);
+            }
+        }
+    }
+
+    int removed = 0;
+    for (ValueId value = 0; value < static_cast<ValueId>(function.values.size()); ++value) {
+        const IRInstruction& instruction = function.values[value];
+        if (live[value] || instruction.opcode == IROpcode::REMOVED) continue;
+
+        // Constants are not worth a line each
+        if (instruction.opcode != IROpcode::CONST) {
+            log.push_back("IR dead code: " + function.valueToString(value) + " removed");
+        }
+        function.remove(value);
+        removed++;
+    }
+    return removed;
+}
@@ -0,0 +1,16 @@
+#ifndef IR_DEAD_CODE_ELIMINATION_H
+#define IR_DEAD_CODE_ELIMINATION_H
+
+#include "IRPass.h"
+
+// Removes every value that no print, branch or possibly failing division
+// depends on, directly or through other values. Liveness is propagated
+// from those roots, so unused phis that only feed each other around a
+// loop are removed too.
+class IRDeadCodeElimination : public IRPass {
+public:
+    std::string getName() const override { return "ir-dead-code-elimination"; }
+    int run(IRFunction& function, std::vector<std::string>& log) override;
+};
+
+#endif // IR_DEAD_CODE_ELIMINATION_H
@@ -0,0 +1,46 @@
+#include "IRPass.h"
+#include <chrono>
+#include <stdexcept>
+
+void IRPassManager::addPass(std::unique_ptr<IRPass> pass) {
+    statistics.push_back({pass->getName(), 0, 0, 0.0});
+    passes.push_back(std::move(pass));
+}
+
+int IRPassManager::run(IRFunction& function, std::vector<std::string>& log) {
+    for (auto& stats : statistics) {
+        stats.runs = 0;
+        stats.rewrites = 0;
+        stats.milliseconds = 0.0;
+    }
+
+    int total = 0;
+    rounds = 0;
+    bool changed = true;
+
+    while (changed && rounds < maxRounds) {
+        changed = false;
+        rounds++;
+
+        for (size_t i = 0; i < passes.size(); ++i) {
+            auto start = std::chrono::steady_clock::now();
+            int rewrites = passes[i]->run(function, log);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            statistics[i].milliseconds += elapsed.count();
+            statistics[i].runs++;
+            statistics[i].rewrites += rewrites;
+            total += rewrites;
+            changed = changed || rewrites > 0;
+
+            if (rewrites > 0) {
+                auto errors = function.verify();
+                if (!errors.empty()) {
+                    throw std::logic_error("IR pass " + statistics[i].name + " produced invalid IR: " +
+                                           errors.front());
+                }
+            }
+        }
+    }
+
+    return total;
+}
@@ -0,0 +1,53 @@
+#ifndef IR_PASS_H
+#define IR_PASS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "IR.h"
+
+// A transformation of an IR function, the SSA counterpart of
+// OptimizationPass. Passes see whole functions and may use the dominator
+// tree (ir/Dominators.h) for global analyses.
+class IRPass {
+public:
+    virtual ~IRPass() = default;
+
+    virtual std::string getName() const = 0;
+
+    // Rewrites function in place and appends one line per rewrite to log.
+    // Returns the number of rewrites; 0 means the function is unchanged.
+    virtual int run(IRFunction& function, std::vector<std::string>& log) = 0;
+};
+
+struct IRPassStatistics {
+    std::string name;
+    int runs;
+    int rewrites;
+    double milliseconds; // Wall time of all runs, without verification
+};
+
+// Runs the registered passes in order, round after round, until a whole
+// round changes nothing (or maxRounds is reached). The function is
+// verified after every pass that changed it; a pass that breaks an
+// invariant throws std::logic_error.
+class IRPassManager {
+private:
+    std::vector<std::unique_ptr<IRPass>> passes;
+    std::vector<IRPassStatistics> statistics;
+    int maxRounds;
+    int rounds;
+
+public:
+    explicit IRPassManager(int maxRoundCount = 16) : maxRounds(maxRoundCount), rounds(0) {}
+
+    void addPass(std::unique_ptr<IRPass> pass);
+
+    // Returns the total number of rewrites
+    int run(IRFunction& function, std::vector<std::string>& log);
+
+    const std::vector<IRPassStatistics>& getStatistics() const { return statistics; }
+    int getRounds() const { return rounds; }
+};
+
+#endif // IR_PASS_H
@@ -0,0 +1,162 @@
+#include "LocalValueNumbering.h"
+#include "../codegen/OpcodeTable.h"
+#include <sstream>
+#include <utility>
+
+int LocalValueNumbering::run(IRFunction& target, std::vector<std::string>& log) {
+    function = &target;
+    size_t count = function->values.size();
+    numbers.resize(count);
+    for (ValueId value = 0; value < static_cast<ValueId>(count); ++value) {
+        numbers[value] = value;
+    }
+    uses = function->countUses();
+
+    int rewrites = 0;
+    for (BlockId b = 0; b < static_cast<BlockId>(function->blocks.size()); ++b) {
+        // Number the block first, collecting the repeats of every value
+        std::map<Key, ValueId> table;
+        std::vector<ValueId> computed; // Values that have repeats, in block order
+        std::map<ValueId, std::vector<ValueId>> repeats;
+        for (ValueId value : function->blocks[b].instructions) {
+            IROpcode opcode = function->values[value].opcode;
+            if (opcode != IROpcode::CONST && opcode != IROpcode::BINARY) continue;
+
+            auto inserted = table.insert({keyOf(value), value});
+            if (inserted.second) continue;
+            ValueId earlier = inserted.first->second;
+            numbers[value] = earlier;
+
+            // Constants are pushed at every use anyway
+            if (opcode == IROpcode::BINARY) {
+                auto& list = repeats[earlier];
+                if (list.empty()) computed.push_back(earlier);
+                list.push_back(value);
+            }
+        }
+
+        // Larger expressions come later in the block; reusing them first
+        // leaves the repeats of their parts unused
+        for (auto earlier = computed.rbegin(); earlier != computed.rend(); ++earlier) {
+            rewrites += reuse(*earlier, repeats[*earlier], log);
+        }
+    }
+    return rewrites;
+}
+
+// A repeat used once is computed where it is used and becomes a LOAD; one
+// used more often also loses its STORE. The earlier value needs a slot, a
+// STORE and a LOAD of its own if it was computed at its only use so far.
+int LocalValueNumbering::reuse(ValueId earlier, const std::vector<ValueId>& list,
+                               std::vector<std::string>& log) {
+    std::vector<ValueId> used;
+    int saved = 0;
+    for (ValueId value : list) {
+        if (uses[value] == 0) continue;
+        int cost = computeCost(value);
+        saved += uses[value] == 1 ? cost - 1 : cost + 1;
+        used.push_back(value);
+    }
+    if (used.empty() || uses[earlier] == 0) {
+        return 0;
+    }
+    bool newSlot = uses[earlier] == 1;
+    if (newSlot) {
+        saved -= 2;
+    }
+    if (saved <= 0) {
+        return 0;
+    }
+
+    if (newSlot && temporaries >= maxTemporaries) {
+        if (!limitReported) {
+            log.push_back("Local value numbering: the limit of " + std::to_string(maxTemporaries) +
+                          " temporaries is reached, so %" + std::to_string(earlier) +
+                          " and other repeated values are recomputed");
+            limitReported = true;
+        }
+        return 0;
+    }
+    if (newSlot) {
+        temporaries++;
+    }
+
+    std::ostringstream oss;
+    oss << "Local value numbering: %" << earlier;
+    if (!function->values[earlier].variable.empty()) {
+        oss << " (" << function->values[earlier].variable << ")";
+    }
+    oss << " is reused for";
+    for (ValueId value : used) {
+        oss << " %" << value;
+    }
+    oss << ", saving " << saved << " instructions each time b"
+        << function->values[earlier].block << " runs";
+    log.push_back(oss.str());
+
+    for (ValueId value : used) {
+        function->replaceAllUses(value, earlier);
+        uses[earlier] += uses[value];
+        uses[value] = 0;
+        release(value);
+    }
+    return used.size();
+}
+
+LocalValueNumbering::Key LocalValueNumbering::keyOf(ValueId value) const {
+    const IRInstruction& instruction = function->values[value];
+    if (instruction.opcode == IROpcode::CONST) {
+        return Key(-1, instruction.constant, NO_VALUE, NO_VALUE);
+    }
+
+    BinaryOp op = instruction.binaryOp;
+    ValueId left = numbers[instruction.operands[0]];
+    ValueId right = numbers[instruction.operands[1]];
+    if (op == BinaryOp::GT) {
+        op = BinaryOp::LT;
+        std::swap(left, right);
+    } else if ((op == BinaryOp::ADD || op == BinaryOp::MUL || op == BinaryOp::EQ) && left > right) {
+        std::swap(left, right);
+    }
+    return Key(static_cast<int>(op), 0, left, right);
+}
+
+// Mirrors the instruction selection of BytecodeEmitter: immediate right
+// operands and NEG for 0 - x
+int LocalValueNumbering::computeCost(ValueId value) const {
+    const IRInstruction& instruction = function->values[value];
+    if (instruction.opcode != IROpcode::BINARY) {
+        return 1;
+    }
+
+    const IRInstruction& left = function->values[instruction.operands[0]];
+    const IRInstruction& right = function->values[instruction.operands[1]];
+    int cost = 1;
+    if (!(instruction.binaryOp == BinaryOp::SUB && left.opcode == IROpcode::CONST && left.constant == 0)) {
+        cost += operandCost(instruction.operands[0], instruction.block);
+    }
+    if (!(right.opcode == IROpcode::CONST &&
+          OpcodeTable::hasImmediateForm(instruction.binaryOp, right.constant))) {
+        cost += operandCost(instruction.operands[1], instruction.block);
+    }
+    return cost;
+}
+
+// Values used once in their own block are computed in place; others are
+// loaded from their slot
+int LocalValueNumbering::operandCost(ValueId operand, BlockId block) const {
+    const IRInstruction& instruction = function->values[operand];
+    if (instruction.opcode == IROpcode::BINARY && uses[operand] == 1 && instruction.block == block) {
+        return computeCost(operand);
+    }
+    return 1;
+}
+
+void LocalValueNumbering::release(ValueId value) {
+    for (ValueId operand : function->values[value].operands) {
+        if (--uses[operand] == 0 && function->values[operand].opcode == IROpcode::BINARY &&
+            !function->hasSideEffects(operand)) {
+            release(operand);
+        }
+    }
+}
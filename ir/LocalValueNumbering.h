@@ -0,0 +1,62 @@
+#ifndef LOCAL_VALUE_NUMBERING_H
+#define LOCAL_VALUE_NUMBERING_H
+
+#include <map>
+#include <tuple>
+#include "IRPass.h"
+
+// Common subexpression elimination by local value numbering. Within each
+// block, values are numbered so that two instructions get the same number
+// when they compute the same operation on operands with the same numbers
+// (constants by their value; + * == and swapped > < in either operand
+// order). In SSA form an operand never changes once defined, so an
+// instruction whose number already belongs to an earlier instruction of
+// the block recomputes that value, and its uses can take the earlier
+// value instead; the repeat is left to dead code elimination.
+//
+// Reusing a value costs a frame slot when it was computed in place at its
+// only use until then (BytecodeEmitter stores values used more than
+// once), plus a STORE and a LOAD, so the repeats of a value are only
+// replaced when together they cost more instructions than that: a + 1
+// computed twice stays, three times it is reused. Repeats that are not
+// worth it still share the number, so an expression built on them can be
+// reused whole:
+//   print (a + i) * b + (a + i) * b;
+// computes (a + i) * b once. maxTemporaries bounds the number of values
+// given a slot this way over all runs of the pass, which trades frame
+// size against the instructions saved.
+class LocalValueNumbering : public IRPass {
+private:
+    // Operation and operand numbers
+    using Key = std::tuple<int, int, ValueId, ValueId>;
+
+    IRFunction* function;
+    int maxTemporaries;
+    int temporaries;              // Values given a slot so far
+    bool limitReported;
+    std::vector<ValueId> numbers; // Value -> earliest equivalent value of its block
+    std::vector<int> uses;
+
+    Key keyOf(ValueId value) const;
+    // Replaces the repeats of earlier if that saves instructions; returns
+    // the number replaced
+    int reuse(ValueId earlier, const std::vector<ValueId>& repeats, std::vector<std::string>& log);
+    // Instructions BytecodeEmitter emits to compute value, and to get the
+    // value of an operand of an instruction in block
+    int computeCost(ValueId value) const;
+    int operandCost(ValueId operand, BlockId block) const;
+    // Drops the uses of a value nothing uses anymore from its operands
+    void release(ValueId value);
+
+public:
+    explicit LocalValueNumbering(int maxTemporaryCount = 16)
+        : function(nullptr), maxTemporaries(maxTemporaryCount), temporaries(0),
+          limitReported(false) {}
+
+    std::string getName() const override { return "local-value-numbering"; }
+    int run(IRFunction& function, std::vector<std::string>& log) override;
+
+    int getTemporaries() const { return temporaries; }
+};
+
+#endif // LOCAL_VALUE_NUMBERING_H
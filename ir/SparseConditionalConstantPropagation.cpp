@@ -0,0 +1,281 @@
+#include "SparseConditionalConstantPropagation.h"
+#include <algorithm>
+#include <sstream>
+
+int SparseConditionalConstantPropagation::run(IRFunction& target, std::vector<std::string>& log) {
+    function = &target;
+    analyze();
+    return rewrite(log);
+}
+
+void SparseConditionalConstantPropagation::analyze() {
+    size_t count = function->values.size();
+    size_t blockCount = function->blocks.size();
+    lattice.assign(count, Lattice::UNKNOWN);
+    constants.assign(count, 0);
+    executable.assign(blockCount, false);
+    taken.assign(blockCount, {});
+    users.assign(count, {});
+    branches.assign(count, {});
+    edgeWorklist.clear();
+    valueWorklist.clear();
+
+    for (BlockId b = 0; b < static_cast<BlockId>(blockCount); ++b) {
+        const BasicBlock& block = function->blocks[b];
+        taken[b].assign(block.predecessors.size(), false);
+        for (ValueId value : block.instructions) {
+            for (ValueId operand : function->values[value].operands) {
+                users[operand].push_back(value);
+            }
+        }
+        if (block.terminator.kind == IRTerminator::Kind::BRANCH) {
+            branches[block.terminator.condition].push_back(b);
+        }
+    }
+
+    executable[0] = true;
+    for (ValueId value : function->blocks[0].instructions) {
+        visitInstruction(value);
+    }
+    visitTerminator(0);
+
+    while (!edgeWorklist.empty() || !valueWorklist.empty()) {
+        while (!edgeWorklist.empty()) {
+            BlockId to = edgeWorklist.back().second;
+            edgeWorklist.pop_back();
+
+            // A block is analyzed in full the first time it is reached;
+            // later edges can only change its phis
+            bool first = !executable[to];
+            executable[to] = true;
+            for (ValueId value : function->blocks[to].instructions) {
+                if (!first && function->values[value].opcode != IROpcode::PHI) break;
+                visitInstruction(value);
+            }
+            if (first) {
+                visitTerminator(to);
+            }
+        }
+
+        while (!valueWorklist.empty()) {
+            ValueId value = valueWorklist.back();
+            valueWorklist.pop_back();
+            for (ValueId user : users[value]) {
+                if (executable[function->values[user].block]) {
+                    visitInstruction(user);
+                }
+            }
+            for (BlockId block : branches[value]) {
+                if (executable[block]) {
+                    visitTerminator(block);
+                }
+            }
+        }
+    }
+}
+
+void SparseConditionalConstantPropagation::markEdge(BlockId from, BlockId to) {
+    const auto& preds = function->blocks[to].predecessors;
+    bool added = false;
+    for (size_t k = 0; k < preds.size(); ++k) {
+        if (preds[k] == from && !taken[to][k]) {
+            taken[to][k] = true;
+            added = true;
+        }
+    }
+    if (added) {
+        edgeWorklist.push_back({from, to});
+    }
+}
+
+void SparseConditionalConstantPropagation::visitInstruction(ValueId value) {
+    const IRInstruction& instruction = function->values[value];
+    switch (instruction.opcode) {
+        case IROpcode::CONST:
+            lower(value, Lattice::CONSTANT, instruction.constant);
+            break;
+
+        case IROpcode::BINARY: {
+            ValueId left = instruction.operands[0];
+            ValueId right = instruction.operands[1];
+            if (lattice[left] == Lattice::VARYING || lattice[right] == Lattice::VARYING) {
+                lower(value, Lattice::VARYING, 0);
+            } else if (lattice[left] == Lattice::CONSTANT && lattice[right] == Lattice::CONSTANT) {
+                // Division by zero is left to fail at run time
+                int32_t result = 0;
+                if (evaluateBinaryOp(instruction.binaryOp, constants[left], constants[right], result)) {
+                    lower(value, Lattice::CONSTANT, result);
+                } else {
+                    lower(value, Lattice::VARYING, 0);
+                }
+            }
+            break;
+        }
+
+        case IROpcode::PHI: {
+            Lattice state = Lattice::UNKNOWN;
+            int32_t constant = 0;
+            for (size_t k = 0; k < instruction.operands.size(); ++k) {
+                ValueId operand = instruction.operands[k];
+                if (!taken[instruction.block][k] || lattice[operand] == Lattice::UNKNOWN) continue;
+
+                if (lattice[operand] == Lattice::VARYING ||
+                    (state == Lattice::CONSTANT && constants[operand] != constant)) {
+                    state = Lattice::VARYING;
+                    break;
+                }
+                state = Lattice::CONSTANT;
+                constant = constants[operand];
+            }
+            lower(value, state, constant);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void SparseConditionalConstantPropagation::visitTerminator(BlockId block) {
+    const IRTerminator& terminator = function->blocks[block].terminator;
+    switch (terminator.kind) {
+        case IRTerminator::Kind::JUMP:
+            markEdge(block, terminator.target);
+            break;
+        case IRTerminator::Kind::BRANCH: {
+            Lattice condition = lattice[terminator.condition];
+            if (condition == Lattice::CONSTANT) {
+                markEdge(block, constants[terminator.condition] != 0 ? terminator.target
+                                                                     : terminator.falseTarget);
+            } else if (condition == Lattice::VARYING) {
+                markEdge(block, terminator.target);
+                markEdge(block, terminator.falseTarget);
+            }
+            break;
+        }
+        case IRTerminator::Kind::HALT:
+            break;
+    }
+}
+
+// Values only move down the lattice
+void SparseConditionalConstantPropagation::lower(ValueId value, Lattice state, int32_t constant) {
+    if (state == Lattice::UNKNOWN || lattice[value] == Lattice::VARYING) {
+        return;
+    }
+    if (lattice[value] == Lattice::CONSTANT) {
+        if (state == Lattice::CONSTANT && constant == constants[value]) {
+            return;
+        }
+        state = Lattice::VARYING;
+    }
+    lattice[value] = state;
+    constants[value] = constant;
+    valueWorklist.push_back(value);
+}
+
+int SparseConditionalConstantPropagation::rewrite(std::vector<std::string>& log) {
+    int rewrites = 0;
+    auto isPhi = [&](ValueId value) { return function->values[value].opcode == IROpcode::PHI; };
+
+    for (BlockId b = 0; b < static_cast<BlockId>(function->blocks.size()); ++b) {
+        if (!executable[b]) continue;
+        auto& list = function->blocks[b].instructions;
+        for (ValueId value : list) {
+            IRInstruction& instruction = function->values[value];
+            if (lattice[value] != Lattice::CONSTANT ||
+                (instruction.opcode != IROpcode::BINARY && instruction.opcode != IROpcode::PHI)) {
+                continue;
+            }
+
+            std::ostringstream oss;
+            oss << "Sparse constant propagation: %" << value;
+            if (!instruction.variable.empty()) {
+                oss << " (" << instruction.variable << ")";
+            }
+            oss << " is always " << constants[value];
+            log.push_back(oss.str());
+            rewrites++;
+
+            instruction.opcode = IROpcode::CONST;
+            instruction.constant = constants[value];
+            instruction.operands.clear();
+        }
+        // Former phis stay ahead of the other instructions
+        std::stable_partition(list.begin(), list.end(), isPhi);
+
+        IRTerminator& terminator = function->blocks[b].terminator;
+        if (terminator.kind != IRTerminator::Kind::BRANCH ||
+            terminator.target == terminator.falseTarget) {
+            continue;
+        }
+        bool toTarget = false;
+        bool toFalseTarget = false;
+        for (BlockId successor : {terminator.target, terminator.falseTarget}) {
+            const auto& preds = function->blocks[successor].predecessors;
+            for (size_t k = 0; k < preds.size(); ++k) {
+                if (preds[k] == b && taken[successor][k]) {
+                    (successor == terminator.target ? toTarget : toFalseTarget) = true;
+                }
+            }
+        }
+        if (toTarget != toFalseTarget) {
+            BlockId kept = toTarget ? terminator.target : terminator.falseTarget;
+            function->removeEdge(b, toTarget ? terminator.falseTarget : terminator.target);
+            terminator.kind = IRTerminator::Kind::JUMP;
+            terminator.target = kept;
+            terminator.condition = NO_VALUE;
+            log.push_back("Sparse constant propagation: the branch of b" + std::to_string(b) +
+                          " always goes to b" + std::to_string(kept));
+            rewrites++;
+        }
+    }
+
+    for (BlockId b = 0; b < static_cast<BlockId>(function->blocks.size()); ++b) {
+        BasicBlock& block = function->blocks[b];
+        if (executable[b] || (block.instructions.empty() && block.predecessors.empty() &&
+                              block.terminator.kind == IRTerminator::Kind::HALT)) {
+            continue;
+        }
+
+        for (BlockId successor : block.successors()) {
+            function->removeEdge(b, successor);
+        }
+        block.terminator = IRTerminator();
+        int removed = block.instructions.size();
+        auto instructions = block.instructions;
+        for (ValueId value : instructions) {
+            function->remove(value);
+        }
+        log.push_back("Sparse constant propagation: b" + std::to_string(b) + " never runs (" +
+                      std::to_string(removed) + " instructions removed)");
+        rewrites++;
+    }
+    for (BlockId b = 0; b < static_cast<BlockId>(function->blocks.size()); ++b) {
+        if (!executable[b]) {
+            function->blocks[b].predecessors.clear();
+        }
+    }
+
+    // Phis left with a single incoming edge stand for its value
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (BlockId b = 0; b < static_cast<BlockId>(function->blocks.size()); ++b) {
+            auto phis = function->blocks[b].instructions;
+            for (ValueId phi : phis) {
+                if (!isPhi(phi)) break;
+                const auto& operands = function->values[phi].operands;
+                if (operands.empty() || operands[0] == phi ||
+                    !std::all_of(operands.begin(), operands.end(),
+                                 [&](ValueId operand) { return operand == operands[0]; })) {
+                    continue;
+                }
+                function->replaceAllUses(phi, operands[0]);
+                function->remove(phi);
+                changed = true;
+            }
+        }
+    }
+    return rewrites;
+}
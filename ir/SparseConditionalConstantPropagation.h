@@ -0,0 +1,46 @@
+#ifndef SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H
+#define SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H
+
+#include "IRPass.h"
+
+// Sparse conditional constant propagation (Wegman and Zadeck). Every
+// value starts at "unknown" on the lattice unknown > constant c >
+// varying, and only moves down. Blocks are only analyzed once an edge
+// into them is known to be taken, and a phi only meets the values on
+// taken edges, so a variable that a loop or branch assigns the same
+// constant stays constant, and code behind a branch that always goes
+// the same way is never considered.
+//
+// Afterwards, values that are constant become constants (their operands
+// are left to dead code elimination), branches that always go the same
+// way become jumps, and blocks that never run are emptied and cut off.
+class SparseConditionalConstantPropagation : public IRPass {
+private:
+    enum class Lattice { UNKNOWN, CONSTANT, VARYING };
+
+    IRFunction* function;
+    std::vector<Lattice> lattice;
+    std::vector<int32_t> constants;           // Value, when CONSTANT
+    std::vector<std::vector<bool>> taken;     // [block][predecessor index]
+    std::vector<bool> executable;
+    std::vector<std::vector<ValueId>> users;  // Instructions using each value
+    std::vector<std::vector<BlockId>> branches; // Blocks branching on each value
+    std::vector<std::pair<BlockId, BlockId>> edgeWorklist;
+    std::vector<ValueId> valueWorklist;
+
+    void analyze();
+    void markEdge(BlockId from, BlockId to);
+    void visitInstruction(ValueId value);
+    void visitTerminator(BlockId block);
+    void lower(ValueId value, Lattice state, int32_t constant);
+
+    int rewrite(std::vector<std::string>& log);
+
+public:
+    SparseConditionalConstantPropagation() : function(nullptr) {}
+
+    std::string getName() const override { return "sparse-conditional-constant-propagation"; }
+    int run(IRFunction& function, std::vector<std::string>& log) override;
+};
+
+#endif // SPARSE_CONDITIONAL_CONSTANT_PROPAGATION_H
@@ -2,7 +2,7 @@
 #include <cctype>
 
 Lexer::Lexer(const std::string& src) 
-    : source(src), position(0), line(1), column(1) {
+    : source(src), position(0), line(1), column(1), symbols(&ownSymbols) {
     // Initialize keywords
     keywords["let"] = TokenType::LET;
     keywords["print"] = TokenType::PRINT;
@@ -12,6 +12,17 @@ Lexer::Lexer(const std::string& src)
     keywords["to"] = TokenType::TO;
 }
 
+Lexer::Lexer(const std::string& src, SymbolInterner& externalSymbols)
+    : Lexer(src) {
+    symbols = &externalSymbols;
+}
+
+void Lexer::seek(size_t offset, int startLine, int startColumn) {
+    position = offset;
+    line = startLine;
+    column = startColumn;
+}
+
 char Lexer::currentChar() {
     if (position >= source.length()) {
         return '\0';
@@ -55,6 +66,7 @@ void Lexer::skipComment() {
 Token Lexer::makeNumber() {
     int startLine = line;
     int startColumn = column;
+    size_t startOffset = position;
     std::string number;
     
     while (std::isdigit(currentChar())) {
@@ -62,12 +74,13 @@ Token Lexer::makeNumber() {
         advance();
     }
     
-    return Token(TokenType::NUMBER, number, startLine, startColumn);
+    return Token(TokenType::NUMBER, number, startLine, startColumn, startOffset);
 }
 
 Token Lexer::makeIdentifierOrKeyword() {
     int startLine = line;
     int startColumn = column;
+    size_t startOffset = position;
     std::string identifier;
     
     while (std::isalnum(currentChar()) || currentChar() == '_') {
@@ -78,99 +91,78 @@ Token Lexer::makeIdentifierOrKeyword() {
     // Check if it's a keyword
     auto it = keywords.find(identifier);
     if (it != keywords.end()) {
-        return Token(it->second, identifier, startLine, startColumn);
+        return Token(it->second, identifier, startLine, startColumn, startOffset);
     }
     
-    return Token(TokenType::IDENTIFIER, identifier, startLine, startColumn);
+    Token token(TokenType::IDENTIFIER, identifier, startLine, startColumn, startOffset);
+    token.symbol = symbols->intern(identifier);
+    return token;
 }
 
-std::vector<Token> Lexer::tokenize() {
-    tokens.clear();
-    
-    while (currentChar() != '\0') {
+Token Lexer::nextToken() {
+    // Whitespace and comments can alternate any number of times, e.g. a
+    // comment followed by its newline and another comment
+    while (true) {
         skipWhitespace();
-        skipComment();
-        
-        if (currentChar() == '\0') break;
-        
-        int startLine = line;
-        int startColumn = column;
-        char ch = currentChar();
-        
-        // Numbers
-        if (std::isdigit(ch)) {
-            tokens.push_back(makeNumber());
-            continue;
-        }
-        
-        // Identifiers and keywords
-        if (std::isalpha(ch) || ch == '_') {
-            tokens.push_back(makeIdentifierOrKeyword());
-            continue;
+        if (currentChar() == '/' && peek() == '/') {
+            skipComment();
+        } else {
+            break;
         }
-        
-        // Single character tokens
-        switch (ch) {
-            case '+':
-                tokens.push_back(Token(TokenType::PLUS, "+", startLine, startColumn));
-                advance();
-                break;
-            case '-':
-                tokens.push_back(Token(TokenType::MINUS, "-", startLine, startColumn));
-                advance();
-                break;
-            case '*':
-                tokens.push_back(Token(TokenType::MULTIPLY, "*", startLine, startColumn));
-                advance();
-                break;
-            case '/':
-                tokens.push_back(Token(TokenType::DIVIDE, "/", startLine, startColumn));
-                advance();
-                break;
-            case ';':
-                tokens.push_back(Token(TokenType::SEMICOLON, ";", startLine, startColumn));
-                advance();
-                break;
-            case '{':
-                tokens.push_back(Token(TokenType::LBRACE, "{", startLine, startColumn));
-                advance();
-                break;
-            case '}':
-                tokens.push_back(Token(TokenType::RBRACE, "}", startLine, startColumn));
-                advance();
-                break;
-            case '(':
-                tokens.push_back(Token(TokenType::LPAREN, "(", startLine, startColumn));
-                advance();
-                break;
-            case ')':
-                tokens.push_back(Token(TokenType::RPAREN, ")", startLine, startColumn));
-                advance();
-                break;
-            case '=':
-                advance();
-                if (currentChar() == '=') {
-                    tokens.push_back(Token(TokenType::EQUAL, "==", startLine, startColumn));
-                    advance();
-                } else {
-                    tokens.push_back(Token(TokenType::ASSIGN, "=", startLine, startColumn));
-                }
-                break;
-            case '>':
-                tokens.push_back(Token(TokenType::GREATER, ">", startLine, startColumn));
-                advance();
-                break;
-            case '<':
-                tokens.push_back(Token(TokenType::LESS, "<", startLine, startColumn));
-                advance();
-                break;
-            default:
-                tokens.push_back(Token(TokenType::INVALID, std::string(1, ch), startLine, startColumn));
+    }
+    
+    int startLine = line;
+    int startColumn = column;
+    size_t startOffset = position;
+    char ch = currentChar();
+    
+    if (ch == '\0') {
+        return Token(TokenType::END_OF_FILE, "", startLine, startColumn, startOffset);
+    }
+    
+    // Numbers
+    if (std::isdigit(ch)) {
+        return makeNumber();
+    }
+    
+    // Identifiers and keywords
+    if (std::isalpha(ch) || ch == '_') {
+        return makeIdentifierOrKeyword();
+    }
+    
+    TokenType type;
+    switch (ch) {
+        case '+': type = TokenType::PLUS; break;
+        case '-': type = TokenType::MINUS; break;
+        case '*': type = TokenType::MULTIPLY; break;
+        case '/': type = TokenType::DIVIDE; break;
+        case ';': type = TokenType::SEMICOLON; break;
+        case '{': type = TokenType::LBRACE; break;
+        case '}': type = TokenType::RBRACE; break;
+        case '(': type = TokenType::LPAREN; break;
+        case ')': type = TokenType::RPAREN; break;
+        case '>': type = TokenType::GREATER; break;
+        case '<': type = TokenType::LESS; break;
+        case '=':
+            advance();
+            if (currentChar() == '=') {
                 advance();
-                break;
-        }
+                return Token(TokenType::EQUAL, "==", startLine, startColumn, startOffset);
+            }
+            return Token(TokenType::ASSIGN, "=", startLine, startColumn, startOffset);
+        default: type = TokenType::INVALID; break;
     }
     
-    tokens.push_back(Token(TokenType::END_OF_FILE, "", line, column));
+    advance();
+    return Token(type, std::string(1, ch), startLine, startColumn, startOffset);
+}
+
+std::vector<Token> Lexer::tokenize() {
+    tokens.clear();
+    
+    do {
+        tokens.push_back(nextToken());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
+    
     return tokens;
 }
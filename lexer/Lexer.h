@@ -14,6 +14,8 @@ private:
     int column;
     std::vector<Token> tokens;
     std::map<std::string, TokenType> keywords;
+    SymbolInterner ownSymbols;
+    SymbolInterner* symbols; // ownSymbols unless an external table was given
     
     char currentChar();
     char peek();
@@ -25,8 +27,23 @@ private:
     
 public:
     Lexer(const std::string& src);
+    // Interns identifiers into an existing table, so that SymbolIds stay
+    // stable across lexers run over successive versions of one source
+    Lexer(const std::string& src, SymbolInterner& externalSymbols);
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
+    
     std::vector<Token> tokenize();
+    
+    // Scans a single token; returns END_OF_FILE once the source is exhausted
+    Token nextToken();
+    // Restarts scanning at a token boundary. The scanner has no state other
+    // than its position, so lexing from the start offset of an earlier token
+    // reproduces the rest of the stream exactly.
+    void seek(size_t offset, int startLine, int startColumn);
+    
     const std::vector<Token>& getTokens() const { return tokens; }
+    const SymbolInterner& getSymbols() const { return *symbols; }
 };
 
 #endif // LEXER_H
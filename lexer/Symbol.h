@@ -0,0 +1,41 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Compact handle for an interned identifier. Ids are dense (0, 1, 2, ...)
+// so later passes can keep per-variable state in plain vectors.
+using SymbolId = uint32_t;
+const SymbolId INVALID_SYMBOL = UINT32_MAX;
+
+class SymbolInterner {
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, SymbolId> ids;
+
+public:
+    SymbolId intern(const std::string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+
+        SymbolId id = names.size();
+        names.push_back(name);
+        ids.emplace(name, id);
+        return id;
+    }
+
+    SymbolId lookup(const std::string& name) const {
+        auto it = ids.find(name);
+        return it != ids.end() ? it->second : INVALID_SYMBOL;
+    }
+
+    const std::string& getName(SymbolId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+};
+
+#endif // SYMBOL_H
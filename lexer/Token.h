@@ -3,6 +3,7 @@
 
 #include <string>
 #include <map>
+#include "Symbol.h"
 
 enum class TokenType {
     // Keywords
@@ -44,9 +45,12 @@ struct Token {
     std::string lexeme;
     int line;
     int column;
+    size_t offset;   // Byte offset of the first character in the source
+    SymbolId symbol; // Interned name for IDENTIFIER tokens
     
-    Token(TokenType t = TokenType::INVALID, const std::string& lex = "", int l = 0, int c = 0)
-        : type(t), lexeme(lex), line(l), column(c) {}
+    Token(TokenType t = TokenType::INVALID, const std::string& lex = "", int l = 0, int c = 0,
+          size_t off = 0)
+        : type(t), lexeme(lex), line(l), column(c), offset(off), symbol(INVALID_SYMBOL) {}
     
     std::string getTypeName() const {
         static const std::map<TokenType, std::string> typeNames = {
@@ -3,18 +3,20 @@
 #include <sstream>
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "Compiler.h"
+#include "server/HttpServer.h"
+#include "server/StaticAssetCache.h"
 
 #ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #pragma comment(lib, "ws2_32.lib")
 #include <windows.h>
-#else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <unistd.h>
-#include <cstdlib>
 #endif
 
 std::string urlDecode(const std::string& str) {
@@ -38,25 +40,233 @@ std::string urlDecode(const std::string& str) {
     return result;
 }
 
-std::string extractPostData(const std::string& request) {
-    size_t pos = request.find("\r\n\r\n");
-    if (pos != std::string::npos) {
-        return request.substr(pos + 4);
+// Looks up one field of an application/x-www-form-urlencoded body
+bool getFormField(const std::string& postData, const std::string& name, std::string& value) {
+    size_t pos = 0;
+    while (pos < postData.length()) {
+        size_t end = postData.find('&', pos);
+        if (end == std::string::npos) {
+            end = postData.length();
+        }
+        if (postData.compare(pos, name.length() + 1, name + "=") == 0) {
+            size_t start = pos + name.length() + 1;
+            value = urlDecode(postData.substr(start, end - start));
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+bool parseSize(const std::string& text, size_t& value) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    value = std::strtoull(text.c_str(), nullptr, 10);
+    return true;
+}
+
+// "0" to "3", as in the -O0 to -O3 flags
+bool parseOptimizationLevel(const std::string& text, int& level) {
+    size_t value;
+    if (!parseSize(text, value) || value > 3) {
+        return false;
+    }
+    level = static_cast<int>(value);
+    return true;
+}
+
+// Frame slots local value numbering may add, 0 to 1024, as in the
+// --max-temporaries flag
+bool parseTemporaryLimit(const std::string& text, int& limit) {
+    size_t value;
+    if (!parseSize(text, value) || value > 1024) {
+        return false;
+    }
+    limit = static_cast<int>(value);
+    return true;
+}
+
+// Partial evaluation fuel of a request, at least 1 and at most what the
+// server was started with, so a request cannot make compiles longer
+bool parseFuel(const std::string& text, size_t limit, size_t& fuel) {
+    size_t value;
+    if (!parseSize(text, value) || value == 0 || value > limit) {
+        return false;
+    }
+    fuel = value;
+    return true;
+}
+
+// Options for requests that do not choose their own, set on the command
+// line before the server starts; worker threads only read them
+static CompilerOptions defaultOptions;
+
+// Requests are handled on several threads; whole lines keep their output
+// from interleaving
+static std::mutex logMutex;
+
+void logLine(const std::string& line) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::cout << line << std::endl;
+}
+
+// Incremental front end state of one editor page. Two requests of the same
+// page take turns on it; a session dropped from the map while a request
+// still uses it lives on until that request is done.
+struct EditSession {
+    std::mutex mutex;
+    IncrementalParser parser;
+    uint64_t lastUse = 0; // Guarded by editSessionsMutex
+};
+
+// Edit sessions keyed by the session id the page sends along. Bounded so
+// that abandoned pages cannot pile up: a new session pushes out the one
+// that was used longest ago.
+static std::mutex editSessionsMutex;
+static std::map<std::string, std::shared_ptr<EditSession>> editSessions;
+static uint64_t editSessionUses = 0;
+static const size_t MAX_EDIT_SESSIONS = 64;
+
+std::shared_ptr<EditSession> findEditSession(const std::string& sessionId, bool create) {
+    std::lock_guard<std::mutex> lock(editSessionsMutex);
+    auto it = editSessions.find(sessionId);
+    if (it != editSessions.end()) {
+        it->second->lastUse = ++editSessionUses;
+        return it->second;
     }
-    return "";
+    if (!create) {
+        return nullptr;
+    }
+    if (editSessions.size() >= MAX_EDIT_SESSIONS) {
+        auto leastRecent = std::min_element(editSessions.begin(), editSessions.end(),
+            [](const auto& a, const auto& b) { return a.second->lastUse < b.second->lastUse; });
+        editSessions.erase(leastRecent);
+    }
+    auto session = std::make_shared<EditSession>();
+    session->lastUse = ++editSessionUses;
+    return editSessions.emplace(sessionId, session).first->second;
 }
 
-std::string getSourceFromPost(const std::string& postData) {
-    size_t pos = postData.find("source=");
-    if (pos != std::string::npos) {
-        std::string encoded = postData.substr(pos + 7);
-        size_t endPos = encoded.find('&');
-        if (endPos != std::string::npos) {
-            encoded = encoded.substr(0, endPos);
+HttpResponse jsonResponse(int status, std::string json) {
+    HttpResponse response(status, "application/json", std::move(json));
+    response.headers.emplace_back("Access-Control-Allow-Origin", "*");
+    return response;
+}
+
+// POST /compile takes either the full source ("source=...") or, for a page
+// that already sent its source once, only the change since its last request
+// ("offset", "removed" and "inserted", plus the new "length" as a check).
+// A delta for an unknown or out-of-date session gets 409 Conflict, and the
+// page answers by sending the full source again. "opt" selects the
+// optimization level, 0 to 3, "temporaries" the frame slots local value
+// numbering may add, and "fuel" and "fuelMemory" the instructions and
+// bytes partial evaluation may use, up to the server's own limits.
+// "measure=1" also runs the bytecode from before the peephole optimizer
+// to report the instructions it saves. "syntax=0" leaves the tokens and
+// the AST out of the response, and "view=syntax" with a session returns
+// only those, for the source the session last compiled.
+HttpResponse handleCompile(const std::string& postData) {
+    std::string sessionId;
+    std::string source;
+    std::string levelText;
+    std::string temporariesText;
+    std::string fuelText;
+    std::string measureText;
+    std::string syntaxText;
+    std::string view;
+    size_t fuel;
+    bool hasSession = getFormField(postData, "session", sessionId) && !sessionId.empty();
+    bool hasSource = getFormField(postData, "source", source);
+    CompilationResult result;
+    
+    CompilerOptions options = defaultOptions;
+    if (getFormField(postData, "measure", measureText)) {
+        options.measurePeephole = measureText == "1";
+    }
+    if (getFormField(postData, "syntax", syntaxText)) {
+        options.includeSyntax = syntaxText != "0";
+    }
+    if (getFormField(postData, "opt", levelText) &&
+        !parseOptimizationLevel(levelText, options.optimizationLevel)) {
+        return jsonResponse(400, "{\"success\": false, \"error\": \"Optimization level must be 0 to 3\"}");
+    }
+    if (getFormField(postData, "temporaries", temporariesText) &&
+        !parseTemporaryLimit(temporariesText, options.maxTemporaries)) {
+        return jsonResponse(400, "{\"success\": false, \"error\": \"Temporaries must be 0 to 1024\"}");
+    }
+    if (getFormField(postData, "fuel", fuelText)) {
+        if (!parseFuel(fuelText, static_cast<size_t>(defaultOptions.evaluationInstructions), fuel)) {
+            return jsonResponse(400, "{\"success\": false, \"error\": \"Fuel must be 1 to " +
+                                std::to_string(defaultOptions.evaluationInstructions) + "\"}");
+        }
+        options.evaluationInstructions = static_cast<long long>(fuel);
+    }
+    if (getFormField(postData, "fuelMemory", fuelText) &&
+        !parseFuel(fuelText, defaultOptions.evaluationMemory, options.evaluationMemory)) {
+        return jsonResponse(400, "{\"success\": false, \"error\": \"Fuel memory must be 1 to " +
+                            std::to_string(defaultOptions.evaluationMemory) + " bytes\"}");
+    }
+    Compiler compiler(options);
+    
+    if (hasSession && !hasSource && getFormField(postData, "view", view) && view == "syntax") {
+        auto session = findEditSession(sessionId, false);
+        if (!session) {
+            return jsonResponse(409, "{\"success\": false, \"error\": \"Unknown or out-of-date edit session\"}");
+        }
+        std::lock_guard<std::mutex> sessionLock(session->mutex);
+        result = compiler.describeSyntax(session->parser);
+    } else if (hasSession && !hasSource) {
+        std::string offsetText, removedText, inserted, lengthText;
+        size_t offset, removed, length;
+        auto session = findEditSession(sessionId, false);
+        std::unique_lock<std::mutex> sessionLock;
+        if (session) {
+            sessionLock = std::unique_lock<std::mutex>(session->mutex);
         }
-        return urlDecode(encoded);
+        
+        bool valid = session &&
+                     getFormField(postData, "offset", offsetText) && parseSize(offsetText, offset) &&
+                     getFormField(postData, "removed", removedText) && parseSize(removedText, removed) &&
+                     getFormField(postData, "inserted", inserted) &&
+                     getFormField(postData, "length", lengthText) && parseSize(lengthText, length);
+        if (valid) {
+            size_t oldLength = session->parser.getSource().length();
+            valid = offset <= oldLength && removed <= oldLength - offset &&
+                    oldLength - removed + inserted.length() == length;
+        }
+        if (!valid) {
+            return jsonResponse(409, "{\"success\": false, \"error\": \"Unknown or out-of-date edit session\"}");
+        }
+        
+        logLine("Compiling edit at offset " + std::to_string(offset) + "...");
+        result = compiler.compileEdit(session->parser, offset, removed, inserted);
+        
+        const EditStats& stats = session->parser.getLastEdit();
+        std::ostringstream oss;
+        oss << (stats.fullParse ? "Full parse: " : "Incremental parse: ")
+            << stats.tokensRelexed << " tokens lexed, "
+            << stats.statementsReparsed << " statements parsed, "
+            << stats.statementsReused << " reused";
+        logLine(oss.str());
+    } else if (hasSession) {
+        auto session = findEditSession(sessionId, true);
+        std::lock_guard<std::mutex> sessionLock(session->mutex);
+        
+        logLine("Compiling source code...");
+        session->parser.reset(source);
+        result = compiler.compileAndRun(session->parser);
+    } else {
+        logLine("Compiling source code...");
+        result = compiler.compileAndRun(source);
     }
-    return "";
+    
+    std::string json = result.toJSON();
+    
+    logLine("JSON Response length: " + std::to_string(json.length()) + " bytes");
+    logLine("First 200 chars: " + json.substr(0, 200) + "...");
+    
+    return jsonResponse(200, json);
 }
 
 void openBrowserUrl(const std::string& url) {
@@ -77,88 +287,26 @@ void openBrowserUrl(const std::string& url) {
     #endif
 }
 
-void handleRequest(int clientSocket, const std::string& request) {
-    Compiler compiler;
-    std::string response;
-    
-    if (request.find("GET / ") == 0 || request.find("GET /index.html") == 0) {
-        // Serve HTML file
-        std::ifstream file("web/index.html");
-        if (file.is_open()) {
-            std::ostringstream content;
-            content << file.rdbuf();
-            response = "HTTP/1.1 200 OK\r\n"
-                      "Content-Type: text/html\r\n"
-                      "Access-Control-Allow-Origin: *\r\n"
-                      "\r\n" + content.str();
-        } else {
-            response = "HTTP/1.1 404 Not Found\r\n\r\nFile not found";
-        }
-    } 
-    else if (request.find("GET /style.css") == 0) {
-        std::ifstream file("web/style.css");
-        if (file.is_open()) {
-            std::ostringstream content;
-            content << file.rdbuf();
-            response = "HTTP/1.1 200 OK\r\n"
-                      "Content-Type: text/css\r\n"
-                      "Access-Control-Allow-Origin: *\r\n"
-                      "\r\n" + content.str();
-        }
-    }
-    else if (request.find("GET /script.js") == 0) {
-        std::ifstream file("web/script.js");
-        if (file.is_open()) {
-            std::ostringstream content;
-            content << file.rdbuf();
-            response = "HTTP/1.1 200 OK\r\n"
-                      "Content-Type: application/javascript\r\n"
-                      "Access-Control-Allow-Origin: *\r\n"
-                      "\r\n" + content.str();
-        }
-    }
-    else if (request.find("POST /compile") == 0) {
-        std::string postData = extractPostData(request);
-        std::string source = getSourceFromPost(postData);
-        
-        std::cout << "Compiling source code..." << std::endl;
-        auto result = compiler.compileAndRun(source);
-        std::string json = result.toJSON();
-        
-        std::cout << "JSON Response length: " << json.length() << " bytes" << std::endl;
-        std::cout << "First 200 chars: " << json.substr(0, 200) << "..." << std::endl;
-        
-        response = "HTTP/1.1 200 OK\r\n"
-                  "Content-Type: application/json\r\n"
-                  "Access-Control-Allow-Origin: *\r\n"
-                  "\r\n" + json;
-    }
-    else if (request.find("GET /examples/") == 0) {
-        // Extract example number
-        size_t pos = request.find("/examples/");
-        std::string examplePath = request.substr(pos);
-        size_t spacePos = examplePath.find(' ');
-        if (spacePos != std::string::npos) {
-            examplePath = examplePath.substr(0, spacePos);
-        }
-        
-        std::ifstream file(examplePath.substr(1)); // Remove leading '/'
-        if (file.is_open()) {
-            std::ostringstream content;
-            content << file.rdbuf();
-            response = "HTTP/1.1 200 OK\r\n"
-                      "Content-Type: text/plain\r\n"
-                      "Access-Control-Allow-Origin: *\r\n"
-                      "\r\n" + content.str();
-        } else {
-            response = "HTTP/1.1 404 Not Found\r\n\r\nExample not found";
-        }
+// The editor page (web/) and the examples, served from memory and
+// reloaded when they change on disk
+static StaticAssetCache staticAssets(logLine);
+
+// Answers one request; runs on the server's worker threads
+HttpResponse handleRequest(const HttpRequest& request) {
+    HttpResponse response;
+    if (request.method == "POST" && request.target == "/compile") {
+        return handleCompile(request.body);
     }
-    else {
-        response = "HTTP/1.1 404 Not Found\r\n\r\nNot found";
+    if (staticAssets.serve(request, response)) {
+        return response;
     }
-    
-    send(clientSocket, response.c_str(), response.length(), 0);
+    return HttpResponse(404, "text/plain", "Not found");
+}
+
+// Default worker count: one per hardware thread
+size_t defaultThreadCount() {
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 4;
 }
 
 int main(int argc, char* argv[]) {
@@ -166,70 +314,144 @@ int main(int argc, char* argv[]) {
     std::cout << "6-Stage Compilation System" << std::endl;
     std::cout << "=================================" << std::endl << std::endl;
     
+    bool serverMode = false;
+    HttpServerOptions serverOptions;
+    serverOptions.threadCount = defaultThreadCount();
+    size_t idleTimeout = static_cast<size_t>(serverOptions.idleTimeoutSeconds);
+    std::string sourcePath;
+    std::string profileOut;
+    size_t evaluationInstructions;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--server") == 0) {
+            serverMode = true;
+        } else if (std::strncmp(argv[i], "-O", 2) == 0 &&
+                   parseOptimizationLevel(argv[i] + 2, defaultOptions.optimizationLevel)) {
+            continue;
+        } else if (std::strncmp(argv[i], "--max-temporaries=", 18) == 0 &&
+                   parseTemporaryLimit(argv[i] + 18, defaultOptions.maxTemporaries)) {
+            continue;
+        } else if (std::strncmp(argv[i], "--fuel=", 7) == 0 &&
+                   parseSize(argv[i] + 7, evaluationInstructions) && evaluationInstructions > 0 &&
+                   evaluationInstructions <= 1000000000) {
+            defaultOptions.evaluationInstructions = static_cast<long long>(evaluationInstructions);
+        } else if (std::strncmp(argv[i], "--fuel-memory=", 14) == 0 &&
+                   parseSize(argv[i] + 14, defaultOptions.evaluationMemory) &&
+                   defaultOptions.evaluationMemory > 0) {
+            continue;
+        } else if (std::strcmp(argv[i], "--measure-peephole") == 0) {
+            defaultOptions.measurePeephole = true;
+        } else if (std::strncmp(argv[i], "--threads=", 10) == 0 &&
+                   parseSize(argv[i] + 10, serverOptions.threadCount) && serverOptions.threadCount > 0) {
+            continue;
+        } else if (std::strncmp(argv[i], "--backlog=", 10) == 0 &&
+                   parseSize(argv[i] + 10, serverOptions.backlog) && serverOptions.backlog > 0) {
+            continue;
+        } else if (std::strncmp(argv[i], "--max-body=", 11) == 0 &&
+                   parseSize(argv[i] + 11, serverOptions.maxBodySize)) {
+            continue;
+        } else if (std::strncmp(argv[i], "--idle-timeout=", 15) == 0 &&
+                   parseSize(argv[i] + 15, idleTimeout) && idleTimeout > 0 && idleTimeout <= 3600) {
+            serverOptions.idleTimeoutSeconds = static_cast<int>(idleTimeout);
+        } else if (std::strncmp(argv[i], "--profile-generate=", 19) == 0 && argv[i][19]) {
+            profileOut = argv[i] + 19;
+        } else if (std::strncmp(argv[i], "--profile-use=", 14) == 0 && argv[i][14]) {
+            auto profile = std::make_shared<Profile>();
+            std::string error;
+            if (!profile->load(argv[i] + 14, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            defaultOptions.profile = profile;
+        } else if (argv[i][0] != '-' && sourcePath.empty()) {
+            sourcePath = argv[i];
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (!profileOut.empty() && sourcePath.empty()) {
+        std::cerr << "--profile-generate needs a source file to run" << std::endl;
+        return 1;
+    }
+    if (defaultOptions.profile && serverMode) {
+        // The counts belong to one source; the server compiles whatever it is sent
+        std::cerr << "--profile-use cannot be combined with --server" << std::endl;
+        return 1;
+    }
+    
     // Check if running in server mode
-    if (argc > 1 && std::strcmp(argv[1], "--server") == 0) {
-        std::cout << "Starting HTTP server on port 8080..." << std::endl;
+    if (serverMode) {
+        std::cout << "Starting HTTP server on port " << serverOptions.port << " (optimization level "
+                  << defaultOptions.optimizationLevel << ", " << serverOptions.threadCount
+                  << " worker threads, backlog " << serverOptions.backlog << ")..." << std::endl;
         std::cout << "Open http://localhost:8080 in your browser" << std::endl;
         
-#ifdef _WIN32
-        WSADATA wsaData;
-        WSAStartup(MAKEWORD(2, 2), &wsaData);
-#endif
-        
-        int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-        if (serverSocket < 0) {
-            std::cerr << "Failed to create socket" << std::endl;
-        // Open browser automatically
-        openBrowserUrl("http://localhost:8080");
+        staticAssets.mount("/", "web");
+        staticAssets.mount("/examples/", "examples");
+        std::cout << "Serving " << staticAssets.load() << " static files from memory" << std::endl;
+        staticAssets.watch(1000);
         
+        HttpServer server(serverOptions, handleRequest);
+        return server.run();
+    } else if (!sourcePath.empty()) {
+        // Compile and run a source file, optionally as an instrumented
+        // build that writes a profile for later --profile-use compiles
+        std::ifstream file(sourcePath);
+        if (!file) {
+            std::cerr << "Cannot read " << sourcePath << std::endl;
             return 1;
         }
+        std::stringstream source;
+        source << file.rdbuf();
         
-        sockaddr_in serverAddr;
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_addr.s_addr = INADDR_ANY;
-        serverAddr.sin_port = htons(8080);
-        
-        int opt = 1;
-        setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
-        
-        if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
-            std::cerr << "Bind failed" << std::endl;
+        CompilerOptions options = defaultOptions;
+        options.instrument = !profileOut.empty();
+        Compiler compiler(options);
+        auto result = compiler.compileAndRun(source.str());
+        if (!result.success) {
+            std::cout << "Error: " << result.errorMessage << std::endl;
             return 1;
         }
+        std::cout << result.executionOutput;
+        std::cout << "Executed instructions: " << result.executedInstructions << std::endl;
         
-        listen(serverSocket, 5);
-        
-        while (true) {
-            sockaddr_in clientAddr;
-            socklen_t clientLen = sizeof(clientAddr);
-            int clientSocket = accept(serverSocket, (sockaddr*)&clientAddr, &clientLen);
-            
-            if (clientSocket < 0) continue;
-            
-            char buffer[4096] = {0};
-            recv(clientSocket, buffer, sizeof(buffer), 0);
-            
-            std::string request(buffer);
-            handleRequest(clientSocket, request);
-            
-#ifdef _WIN32
-            closesocket(clientSocket);
-#else
-            close(clientSocket);
-#endif
+        if (options.instrument) {
+            std::string error;
+            if (!result.profile.save(profileOut, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            std::cout << "Profile of " << result.profile.size() << " if and for statements written to "
+                      << profileOut << std::endl;
         }
-        
-#ifdef _WIN32
-        closesocket(serverSocket);
-        WSACleanup();
-#else
-        close(serverSocket);
-#endif
     } else {
         // Command-line mode
-        std::cout << "Usage: " << argv[0] << " --server" << std::endl;
-        std::cout << "  Start web server on port 8080" << std::endl << std::endl;
+        std::cout << "Usage: " << argv[0]
+                  << " [--server] [--threads=N] [--backlog=N] [--max-body=BYTES]"
+                  << " [--idle-timeout=SECONDS] [-O0|-O1|-O2|-O3] [--max-temporaries=N]"
+                  << " [--fuel=N] [--fuel-memory=BYTES] [--measure-peephole]"
+                  << " [--profile-use=FILE] [--profile-generate=FILE] [source]"
+                  << std::endl;
+        std::cout << "  --server  Start web server on port 8080" << std::endl;
+        std::cout << "  --threads=N  Worker threads of the server (default: one per core)" << std::endl;
+        std::cout << "  --backlog=N  Requests the server lets wait for a worker (default 128)" << std::endl;
+        std::cout << "  --max-body=BYTES  Largest request body the server reads (default 1048576)" << std::endl;
+        std::cout << "  --idle-timeout=SECONDS  Close quiet keep-alive connections after this long" << std::endl;
+        std::cout << "                          (default 5)" << std::endl;
+        std::cout << "  -On       Optimization level (default 2); requests may choose their own" << std::endl;
+        std::cout << "  --max-temporaries=N  Frame slots local value numbering may add, 0 to 1024" << std::endl;
+        std::cout << "                       (default 16); requests may choose their own" << std::endl;
+        std::cout << "  --fuel=N  Instructions partial evaluation (-O3) may run (default 1000000);" << std::endl;
+        std::cout << "            requests may lower it" << std::endl;
+        std::cout << "  --fuel-memory=BYTES  Frame, stack and output partial evaluation may use" << std::endl;
+        std::cout << "                       (default 65536); requests may lower it" << std::endl;
+        std::cout << "  --measure-peephole  Also run the bytecode from before the peephole optimizer" << std::endl;
+        std::cout << "                      and report the instructions it saves" << std::endl;
+        std::cout << "  --profile-use=FILE       Optimize with the branch and loop counts in FILE" << std::endl;
+        std::cout << "                           (not with --server)" << std::endl;
+        std::cout << "  --profile-generate=FILE  Run source as an instrumented build and write its" << std::endl;
+        std::cout << "                           counts to FILE" << std::endl;
+        std::cout << "  source    Compile and run this file instead of the test program" << std::endl << std::endl;
         
         // Test example
         std::string testCode = 
@@ -240,7 +462,7 @@ int main(int argc, char* argv[]) {
         std::cout << "Running test program:" << std::endl;
         std::cout << testCode << std::endl;
         
-        Compiler compiler;
+        Compiler compiler(defaultOptions);
         auto result = compiler.compileAndRun(testCode);
         
         if (result.success) {
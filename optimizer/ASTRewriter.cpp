@@ -0,0 +1,269 @@
+#include "ASTRewriter.h"
+#include "../codegen/OpcodeTable.h"
+
+void ASTRewriter::replaceWith(std::unique_ptr<Expression> expr) {
+    pendingExpression = std::move(expr);
+}
+
+void ASTRewriter::replaceWith(std::unique_ptr<Statement> stmt) {
+    pendingStatement = std::move(stmt);
+    statementReplaced = true;
+}
+
+void ASTRewriter::rewrite(std::unique_ptr<Expression>& expr) {
+    expr->accept(*this);
+    if (pendingExpression) {
+        expr = std::move(pendingExpression);
+    }
+}
+
+void ASTRewriter::rewrite(std::unique_ptr<Statement>& stmt) {
+    stmt->accept(*this);
+    if (statementReplaced) {
+        statementReplaced = false;
+        stmt = std::move(pendingStatement);
+    }
+}
+
+void ASTRewriter::rewriteRequired(std::unique_ptr<Statement>& stmt) {
+    rewrite(stmt);
+    if (!stmt) {
+        stmt = std::make_unique<BlockStatement>();
+    }
+}
+
+void ASTRewriter::rewriteStatements(std::vector<std::unique_ptr<Statement>>& statements) {
+    bool removed = false;
+    for (auto& stmt : statements) {
+        rewrite(stmt);
+        removed = removed || !stmt;
+    }
+    
+    if (removed) {
+        std::vector<std::unique_ptr<Statement>> kept;
+        kept.reserve(statements.size());
+        for (auto& stmt : statements) {
+            if (stmt) kept.push_back(std::move(stmt));
+        }
+        statements = std::move(kept);
+    }
+}
+
+void ASTRewriter::visit(NumberExpression& node) {
+}
+
+void ASTRewriter::visit(VariableExpression& node) {
+}
+
+void ASTRewriter::visit(BinaryExpression& node) {
+    rewrite(node.left);
+    rewrite(node.right);
+}
+
+void ASTRewriter::visit(VariableDeclaration& node) {
+    rewrite(node.initializer);
+}
+
+void ASTRewriter::visit(PrintStatement& node) {
+    rewrite(node.expression);
+}
+
+void ASTRewriter::visit(BlockStatement& node) {
+    rewriteStatements(node.statements);
+}
+
+void ASTRewriter::visit(IfStatement& node) {
+    rewrite(node.condition);
+    rewriteRequired(node.thenBranch);
+    if (node.elseBranch) {
+        rewrite(node.elseBranch);
+    }
+}
+
+void ASTRewriter::visit(ForStatement& node) {
+    rewrite(node.start);
+    rewrite(node.end);
+    rewriteRequired(node.body);
+}
+
+void ASTRewriter::visit(Program& node) {
+    rewriteStatements(node.statements);
+}
+
+namespace {
+
+class AssignedSlotCollector : public ASTVisitor {
+private:
+    std::vector<bool>& assigned;
+
+public:
+    explicit AssignedSlotCollector(std::vector<bool>& slots) : assigned(slots) {}
+
+    void visit(NumberExpression& node) override {}
+    void visit(VariableExpression& node) override {}
+    void visit(BinaryExpression& node) override {}
+    void visit(VariableDeclaration& node) override { assigned[node.slot] = true; }
+    void visit(PrintStatement& node) override {}
+    void visit(BlockStatement& node) override {
+        for (auto& stmt : node.statements) {
+            stmt->accept(*this);
+        }
+    }
+    void visit(IfStatement& node) override {
+        node.thenBranch->accept(*this);
+        if (node.elseBranch) {
+            node.elseBranch->accept(*this);
+        }
+    }
+    void visit(ForStatement& node) override {
+        assigned[node.slot] = true;
+        node.body->accept(*this);
+    }
+    void visit(Program& node) override {
+        for (auto& stmt : node.statements) {
+            stmt->accept(*this);
+        }
+    }
+};
+
+}
+
+void collectAssignedSlots(Statement& stmt, std::vector<bool>& assigned) {
+    AssignedSlotCollector collector(assigned);
+    stmt.accept(collector);
+}
+
+namespace {
+
+bool isEmptyBlock(const Statement* stmt) {
+    auto* block = dynamic_cast<const BlockStatement*>(stmt);
+    return block && block->statements.empty();
+}
+
+// Mirrors what IRBuilder and BytecodeEmitter make of each node, before
+// the peephole optimizer, when every computed value is stored once and
+// every read of a variable is a LOAD (or a PUSH of a constant). Values the
+// emitter computes at their only use instead of storing, and the copies
+// into phis where branches or iterations assign a variable, are left out.
+class InstructionCounter : public ASTVisitor {
+public:
+    int count = 0;
+    
+    void visit(NumberExpression& node) override { count++; }
+    void visit(VariableExpression& node) override { count++; }
+    void visit(BinaryExpression& node) override {
+        // Immediate forms and NEG leave out the PUSH of a literal operand
+        auto* left = dynamic_cast<NumberExpression*>(node.left.get());
+        auto* right = dynamic_cast<NumberExpression*>(node.right.get());
+        if (right && OpcodeTable::hasImmediateForm(node.op, right->value)) {
+            node.left->accept(*this);
+        } else if (node.op == BinaryOp::SUB && left && left->value == 0) {
+            node.right->accept(*this);
+        } else {
+            node.left->accept(*this);
+            node.right->accept(*this);
+        }
+        count++;
+    }
+    void visit(VariableDeclaration& node) override {
+        // A literal or another variable only names an existing value
+        if (dynamic_cast<NumberExpression*>(node.initializer.get()) ||
+            dynamic_cast<VariableExpression*>(node.initializer.get())) {
+            return;
+        }
+        node.initializer->accept(*this);
+        count++; // STORE
+    }
+    void visit(PrintStatement& node) override {
+        node.expression->accept(*this);
+        count++;
+    }
+    void visit(BlockStatement& node) override {
+        for (auto& stmt : node.statements) {
+            stmt->accept(*this);
+        }
+    }
+    void visit(IfStatement& node) override {
+        node.condition->accept(*this);
+        count++; // JMP_IF_FALSE, or JMP_IF_TRUE if a profile puts the else branch first
+        node.thenBranch->accept(*this);
+        if (node.elseBranch && !isEmptyBlock(node.elseBranch.get())) {
+            count++; // JMP over the branch laid out second
+            node.elseBranch->accept(*this);
+        }
+    }
+    void visit(ForStatement& node) override {
+        // STORE; LOAD end GT JMP_IF_TRUE; body; LOAD PUSH ADD STORE JMP.
+        // The body follows the test, which jumps out when it is done
+        node.start->accept(*this);
+        node.end->accept(*this);
+        node.body->accept(*this);
+        count += 9;
+    }
+    void visit(Program& node) override {
+        for (auto& stmt : node.statements) {
+            stmt->accept(*this);
+        }
+    }
+};
+
+}
+
+int countInstructions(Expression& expr) {
+    InstructionCounter counter;
+    expr.accept(counter);
+    return counter.count;
+}
+
+int countInstructions(Statement& stmt) {
+    InstructionCounter counter;
+    stmt.accept(counter);
+    return counter.count;
+}
+
+bool canTrap(const Expression& expr) {
+    auto* binary = dynamic_cast<const BinaryExpression*>(&expr);
+    if (!binary) {
+        return false;
+    }
+    if (binary->op == BinaryOp::DIV) {
+        auto* divisor = dynamic_cast<const NumberExpression*>(binary->right.get());
+        if (!divisor || divisor->value == 0) {
+            return true;
+        }
+    }
+    return canTrap(*binary->left) || canTrap(*binary->right);
+}
+
+bool sameExpression(const Expression& a, const Expression& b) {
+    if (auto* number = dynamic_cast<const NumberExpression*>(&a)) {
+        auto* other = dynamic_cast<const NumberExpression*>(&b);
+        return other && other->value == number->value;
+    }
+    if (auto* variable = dynamic_cast<const VariableExpression*>(&a)) {
+        auto* other = dynamic_cast<const VariableExpression*>(&b);
+        return other && other->slot == variable->slot;
+    }
+    auto& binary = static_cast<const BinaryExpression&>(a);
+    auto* other = dynamic_cast<const BinaryExpression*>(&b);
+    return other && other->op == binary.op && 
+           sameExpression(*binary.left, *other->left) && 
+           sameExpression(*binary.right, *other->right);
+}
+
+std::string expressionToString(const Expression& expr) {
+    if (auto* number = dynamic_cast<const NumberExpression*>(&expr)) {
+        return std::to_string(number->value);
+    }
+    if (auto* variable = dynamic_cast<const VariableExpression*>(&expr)) {
+        return variable->name;
+    }
+    
+    // Operands that are themselves binary expressions are parenthesized
+    auto& binary = static_cast<const BinaryExpression&>(expr);
+    auto operand = [](const Expression& e) {
+        std::string text = expressionToString(e);
+        return dynamic_cast<const BinaryExpression*>(&e) ? "(" + text + ")" : text;
+    };
+    return operand(*binary.left) + " " + binaryOpSymbol(binary.op) + " " + operand(*binary.right);
+}
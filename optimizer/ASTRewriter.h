@@ -0,0 +1,64 @@
+#ifndef AST_REWRITER_H
+#define AST_REWRITER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../ast/AST.h"
+
+// Base visitor for passes that rewrite the tree in place.
+//
+// The default visit methods walk the whole tree and change nothing. A pass
+// overrides the nodes it cares about and, as the last step of a visit, may
+// call replaceWith() to hand back a replacement; the parent then swaps it
+// into the child pointer that was being visited. Replacing a statement with
+// nullptr removes it: it is erased from blocks, and a removed branch or loop
+// body becomes an empty block (a removed else branch is simply dropped).
+class ASTRewriter : public ASTVisitor {
+private:
+    std::unique_ptr<Expression> pendingExpression;
+    std::unique_ptr<Statement> pendingStatement;
+    bool statementReplaced = false;
+
+protected:
+    void replaceWith(std::unique_ptr<Expression> expr);
+    void replaceWith(std::unique_ptr<Statement> stmt);
+
+    // Visit a child and apply its replacement, if any
+    void rewrite(std::unique_ptr<Expression>& expr);
+    void rewrite(std::unique_ptr<Statement>& stmt);
+    void rewriteRequired(std::unique_ptr<Statement>& stmt);
+    void rewriteStatements(std::vector<std::unique_ptr<Statement>>& statements);
+
+public:
+    void visit(NumberExpression& node) override;
+    void visit(VariableExpression& node) override;
+    void visit(BinaryExpression& node) override;
+    void visit(VariableDeclaration& node) override;
+    void visit(PrintStatement& node) override;
+    void visit(BlockStatement& node) override;
+    void visit(IfStatement& node) override;
+    void visit(ForStatement& node) override;
+    void visit(Program& node) override;
+};
+
+// Marks the frame slot of every variable stmt may assign (declarations and
+// loop variables, at any depth). assigned must have Program::frameSize entries.
+void collectAssignedSlots(Statement& stmt, std::vector<bool>& assigned);
+
+// Number of instructions the bytecode of a subtree has, as BytecodeEmitter
+// emits it before the peephole optimizer
+int countInstructions(Expression& expr);
+int countInstructions(Statement& stmt);
+
+// Whether evaluating expr can stop the program (division by anything other
+// than a non-zero literal)
+bool canTrap(const Expression& expr);
+
+// Structural equality; variables are compared by frame slot
+bool sameExpression(const Expression& a, const Expression& b);
+
+// Source form of expr for reports, e.g. "a * (b + 1)"
+std::string expressionToString(const Expression& expr);
+
+#endif // AST_REWRITER_H
@@ -0,0 +1,29 @@
+#include "ConstantFolding.h"
+#include <sstream>
+
+int ConstantFolding::run(Program& program, std::vector<std::string>& passLog) {
+    log = &passLog;
+    rewrites = 0;
+    program.accept(*this);
+    return rewrites;
+}
+
+void ConstantFolding::visit(BinaryExpression& node) {
+    // Fold operands first, so a whole constant tree folds in one run
+    ASTRewriter::visit(node);
+    
+    auto* left = dynamic_cast<NumberExpression*>(node.left.get());
+    auto* right = dynamic_cast<NumberExpression*>(node.right.get());
+    int result;
+    if (!left || !right || !evaluateBinaryOp(node.op, left->value, right->value, result)) {
+        return;
+    }
+    
+    std::ostringstream oss;
+    oss << "Constant folding: " << left->value << " " << binaryOpSymbol(node.op) << " " 
+        << right->value << " = " << result;
+    log->push_back(oss.str());
+    rewrites++;
+    
+    replaceWith(std::make_unique<NumberExpression>(result));
+}
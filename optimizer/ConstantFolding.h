@@ -0,0 +1,25 @@
+#ifndef CONSTANT_FOLDING_H
+#define CONSTANT_FOLDING_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+
+// Replaces binary expressions whose operands are both literals with the
+// literal result. Operations that would fail at run time (division by
+// zero) are left in place so the error still happens.
+class ConstantFolding : public OptimizationPass, public ASTRewriter {
+private:
+    std::vector<std::string>* log;
+    int rewrites;
+    
+public:
+    ConstantFolding() : log(nullptr), rewrites(0) {}
+    
+    std::string getName() const override { return "constant-folding"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+    
+    using ASTRewriter::visit;
+    void visit(BinaryExpression& node) override;
+};
+
+#endif // CONSTANT_FOLDING_H
@@ -0,0 +1,78 @@
+#include "ConstantPropagation.h"
+#include <sstream>
+
+int ConstantPropagation::run(Program& program, std::vector<std::string>& passLog) {
+    log = &passLog;
+    rewrites = 0;
+    state.known.assign(program.frameSize, false);
+    state.values.assign(program.frameSize, 0);
+    
+    program.accept(*this);
+    return rewrites;
+}
+
+void ConstantPropagation::mergeFrom(const State& other) {
+    for (size_t slot = 0; slot < state.known.size(); ++slot) {
+        if (state.known[slot] && 
+            (!other.known[slot] || other.values[slot] != state.values[slot])) {
+            state.known[slot] = false;
+        }
+    }
+}
+
+void ConstantPropagation::visit(VariableExpression& node) {
+    if (!state.known[node.slot]) {
+        return;
+    }
+    
+    int value = state.values[node.slot];
+    std::ostringstream oss;
+    oss << "Constant propagation: " << node.name << " = " << value;
+    log->push_back(oss.str());
+    rewrites++;
+    
+    replaceWith(std::make_unique<NumberExpression>(value));
+}
+
+void ConstantPropagation::visit(VariableDeclaration& node) {
+    rewrite(node.initializer);
+    
+    auto* literal = dynamic_cast<NumberExpression*>(node.initializer.get());
+    state.known[node.slot] = literal != nullptr;
+    state.values[node.slot] = literal ? literal->value : 0;
+}
+
+void ConstantPropagation::visit(IfStatement& node) {
+    rewrite(node.condition);
+    
+    State before = state;
+    rewriteRequired(node.thenBranch);
+    
+    State afterThen = std::move(state);
+    state = std::move(before);
+    if (node.elseBranch) {
+        rewrite(node.elseBranch);
+    }
+    mergeFrom(afterThen);
+}
+
+void ConstantPropagation::visit(ForStatement& node) {
+    rewrite(node.start);
+    
+    std::vector<bool> assigned(state.known.size(), false);
+    assigned[node.slot] = true;
+    collectAssignedSlots(*node.body, assigned);
+    for (size_t slot = 0; slot < assigned.size(); ++slot) {
+        if (assigned[slot]) {
+            state.known[slot] = false;
+        }
+    }
+    
+    // The bound is re-evaluated before every iteration
+    rewrite(node.end);
+    
+    // Facts the body establishes do not survive a zero-trip loop
+    State loopHead = state;
+    rewriteRequired(node.body);
+    state = std::move(loopHead);
+}
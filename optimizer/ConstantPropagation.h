@@ -0,0 +1,42 @@
+#ifndef CONSTANT_PROPAGATION_H
+#define CONSTANT_PROPAGATION_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+
+// Replaces reads of variables whose value is a known literal at that point.
+//
+// Facts are tracked per frame slot in program order:
+// - a declaration or assignment with a literal initializer makes the slot
+//   known, any other initializer makes it unknown
+// - after an if statement a slot stays known only if both branches agree
+// - every slot a loop assigns (including its own variable) is unknown in
+//   the loop bound, in the body and after the loop, since the body runs
+//   any number of times
+class ConstantPropagation : public OptimizationPass, public ASTRewriter {
+private:
+    struct State {
+        std::vector<bool> known;   // slot -> value is known
+        std::vector<int> values;   // slot -> value if known
+    };
+    
+    State state;
+    std::vector<std::string>* log;
+    int rewrites;
+    
+    void mergeFrom(const State& other);
+    
+public:
+    ConstantPropagation() : log(nullptr), rewrites(0) {}
+    
+    std::string getName() const override { return "constant-propagation"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+    
+    using ASTRewriter::visit;
+    void visit(VariableExpression& node) override;
+    void visit(VariableDeclaration& node) override;
+    void visit(IfStatement& node) override;
+    void visit(ForStatement& node) override;
+};
+
+#endif // CONSTANT_PROPAGATION_H
@@ -0,0 +1,114 @@
+#include "DeadCodeElimination.h"
+#include <algorithm>
+#include <climits>
+#include <sstream>
+
+namespace {
+
+bool isEmptyBlock(const Statement* stmt) {
+    auto* block = dynamic_cast<const BlockStatement*>(stmt);
+    return block && block->statements.empty();
+}
+
+}
+
+int DeadCodeElimination::run(Program& program, std::vector<std::string>& passLog) {
+    log = &passLog;
+    rewrites = 0;
+    program.accept(*this);
+    return rewrites;
+}
+
+void DeadCodeElimination::removed(const std::string& what, int instructions) {
+    std::ostringstream oss;
+    oss << "Dead code: " << what << " (" << instructions << " instructions removed)";
+    log->push_back(oss.str());
+    rewrites++;
+    removedInstructions += instructions;
+}
+
+void DeadCodeElimination::removeEmptyBlocks(std::vector<std::unique_ptr<Statement>>& statements) {
+    for (auto& stmt : statements) {
+        if (isEmptyBlock(stmt.get())) {
+            // Emits nothing, so nothing is counted
+            removed("empty block", 0);
+            stmt = nullptr;
+        }
+    }
+    
+    statements.erase(std::remove(statements.begin(), statements.end(), nullptr), statements.end());
+}
+
+void DeadCodeElimination::visit(BlockStatement& node) {
+    ASTRewriter::visit(node);
+    removeEmptyBlocks(node.statements);
+}
+
+void DeadCodeElimination::visit(Program& node) {
+    ASTRewriter::visit(node);
+    removeEmptyBlocks(node.statements);
+}
+
+void DeadCodeElimination::visit(IfStatement& node) {
+    ASTRewriter::visit(node);
+    
+    int before = countInstructions(node);
+    
+    if (auto* literal = dynamic_cast<NumberExpression*>(node.condition.get())) {
+        if (literal->value != 0) {
+            int kept = countInstructions(*node.thenBranch);
+            removed("if condition is always true", before - kept);
+            replaceWith(std::move(node.thenBranch));
+        } else if (node.elseBranch) {
+            int kept = countInstructions(*node.elseBranch);
+            removed("if condition is always false", before - kept);
+            replaceWith(std::move(node.elseBranch));
+        } else {
+            removed("if condition is always false", before);
+            replaceWith(std::unique_ptr<Statement>());
+        }
+        return;
+    }
+    
+    if (node.elseBranch && isEmptyBlock(node.elseBranch.get())) {
+        node.elseBranch = nullptr;
+        removed("empty else branch", before - countInstructions(node));
+    }
+    
+    // The condition must still run if it could fail
+    if (!node.elseBranch && isEmptyBlock(node.thenBranch.get()) && !canTrap(*node.condition)) {
+        removed("if statement with empty branches", before);
+        replaceWith(std::unique_ptr<Statement>());
+    }
+}
+
+void DeadCodeElimination::visit(ForStatement& node) {
+    ASTRewriter::visit(node);
+    
+    auto* start = dynamic_cast<NumberExpression*>(node.start.get());
+    auto* end = dynamic_cast<NumberExpression*>(node.end.get());
+    if (!start || !end) {
+        return;
+    }
+    
+    // Value of the loop variable after the last iteration. A loop up to
+    // INT_MAX never ends, so it is left alone.
+    int finalValue;
+    std::string what;
+    if (start->value > end->value) {
+        finalValue = start->value;
+        what = "loop never runs";
+    } else if (isEmptyBlock(node.body.get()) && end->value < INT_MAX) {
+        finalValue = end->value + 1;
+        what = "loop has an empty body";
+    } else {
+        return;
+    }
+    
+    auto store = std::make_unique<VariableDeclaration>(node.variable,
+        std::make_unique<NumberExpression>(finalValue), node.symbol);
+    store->slot = node.slot;
+    
+    removed(what, countInstructions(node) - countInstructions(*store));
+    replaceWith(std::move(store));
+}
@@ -0,0 +1,43 @@
+#ifndef DEAD_CODE_ELIMINATION_H
+#define DEAD_CODE_ELIMINATION_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+
+// Removes statements that can never run or never have an effect:
+// - if statements with a literal condition keep only the branch taken
+// - empty else branches, and if statements with nothing in either branch
+//   whose condition cannot fail at run time
+// - for loops with literal bounds that never run, or whose body is empty;
+//   the final value of the loop variable is kept as a plain store, since a
+//   loop may assign a variable declared outside it
+// - empty blocks inside other blocks
+//
+// Each removal is logged with the number of instructions the removed code
+// would have cost (see countInstructions).
+class DeadCodeElimination : public OptimizationPass, public ASTRewriter {
+private:
+    std::vector<std::string>* log;
+    int rewrites;
+    int removedInstructions; // Total over every run since the last reset
+    
+    void removed(const std::string& what, int instructions);
+    void removeEmptyBlocks(std::vector<std::unique_ptr<Statement>>& statements);
+
+public:
+    DeadCodeElimination() : log(nullptr), rewrites(0), removedInstructions(0) {}
+    
+    std::string getName() const override { return "dead-code-elimination"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+    
+    int getRemovedInstructions() const { return removedInstructions; }
+    void resetRemovedInstructions() { removedInstructions = 0; }
+    
+    using ASTRewriter::visit;
+    void visit(BlockStatement& node) override;
+    void visit(IfStatement& node) override;
+    void visit(ForStatement& node) override;
+    void visit(Program& node) override;
+};
+
+#endif // DEAD_CODE_ELIMINATION_H
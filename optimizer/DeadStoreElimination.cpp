@@ -0,0 +1,108 @@
+#include "DeadStoreElimination.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+void markReads(const Expression& expr, std::vector<bool>& live) {
+    if (auto* variable = dynamic_cast<const VariableExpression*>(&expr)) {
+        live[variable->slot] = true;
+        return;
+    }
+    if (auto* binary = dynamic_cast<const BinaryExpression*>(&expr)) {
+        markReads(*binary->left, live);
+        markReads(*binary->right, live);
+    }
+}
+
+}
+
+int DeadStoreElimination::run(Program& program, std::vector<std::string>& passLog) {
+    log = &passLog;
+    rewrites = 0;
+    std::vector<bool> live(program.frameSize, false);
+    transferStatements(program.statements, live, true);
+    return rewrites;
+}
+
+void DeadStoreElimination::transferStatements(std::vector<std::unique_ptr<Statement>>& statements,
+                                              std::vector<bool>& live, bool remove) {
+    for (auto stmt = statements.rbegin(); stmt != statements.rend(); ++stmt) {
+        transfer(*stmt, live, remove);
+    }
+    if (remove) {
+        statements.erase(std::remove(statements.begin(), statements.end(), nullptr), statements.end());
+    }
+}
+
+void DeadStoreElimination::transfer(std::unique_ptr<Statement>& stmt, std::vector<bool>& live,
+                                    bool remove) {
+    if (auto* declaration = dynamic_cast<VariableDeclaration*>(stmt.get())) {
+        if (!live[declaration->slot] && !canTrap(*declaration->initializer)) {
+            if (remove) {
+                // A literal or a copy costs nothing: it only names a value
+                int removed = countInstructions(*declaration);
+                std::ostringstream oss;
+                oss << "Dead store: let " << declaration->name << " = "
+                    << expressionToString(*declaration->initializer) << " is never read";
+                if (removed > 0) {
+                    oss << " (" << removed << " instructions removed)";
+                }
+                log->push_back(oss.str());
+                rewrites++;
+                stmt = nullptr;
+            }
+            return;
+        }
+        live[declaration->slot] = false;
+        markReads(*declaration->initializer, live);
+    } else if (auto* print = dynamic_cast<PrintStatement*>(stmt.get())) {
+        markReads(*print->expression, live);
+    } else if (auto* block = dynamic_cast<BlockStatement*>(stmt.get())) {
+        transferStatements(block->statements, live, remove);
+    } else if (auto* branch = dynamic_cast<IfStatement*>(stmt.get())) {
+        std::vector<bool> elseLive = live;
+        transfer(branch->thenBranch, live, remove);
+        if (branch->elseBranch) {
+            transfer(branch->elseBranch, elseLive, remove);
+        }
+        for (size_t slot = 0; slot < live.size(); ++slot) {
+            live[slot] = live[slot] || elseLive[slot];
+        }
+        // A removed branch is an empty block; a removed else is dropped
+        if (!branch->thenBranch) {
+            branch->thenBranch = std::make_unique<BlockStatement>();
+        }
+        markReads(*branch->condition, live);
+    } else if (auto* loop = dynamic_cast<ForStatement*>(stmt.get())) {
+        // Slots live at the test: those live after the loop, the ones the
+        // bound and the test read, and those live at the start of the body,
+        // which continues at the test again
+        std::vector<bool> test = live;
+        markReads(*loop->end, test);
+        test[loop->slot] = true;
+        bool changed = true;
+        while (changed) {
+            std::vector<bool> body = test;
+            transfer(loop->body, body, false);
+            changed = false;
+            for (size_t slot = 0; slot < test.size(); ++slot) {
+                if (body[slot] && !test[slot]) {
+                    test[slot] = true;
+                    changed = true;
+                }
+            }
+        }
+        if (remove) {
+            std::vector<bool> body = test;
+            transfer(loop->body, body, true);
+            if (!loop->body) {
+                loop->body = std::make_unique<BlockStatement>();
+            }
+        }
+
+        live = test;
+        live[loop->slot] = false;
+        markReads(*loop->start, live);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef DEAD_STORE_ELIMINATION_H
+#define DEAD_STORE_ELIMINATION_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+
+// Removes assignments whose value is never read.
+//
+// Backward liveness over the frame slots: a slot is live before a
+// statement if some path from there reads it before assigning it. Nothing
+// is live at the end of the program; a for loop is followed around until
+// the slots live at its test stop growing. A declaration or assignment to
+// a slot that is dead after it is removed together with its initializer,
+// unless the initializer can fail at run time. Since a removed assignment
+// reads nothing, a whole chain of them goes in one run:
+//   let a = x * 2; let b = a + 1; print x;
+// becomes
+//   print x;
+class DeadStoreElimination : public OptimizationPass {
+private:
+    std::vector<std::string>* log;
+    int rewrites;
+
+    // Turns the slots live after stmt into the slots live before it. With
+    // remove, dead stores are deleted on the way (stmt becomes nullptr if
+    // it is one).
+    void transfer(std::unique_ptr<Statement>& stmt, std::vector<bool>& live, bool remove);
+    void transferStatements(std::vector<std::unique_ptr<Statement>>& statements,
+                            std::vector<bool>& live, bool remove);
+
+public:
+    DeadStoreElimination() : log(nullptr), rewrites(0) {}
+
+    std::string getName() const override { return "dead-store-elimination"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+};
+
+#endif // DEAD_STORE_ELIMINATION_H
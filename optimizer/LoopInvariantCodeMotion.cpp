@@ -0,0 +1,156 @@
+#include "LoopInvariantCodeMotion.h"
+#include <sstream>
+
+namespace {
+
+// Replaces the invariant parts of every expression in one loop with reads
+// of temporaries and keeps the hoisted expressions
+class InvariantHoister : public ASTVisitor {
+private:
+    const std::vector<bool>& assigned;
+    Program& program;
+
+    // Whether expr is invariant and safe to evaluate before the loop. Parts
+    // of an expression that is not are hoisted on their own.
+    bool scan(std::unique_ptr<Expression>& expr) {
+        if (dynamic_cast<NumberExpression*>(expr.get())) {
+            return true;
+        }
+        if (auto* variable = dynamic_cast<VariableExpression*>(expr.get())) {
+            return !assigned[variable->slot];
+        }
+
+        auto* binary = static_cast<BinaryExpression*>(expr.get());
+        bool left = scan(binary->left);
+        bool right = scan(binary->right);
+        auto* divisor = dynamic_cast<NumberExpression*>(binary->right.get());
+        bool safe = binary->op != BinaryOp::DIV || (divisor && divisor->value != 0);
+        if (left && right && safe) {
+            return true;
+        }
+
+        if (left) hoist(binary->left);
+        if (right) hoist(binary->right);
+        return false;
+    }
+
+    void hoistRoot(std::unique_ptr<Expression>& expr) {
+        if (scan(expr)) {
+            hoist(expr);
+        }
+    }
+
+    static bool readsVariable(const Expression& expr) {
+        if (dynamic_cast<const VariableExpression*>(&expr)) {
+            return true;
+        }
+        auto* binary = dynamic_cast<const BinaryExpression*>(&expr);
+        return binary && (readsVariable(*binary->left) || readsVariable(*binary->right));
+    }
+
+    void hoist(std::unique_ptr<Expression>& expr) {
+        // A literal or variable costs as much as reading a temporary, and
+        // constant folding takes care of expressions of literals
+        if (!dynamic_cast<BinaryExpression*>(expr.get()) || !readsVariable(*expr)) {
+            return;
+        }
+
+        size_t index = 0;
+        while (index < hoisted.size() && !sameExpression(*hoisted[index]->initializer, *expr)) {
+            index++;
+        }
+        if (index == hoisted.size()) {
+            std::string name = "$t" + std::to_string(program.frameSize);
+            auto temporary = std::make_unique<VariableDeclaration>(name, std::move(expr),
+                                                                   program.symbols.intern(name));
+            temporary->slot = program.frameSize++;
+            hoisted.push_back(std::move(temporary));
+        }
+
+        const VariableDeclaration& temporary = *hoisted[index];
+        auto read = std::make_unique<VariableExpression>(temporary.name, temporary.symbol);
+        read->slot = temporary.slot;
+        expr = std::move(read);
+    }
+
+public:
+    // Declarations of the temporaries, in order
+    std::vector<std::unique_ptr<VariableDeclaration>> hoisted;
+
+    InvariantHoister(const std::vector<bool>& assignedSlots, Program& prog)
+        : assigned(assignedSlots), program(prog) {}
+
+    void hoistFromBound(ForStatement& loop) {
+        hoistRoot(loop.end);
+    }
+
+    void visit(NumberExpression& node) override {}
+    void visit(VariableExpression& node) override {}
+    void visit(BinaryExpression& node) override {}
+    void visit(VariableDeclaration& node) override { hoistRoot(node.initializer); }
+    void visit(PrintStatement& node) override { hoistRoot(node.expression); }
+    void visit(BlockStatement& node) override {
+        for (auto& stmt : node.statements) {
+            stmt->accept(*this);
+        }
+    }
+    void visit(IfStatement& node) override {
+        hoistRoot(node.condition);
+        node.thenBranch->accept(*this);
+        if (node.elseBranch) {
+            node.elseBranch->accept(*this);
+        }
+    }
+    void visit(ForStatement& node) override {
+        hoistRoot(node.start);
+        hoistRoot(node.end);
+        node.body->accept(*this);
+    }
+    void visit(Program& node) override {}
+};
+
+}
+
+int LoopInvariantCodeMotion::run(Program& prog, std::vector<std::string>& passLog) {
+    program = &prog;
+    log = &passLog;
+    rewrites = 0;
+    prog.accept(*this);
+    return rewrites;
+}
+
+void LoopInvariantCodeMotion::visit(ForStatement& node) {
+    std::vector<bool> assigned(program->frameSize, false);
+    collectAssignedSlots(node, assigned);
+
+    InvariantHoister hoister(assigned, *program);
+    hoister.hoistFromBound(node);
+    node.body->accept(hoister);
+
+    // Inner loops hoist what is invariant in them but not in this loop
+    rewriteRequired(node.body);
+
+    if (hoister.hoisted.empty()) {
+        return;
+    }
+
+    auto block = std::make_unique<BlockStatement>();
+    for (auto& temporary : hoister.hoisted) {
+        std::ostringstream oss;
+        oss << "Loop-invariant code motion: " << temporary->name << " = "
+            << expressionToString(*temporary->initializer) << " hoisted out of the loop over "
+            << node.variable << " (" << countInstructions(*temporary->initializer) - 1
+            << " instructions saved per use)";
+        log->push_back(oss.str());
+        rewrites++;
+        block->statements.push_back(std::move(temporary));
+    }
+
+    auto loop = std::make_unique<ForStatement>(node.variable, std::move(node.start),
+                                               std::move(node.end), std::move(node.body),
+                                               node.symbol);
+    loop->slot = node.slot;
+    loop->location = node.location;
+    block->statements.push_back(std::move(loop));
+    replaceWith(std::move(block));
+}
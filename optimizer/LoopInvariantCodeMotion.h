@@ -0,0 +1,39 @@
+#ifndef LOOP_INVARIANT_CODE_MOTION_H
+#define LOOP_INVARIANT_CODE_MOTION_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+
+// Moves computations whose value cannot change while a for loop runs out
+// of the loop.
+//
+// A subexpression of the loop bound or the body is invariant if it reads
+// no variable the loop assigns (see collectAssignedSlots). Every maximal
+// invariant binary expression is computed once into a fresh temporary in
+// front of the loop, and the loop reads the temporary instead. Identical
+// expressions share one temporary. The loop
+//   for i = 1 to n * 2 { print i * (a + b); }
+// becomes
+//   { let $t0 = n * 2; let $t1 = a + b; for i = 1 to $t0 { print i * $t1; } }
+//
+// Hoisted code runs even if the loop does not, so expressions that can fail
+// at run time (division by anything but a non-zero literal) stay where they
+// are. Outer loops are handled first, so an expression leaves as many
+// levels of nesting as it is invariant in.
+class LoopInvariantCodeMotion : public OptimizationPass, public ASTRewriter {
+private:
+    Program* program;
+    std::vector<std::string>* log;
+    int rewrites;
+
+public:
+    LoopInvariantCodeMotion() : program(nullptr), log(nullptr), rewrites(0) {}
+
+    std::string getName() const override { return "loop-invariant-code-motion"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+
+    using ASTRewriter::visit;
+    void visit(ForStatement& node) override;
+};
+
+#endif // LOOP_INVARIANT_CODE_MOTION_H
@@ -0,0 +1,232 @@
+#include "LoopUnrolling.h"
+#include <algorithm>
+#include <climits>
+#include <sstream>
+
+namespace {
+
+// Replaces every read of one slot with a copy of an expression
+class SlotSubstitution : public ASTRewriter {
+private:
+    int slot;
+    const Expression& value;
+
+public:
+    SlotSubstitution(int variableSlot, const Expression& replacement)
+        : slot(variableSlot), value(replacement) {}
+
+    using ASTRewriter::visit;
+    void visit(VariableExpression& node) override {
+        if (node.slot == slot) {
+            replaceWith(value.clone());
+        }
+    }
+};
+
+class ReadCounter : public ASTRewriter {
+private:
+    int slot;
+
+public:
+    int count;
+
+    explicit ReadCounter(int variableSlot) : slot(variableSlot), count(0) {}
+
+    using ASTRewriter::visit;
+    void visit(VariableExpression& node) override {
+        if (node.slot == slot) {
+            count++;
+        }
+    }
+};
+
+std::unique_ptr<Expression> makeRead(const ForStatement& loop) {
+    auto read = std::make_unique<VariableExpression>(loop.variable, loop.symbol);
+    read->slot = loop.slot;
+    return read;
+}
+
+std::unique_ptr<Statement> makeStore(const ForStatement& loop, std::unique_ptr<Expression> value) {
+    auto store = std::make_unique<VariableDeclaration>(loop.variable, std::move(value), loop.symbol);
+    store->slot = loop.slot;
+    return store;
+}
+
+// Appends a copy of body to statements, with value in place of the loop
+// variable (or the variable itself if value is nullptr). Blocks are
+// spliced in, since every variable already has its slot.
+void appendCopy(std::vector<std::unique_ptr<Statement>>& statements, const ForStatement& loop,
+                const Expression* value) {
+    auto copy = loop.body->clone();
+    if (value) {
+        SlotSubstitution substitution(loop.slot, *value);
+        copy->accept(substitution);
+    }
+    if (auto* block = dynamic_cast<BlockStatement*>(copy.get())) {
+        for (auto& stmt : block->statements) {
+            statements.push_back(std::move(stmt));
+        }
+    } else {
+        statements.push_back(std::move(copy));
+    }
+}
+
+// Instructions a loop of tripCount iterations runs besides its body: PUSH
+// STORE, then LOAD PUSH GT JMP_IF_TRUE and LOAD PUSH ADD STORE JMP per
+// iteration, and LOAD PUSH GT JMP_IF_TRUE on exit
+int64_t loopOverhead(int64_t tripCount) {
+    return 2 + 9 * tripCount + 4;
+}
+
+}
+
+int LoopUnrolling::run(Program& prog, std::vector<std::string>& passLog) {
+    program = &prog;
+    log = &passLog;
+    rewrites = 0;
+    prog.accept(*this);
+    return rewrites;
+}
+
+void LoopUnrolling::visit(ForStatement& node) {
+    // Inner loops first, so that an outer loop sees their unrolled size
+    ASTRewriter::visit(node);
+
+    auto* start = dynamic_cast<NumberExpression*>(node.start.get());
+    auto* end = dynamic_cast<NumberExpression*>(node.end.get());
+    if (!start || !end || start->value > end->value || end->value == INT_MAX ||
+        node.variable[0] == '$') {
+        return;
+    }
+
+    std::vector<bool> assigned(program->frameSize, false);
+    collectAssignedSlots(*node.body, assigned);
+    int bodySize = countInstructions(*node.body);
+    if (assigned[node.slot] || bodySize == 0) {
+        return;
+    }
+
+    // Loops the optimizer made up have no profile entry of their own
+    const ProfileSite* site = profile && node.location.isKnown()
+        ? profile->find(node.location, ProfileSite::Kind::FOR) : nullptr;
+    bool hot = site && site->taken >= HOT_ITERATIONS;
+    if ((hotLoopsOnly && !hot) || (site && site->taken == 0)) {
+        return;
+    }
+    int factor = hot ? 2 * unrollFactor : unrollFactor;
+    int budget = hot ? 2 * sizeBudget : sizeBudget;
+
+    int64_t tripCount = static_cast<int64_t>(end->value) - start->value + 1;
+    int before = countInstructions(node);
+    std::unique_ptr<Statement> replacement;
+    int64_t saved = 0;
+    std::string how;
+
+    if (tripCount * bodySize <= budget) {
+        replacement = unrollCompletely(node, tripCount);
+        // The final value of the loop variable is a literal, which costs
+        // nothing until it is read
+        saved = loopOverhead(tripCount);
+        how = "unrolled completely (" + std::to_string(tripCount) + " copies)";
+    } else {
+        factor = static_cast<int>(std::min<int64_t>(std::min(factor, budget / bodySize), tripCount));
+        if (factor < 2) {
+            return;
+        }
+        replacement = unrollPartially(node, tripCount, factor, saved);
+        if (!replacement) {
+            return;
+        }
+        how = "unrolled by " + std::to_string(factor);
+        if (tripCount % factor != 0) {
+            how += " with a remainder loop of " + std::to_string(tripCount % factor) + " iterations";
+        }
+    }
+
+    std::ostringstream oss;
+    oss << "Loop unrolling: loop over " << node.variable << " from " << start->value << " to "
+        << end->value << " " << how << " (" << countInstructions(*replacement) - before
+        << " instructions added, " << saved << " fewer executed)";
+    if (hot) {
+        oss << ", hot in the profile (" << site->taken << " iterations)";
+    }
+    log->push_back(oss.str());
+    rewrites++;
+    replaceWith(std::move(replacement));
+}
+
+std::unique_ptr<Statement> LoopUnrolling::unrollCompletely(ForStatement& node, int64_t tripCount) {
+    auto block = std::make_unique<BlockStatement>();
+    int32_t first = static_cast<NumberExpression&>(*node.start).value;
+    for (int64_t k = 0; k < tripCount; ++k) {
+        NumberExpression value(static_cast<int32_t>(first + k));
+        appendCopy(block->statements, node, &value);
+    }
+
+    // The loop variable may be declared outside the loop
+    block->statements.push_back(makeStore(node,
+        std::make_unique<NumberExpression>(static_cast<int32_t>(first + tripCount))));
+    return block;
+}
+
+std::unique_ptr<Statement> LoopUnrolling::unrollPartially(ForStatement& node, int64_t tripCount,
+                                                          int factor, int64_t& saved) {
+    int32_t first = static_cast<NumberExpression&>(*node.start).value;
+    int64_t iterations = tripCount / factor;
+    int64_t remainder = tripCount % factor;
+
+    // Reading i + k costs a PUSH and an ADD per read, advancing i costs
+    // LOAD PUSH ADD STORE per copy
+    ReadCounter reads(node.slot);
+    node.body->accept(reads);
+    bool offsets = 2 * reads.count * (factor - 1) + 4 <= 4 * factor;
+    int64_t perIteration = offsets ? 2 * reads.count * (factor - 1) + 4 : 4 * factor;
+
+    int64_t after = 2 + loopOverhead(iterations) + perIteration * iterations +
+                    (remainder > 0 ? loopOverhead(remainder) : 0);
+    saved = loopOverhead(tripCount) - after;
+    if (saved <= 0) {
+        return nullptr;
+    }
+
+    auto increment = [&](int32_t amount) {
+        return makeStore(node, std::make_unique<BinaryExpression>(BinaryOp::ADD, makeRead(node),
+                                                                  std::make_unique<NumberExpression>(amount)));
+    };
+
+    auto body = std::make_unique<BlockStatement>();
+    for (int k = 0; k < factor; ++k) {
+        if (!offsets) {
+            appendCopy(body->statements, node, nullptr);
+            body->statements.push_back(increment(1));
+        } else if (k == 0) {
+            appendCopy(body->statements, node, nullptr);
+        } else {
+            BinaryExpression value(BinaryOp::ADD, makeRead(node), std::make_unique<NumberExpression>(k));
+            appendCopy(body->statements, node, &value);
+        }
+    }
+    if (offsets) {
+        body->statements.push_back(increment(factor));
+    }
+
+    int slot = program->frameSize++;
+    std::string name = "$u" + std::to_string(slot);
+    auto counter = std::make_unique<ForStatement>(name, std::make_unique<NumberExpression>(1),
+        std::make_unique<NumberExpression>(static_cast<int32_t>(iterations)), std::move(body),
+        program->symbols.intern(name));
+    counter->slot = slot;
+
+    auto block = std::make_unique<BlockStatement>();
+    block->statements.push_back(makeStore(node, std::make_unique<NumberExpression>(first)));
+    block->statements.push_back(std::move(counter));
+    if (remainder > 0) {
+        auto rest = std::make_unique<ForStatement>(node.variable,
+            std::make_unique<NumberExpression>(static_cast<int32_t>(first + iterations * factor)),
+            node.end->clone(), node.body->clone(), node.symbol);
+        rest->slot = node.slot;
+        rest->location = node.location;
+        block->statements.push_back(std::move(rest));
+    }
+    return block;
+}
@@ -0,0 +1,67 @@
+#ifndef LOOP_UNROLLING_H
+#define LOOP_UNROLLING_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+#include "../vm/Profile.h"
+
+// Copies the body of for loops with literal bounds, so that fewer
+// iterations pay for the compare, the jumps and the increment.
+//
+// A loop qualifies when its body does not assign the loop variable. Its
+// body may then be copied as long as the copies take at most sizeBudget
+// instructions:
+// - a loop whose every iteration fits is unrolled completely, with the
+//   value of the loop variable folded into each copy
+//     for i = 1 to 3 { print i * i; }
+//   becomes
+//     { print 1 * 1; print 2 * 2; print 3 * 3; let i = 4; }
+// - a longer loop runs unrollFactor copies (fewer if the budget is smaller)
+//   per iteration of a new counter loop, followed by a remainder loop over
+//   the iterations left. The copies read the loop variable plus their
+//   offset, or, when they read it often, advance it in between.
+//     for i = 1 to 11 { print i; }
+//   becomes
+//     { let i = 1; for $u = 1 to 5 { print i; print i + 1; let i = i + 2; }
+//       for i = 11 to 11 { print i; } }
+//   with an unroll factor of 2 and a budget too small for 11 copies; the
+//   remainder loop is unrolled completely in the next round.
+//
+// With a profile, loops are picked by how often they ran: a loop that
+// never ran is left alone, and a hot one (at least HOT_ITERATIONS
+// iterations) gets twice the unroll factor and budget. With hotLoopsOnly,
+// as at level 2, only hot loops are unrolled at all.
+//
+// Counter loops are never unrolled again. Each unrolled loop is logged
+// with the instructions it adds to the program and the instructions it
+// saves when run, as countInstructions counts them.
+class LoopUnrolling : public OptimizationPass, public ASTRewriter {
+private:
+    Program* program;
+    std::vector<std::string>* log;
+    int rewrites;
+    int unrollFactor;
+    int sizeBudget;
+    const Profile* profile;
+    bool hotLoopsOnly;
+
+    std::unique_ptr<Statement> unrollCompletely(ForStatement& node, int64_t tripCount);
+    std::unique_ptr<Statement> unrollPartially(ForStatement& node, int64_t tripCount,
+                                               int factor, int64_t& saved);
+
+public:
+    static const long long HOT_ITERATIONS = 100;
+
+    explicit LoopUnrolling(int factor = 4, int budget = 64, const Profile* loopProfile = nullptr,
+                           bool onlyHot = false)
+        : program(nullptr), log(nullptr), rewrites(0), unrollFactor(factor), sizeBudget(budget),
+          profile(loopProfile), hotLoopsOnly(onlyHot) {}
+
+    std::string getName() const override { return "loop-unrolling"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+
+    using ASTRewriter::visit;
+    void visit(ForStatement& node) override;
+};
+
+#endif // LOOP_UNROLLING_H
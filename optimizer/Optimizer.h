@@ -2,37 +2,35 @@
 #define OPTIMIZER_H
 
 #include <memory>
-#include <map>
 #include <string>
 #include <vector>
 #include "../ast/AST.h"
+#include "PassManager.h"
+#include "../vm/Profile.h"
 
-class Optimizer : public ASTVisitor {
+class DeadCodeElimination;
+
+// Runs the optimization passes over an analyzed program (variables must
+// have their frame slots) and keeps a report of every rewrite.
+//
+// The level selects the passes, as for CompilerOptions:
+// 1: constant propagation, constant folding and dead code elimination
+// 2: also scalar evolution, strength reduction, dead store elimination and
+//    loop-invariant code motion
+// 3: also loop unrolling
+// A profile makes loop unrolling favor hot loops, and at level 2 adds it
+// for hot loops alone (see LoopUnrolling); it must outlive the optimizer.
+class Optimizer {
 private:
-    std::map<std::string, int> constantValues; // For constant propagation
+    PassManager passManager;
+    DeadCodeElimination* deadCode; // Owned by passManager
     std::vector<std::string> optimizations; // Log of optimizations performed
-    bool modified;
-    
-    // Helper methods
-    bool isConstant(Expression* expr, int& value);
-    std::unique_ptr<Expression> optimizeExpression(std::unique_ptr<Expression> expr);
     
 public:
-    Optimizer() : modified(false) {}
+    explicit Optimizer(int level = 2, const Profile* profile = nullptr);
     
     std::unique_ptr<Program> optimize(std::unique_ptr<Program> program);
     
-    // Visitor methods
-    void visit(NumberExpression& node) override;
-    void visit(VariableExpression& node) override;
-    void visit(BinaryExpression& node) override;
-    void visit(VariableDeclaration& node) override;
-    void visit(PrintStatement& node) override;
-    void visit(BlockStatement& node) override;
-    void visit(IfStatement& node) override;
-    void visit(ForStatement& node) override;
-    void visit(Program& node) override;
-    
     const std::vector<std::string>& getOptimizations() const { return optimizations; }
     std::string getOptimizationReport() const;
 };
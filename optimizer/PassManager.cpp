@@ -0,0 +1,37 @@
+#include "PassManager.h"
+#include <chrono>
+
+void PassManager::addPass(std::unique_ptr<OptimizationPass> pass) {
+    statistics.push_back({pass->getName(), 0, 0, 0.0});
+    passes.push_back(std::move(pass));
+}
+
+int PassManager::run(Program& program, std::vector<std::string>& log) {
+    for (auto& stats : statistics) {
+        stats.runs = 0;
+        stats.rewrites = 0;
+        stats.milliseconds = 0.0;
+    }
+    
+    int total = 0;
+    rounds = 0;
+    bool changed = true;
+    
+    while (changed && rounds < maxRounds) {
+        changed = false;
+        rounds++;
+        
+        for (size_t i = 0; i < passes.size(); ++i) {
+            auto start = std::chrono::steady_clock::now();
+            int rewrites = passes[i]->run(program, log);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            statistics[i].milliseconds += elapsed.count();
+            statistics[i].runs++;
+            statistics[i].rewrites += rewrites;
+            total += rewrites;
+            changed = changed || rewrites > 0;
+        }
+    }
+    
+    return total;
+}
@@ -0,0 +1,50 @@
+#ifndef PASS_MANAGER_H
+#define PASS_MANAGER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../ast/AST.h"
+
+// A transformation over the whole program
+class OptimizationPass {
+public:
+    virtual ~OptimizationPass() = default;
+    
+    virtual std::string getName() const = 0;
+    
+    // Rewrites program in place and appends one line per rewrite to log.
+    // Returns the number of rewrites; 0 means the program is unchanged.
+    virtual int run(Program& program, std::vector<std::string>& log) = 0;
+};
+
+struct PassStatistics {
+    std::string name;
+    int runs;
+    int rewrites;
+    double milliseconds; // Wall time of all runs
+};
+
+// Runs the registered passes in order, round after round, until a whole
+// round changes nothing (or maxRounds is reached), so that the rewrites of
+// one pass can enable further rewrites of the others.
+class PassManager {
+private:
+    std::vector<std::unique_ptr<OptimizationPass>> passes;
+    std::vector<PassStatistics> statistics;
+    int maxRounds;
+    int rounds;
+    
+public:
+    explicit PassManager(int maxRoundCount = 16) : maxRounds(maxRoundCount), rounds(0) {}
+    
+    void addPass(std::unique_ptr<OptimizationPass> pass);
+    
+    // Returns the total number of rewrites
+    int run(Program& program, std::vector<std::string>& log);
+    
+    const std::vector<PassStatistics>& getStatistics() const { return statistics; }
+    int getRounds() const { return rounds; }
+};
+
+#endif // PASS_MANAGER_H
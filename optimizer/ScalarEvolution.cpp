@@ -0,0 +1,531 @@
+#include "ScalarEvolution.h"
+#include <climits>
+#include <sstream>
+
+namespace {
+
+std::unique_ptr<Expression> makeNumber(int32_t value) {
+    return std::make_unique<NumberExpression>(value);
+}
+
+std::unique_ptr<Expression> makeBinary(BinaryOp op, std::unique_ptr<Expression> left,
+                                       std::unique_ptr<Expression> right) {
+    return std::make_unique<BinaryExpression>(op, std::move(left), std::move(right));
+}
+
+std::unique_ptr<Expression> makeRead(const VariableDeclaration& variable) {
+    auto read = std::make_unique<VariableExpression>(variable.name, variable.symbol);
+    read->slot = variable.slot;
+    return read;
+}
+
+std::unique_ptr<Expression> copy(const std::unique_ptr<Expression>& term) {
+    return term ? term->clone() : nullptr;
+}
+
+// left op right for op in + - *, where nullptr stands for 0. Literals are
+// folded, so a term that folds to 0 is nullptr again.
+std::unique_ptr<Expression> combine(BinaryOp op, std::unique_ptr<Expression> left,
+                                    std::unique_ptr<Expression> right) {
+    auto* leftNumber = dynamic_cast<NumberExpression*>(left.get());
+    auto* rightNumber = dynamic_cast<NumberExpression*>(right.get());
+    if (leftNumber && leftNumber->value == 0) {
+        left = nullptr;
+        leftNumber = nullptr;
+    }
+    if (rightNumber && rightNumber->value == 0) {
+        right = nullptr;
+        rightNumber = nullptr;
+    }
+
+    if (op == BinaryOp::MUL) {
+        if (!left || !right) return nullptr;
+        if (leftNumber && leftNumber->value == 1) return right;
+        if (rightNumber && rightNumber->value == 1) return left;
+    } else {
+        if (!right) return left;
+        if (!left && op == BinaryOp::ADD) return right;
+        if (!left) {
+            left = makeNumber(0);
+            leftNumber = static_cast<NumberExpression*>(left.get());
+        }
+    }
+
+    int32_t result = 0;
+    if (leftNumber && rightNumber && evaluateBinaryOp(op, leftNumber->value, rightNumber->value, result)) {
+        return result == 0 ? nullptr : makeNumber(result);
+    }
+    return makeBinary(op, std::move(left), std::move(right));
+}
+
+bool readsSlot(const Expression& expr, const std::vector<bool>& slots) {
+    if (auto* variable = dynamic_cast<const VariableExpression*>(&expr)) {
+        return variable->slot < static_cast<int>(slots.size()) && slots[variable->slot];
+    }
+    auto* binary = dynamic_cast<const BinaryExpression*>(&expr);
+    return binary && (readsSlot(*binary->left, slots) || readsSlot(*binary->right, slots));
+}
+
+// expr as coefficient * i + offset, with both parts free of i
+struct Affine {
+    std::unique_ptr<Expression> coefficient;
+    std::unique_ptr<Expression> offset;
+};
+
+bool toAffine(const Expression& expr, const std::vector<bool>& loopSlot, Affine& result) {
+    if (!readsSlot(expr, loopSlot)) {
+        result.coefficient = nullptr;
+        result.offset = combine(BinaryOp::ADD, expr.clone(), nullptr);
+        return true;
+    }
+    if (dynamic_cast<const VariableExpression*>(&expr)) {
+        result.coefficient = makeNumber(1);
+        result.offset = nullptr;
+        return true;
+    }
+
+    auto& binary = static_cast<const BinaryExpression&>(expr);
+    Affine left, right;
+    if (!toAffine(*binary.left, loopSlot, left) || !toAffine(*binary.right, loopSlot, right)) {
+        return false;
+    }
+    switch (binary.op) {
+        case BinaryOp::ADD:
+        case BinaryOp::SUB:
+            result.coefficient = combine(binary.op, std::move(left.coefficient), std::move(right.coefficient));
+            result.offset = combine(binary.op, std::move(left.offset), std::move(right.offset));
+            return true;
+        case BinaryOp::MUL:
+            if (left.coefficient && right.coefficient) {
+                return false;
+            }
+            if (left.coefficient) {
+                std::swap(left, right);
+            }
+            result.coefficient = combine(BinaryOp::MUL, copy(left.offset), std::move(right.coefficient));
+            result.offset = combine(BinaryOp::MUL, std::move(left.offset), std::move(right.offset));
+            return true;
+        case BinaryOp::SHL: {
+            // x << k is x * 2^k in wrapping arithmetic
+            auto* amount = dynamic_cast<const NumberExpression*>(binary.right.get());
+            if (!amount || amount->value < 0 || amount->value > 31) {
+                return false;
+            }
+            auto factor = makeNumber(BinaryOps::shl(1, amount->value));
+            result.coefficient = combine(BinaryOp::MUL, std::move(left.coefficient), factor->clone());
+            result.offset = combine(BinaryOp::MUL, std::move(left.offset), std::move(factor));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Value of expr in the iteration where the loop variable is i; false if
+// it reads another variable
+bool evaluate(const Expression& expr, int loopSlot, int32_t i, int32_t& result) {
+    if (auto* number = dynamic_cast<const NumberExpression*>(&expr)) {
+        result = number->value;
+        return true;
+    }
+    if (auto* variable = dynamic_cast<const VariableExpression*>(&expr)) {
+        result = i;
+        return variable->slot == loopSlot;
+    }
+    auto& binary = static_cast<const BinaryExpression&>(expr);
+    int32_t left = 0, right = 0;
+    return evaluate(*binary.left, loopSlot, i, left) && evaluate(*binary.right, loopSlot, i, right) &&
+           evaluateBinaryOp(binary.op, left, right, result);
+}
+
+// x * (x - 1) / 2 modulo 2^32, for any 64-bit x that is exact
+int32_t choose2(int64_t x) {
+    uint64_t value = static_cast<uint64_t>(x);
+    uint64_t product = x % 2 == 0 ? static_cast<uint64_t>(x / 2) * (value - 1)
+                                  : value * static_cast<uint64_t>((x - 1) / 2);
+    return static_cast<int32_t>(static_cast<uint32_t>(product));
+}
+
+// The same at run time, given h = x >> 1 (rounded down): x * (x - 1) / 2
+// is h * (x - 1) for even x and h * x for odd x, i.e. h * (2x - 2h - 1).
+// Only exact halvings happen, so the wrapped products are still right.
+std::unique_ptr<Expression> choose2(const Expression& x, const Expression& h) {
+    auto twice = makeBinary(BinaryOp::ADD, x.clone(), x.clone());
+    auto odd = makeBinary(BinaryOp::SUB, std::move(twice), makeBinary(BinaryOp::ADD, h.clone(), h.clone()));
+    return makeBinary(BinaryOp::MUL, h.clone(), makeBinary(BinaryOp::SUB, std::move(odd), makeNumber(1)));
+}
+
+// expr with every read of a slot that has a value replaced by it
+std::unique_ptr<Expression> substitute(const Expression& expr, const std::vector<const Expression*>& values) {
+    auto* variable = dynamic_cast<const VariableExpression*>(&expr);
+    if (variable && variable->slot < static_cast<int>(values.size()) && values[variable->slot]) {
+        return values[variable->slot]->clone();
+    }
+    auto* binary = dynamic_cast<const BinaryExpression*>(&expr);
+    if (!binary) {
+        return expr.clone();
+    }
+    return makeBinary(binary->op, substitute(*binary->left, values), substitute(*binary->right, values));
+}
+
+int32_t power(int32_t base, uint64_t exponent) {
+    uint32_t result = 1;
+    uint32_t factor = static_cast<uint32_t>(base);
+    while (exponent > 0) {
+        if (exponent & 1) result *= factor;
+        factor *= factor;
+        exponent >>= 1;
+    }
+    return static_cast<int32_t>(result);
+}
+
+bool collectUpdates(Statement& stmt, std::vector<VariableDeclaration*>& updates) {
+    if (auto* block = dynamic_cast<BlockStatement*>(&stmt)) {
+        for (auto& child : block->statements) {
+            if (!collectUpdates(*child, updates)) return false;
+        }
+        return true;
+    }
+    auto* declaration = dynamic_cast<VariableDeclaration*>(&stmt);
+    if (!declaration) {
+        return false;
+    }
+    updates.push_back(declaration);
+    return true;
+}
+
+bool isSlot(const Expression& expr, int slot) {
+    auto* variable = dynamic_cast<const VariableExpression*>(&expr);
+    return variable && variable->slot == slot;
+}
+
+}
+
+int ScalarEvolution::run(Program& prog, std::vector<std::string>& passLog) {
+    program = &prog;
+    log = &passLog;
+    rewrites = 0;
+    ranges.assign(prog.frameSize, {false, 0, 0});
+    prog.accept(*this);
+    return rewrites;
+}
+
+ScalarEvolution::Range ScalarEvolution::rangeOf(const Expression& expr) const {
+    if (auto* number = dynamic_cast<const NumberExpression*>(&expr)) {
+        return {true, number->value, number->value};
+    }
+    auto* variable = dynamic_cast<const VariableExpression*>(&expr);
+    if (variable && variable->slot < static_cast<int>(ranges.size())) {
+        return ranges[variable->slot];
+    }
+    return {false, 0, 0};
+}
+
+void ScalarEvolution::visit(ForStatement& node) {
+    rewrite(node.start);
+    rewrite(node.end);
+
+    // The loop variable stays within the bounds unless the body assigns it
+    std::vector<bool> assigned(program->frameSize, false);
+    collectAssignedSlots(*node.body, assigned);
+    Range start = rangeOf(*node.start);
+    Range end = rangeOf(*node.end);
+    Range outer = ranges[node.slot];
+    ranges[node.slot] = {start.known && end.known && !assigned[node.slot], start.min, end.max};
+    rewriteRequired(node.body);
+    ranges[node.slot] = outer;
+
+    // Temporaries of a closed form that is given up are not kept
+    int frameSize = program->frameSize;
+    std::vector<std::string> lines;
+    auto replacement = closedForm(node, lines);
+    if (!replacement) {
+        program->frameSize = frameSize;
+        return;
+    }
+    log->insert(log->end(), lines.begin(), lines.end());
+    rewrites++;
+    replaceWith(std::move(replacement));
+}
+
+
+std::unique_ptr<Statement> ScalarEvolution::closedForm(ForStatement& node, std::vector<std::string>& lines) {
+    std::vector<VariableDeclaration*> updates;
+    if (!collectUpdates(*node.body, updates) || updates.empty()) {
+        return nullptr;
+    }
+
+    std::vector<bool> assigned(program->frameSize, false);
+    collectAssignedSlots(*node.body, assigned);
+    std::vector<bool> loopSlot(program->frameSize, false);
+    loopSlot[node.slot] = true;
+
+    // Sort the updates into sums s = s + step, products s = s * step and
+    // plain stores v = step, where no step reads a variable the body
+    // assigns. Repeated sums or products of one variable are merged.
+    enum class Kind { SUM, PRODUCT, STORE };
+    struct Recurrence {
+        VariableDeclaration* update;
+        Kind kind;
+        std::unique_ptr<Expression> step; // nullptr for a sum that adds 0
+    };
+    std::vector<Recurrence> recurrences;
+    std::vector<int> recurrenceOf(program->frameSize, -1);
+    // Stores are substituted into the updates after them, so that steps
+    // may use temporaries the body computes from the loop variable
+    std::vector<const Expression*> stored(program->frameSize, nullptr);
+    for (auto* update : updates) {
+        if (update->slot == node.slot || canTrap(*update->initializer)) {
+            return nullptr;
+        }
+        auto substituted = substitute(*update->initializer, stored);
+        const Expression& initializer = *substituted;
+        std::vector<bool> self(program->frameSize, false);
+        self[update->slot] = true;
+        std::vector<bool> others = assigned;
+        others[update->slot] = false;
+        if (readsSlot(initializer, others)) {
+            return nullptr;
+        }
+
+        Kind kind;
+        std::unique_ptr<Expression> step;
+        auto* binary = dynamic_cast<const BinaryExpression*>(&initializer);
+        Affine affine;
+        if (!readsSlot(initializer, self)) {
+            kind = Kind::STORE;
+            step = std::move(substituted);
+        } else if (binary && binary->op == BinaryOp::MUL && isSlot(*binary->left, update->slot) &&
+                   !readsSlot(*binary->right, self)) {
+            kind = Kind::PRODUCT;
+            step = binary->right->clone();
+        } else if (binary && binary->op == BinaryOp::MUL && isSlot(*binary->right, update->slot) &&
+                   !readsSlot(*binary->left, self)) {
+            kind = Kind::PRODUCT;
+            step = binary->left->clone();
+        } else if (toAffine(initializer, self, affine)) {
+            auto* coefficient = dynamic_cast<NumberExpression*>(affine.coefficient.get());
+            if (!coefficient || coefficient->value != 1) {
+                return nullptr;
+            }
+            kind = Kind::SUM;
+            step = std::move(affine.offset);
+        } else {
+            return nullptr;
+        }
+
+        int previous = recurrenceOf[update->slot];
+        if (previous >= 0 && kind != Kind::STORE) {
+            Recurrence& recurrence = recurrences[previous];
+            if (recurrence.kind != kind) {
+                return nullptr;
+            }
+            auto* left = dynamic_cast<NumberExpression*>(recurrence.step.get());
+            auto* right = dynamic_cast<NumberExpression*>(step.get());
+            if (kind == Kind::SUM) {
+                recurrence.step = combine(BinaryOp::ADD, std::move(recurrence.step), std::move(step));
+            } else if (left && right) {
+                recurrence.step = makeNumber(BinaryOps::mul(left->value, right->value));
+            } else {
+                recurrence.step = makeBinary(BinaryOp::MUL, std::move(recurrence.step), std::move(step));
+            }
+            continue;
+        }
+        recurrenceOf[update->slot] = recurrences.size();
+        recurrences.push_back({update, kind, std::move(step)});
+        if (kind == Kind::STORE) {
+            stored[update->slot] = recurrences.back().step.get();
+        }
+    }
+
+    // Literal bounds give the trip count. A loop up to INT_MAX never ends,
+    // and DeadCodeElimination removes loops that never run.
+    auto* startNumber = dynamic_cast<NumberExpression*>(node.start.get());
+    auto* endNumber = dynamic_cast<NumberExpression*>(node.end.get());
+    bool literal = startNumber && endNumber;
+    int64_t tripCount = 0;
+    Range start = rangeOf(*node.start);
+    Range end = rangeOf(*node.end);
+    if (literal) {
+        if (startNumber->value > endNumber->value || endNumber->value == INT_MAX) {
+            return nullptr;
+        }
+        tripCount = static_cast<int64_t>(endNumber->value) - startNumber->value + 1;
+    } else if (!start.known || !end.known || end.max == INT_MAX ||
+               static_cast<int64_t>(start.max) > static_cast<int64_t>(end.min) + 1 ||
+               readsSlot(*node.start, assigned) || readsSlot(*node.end, assigned) ||
+               readsSlot(*node.end, loopSlot)) {
+        return nullptr;
+    }
+
+    auto block = std::make_unique<BlockStatement>();
+    auto temporary = [&](std::unique_ptr<Expression> value) {
+        std::string name = "$t" + std::to_string(program->frameSize);
+        auto declaration = std::make_unique<VariableDeclaration>(name, std::move(value),
+                                                                 program->symbols.intern(name));
+        declaration->slot = program->frameSize++;
+        VariableDeclaration* result = declaration.get();
+        block->statements.push_back(std::move(declaration));
+        return result;
+    };
+    auto assign = [&](VariableDeclaration& variable, std::unique_ptr<Expression> value) {
+        auto declaration = std::make_unique<VariableDeclaration>(variable.name, std::move(value),
+                                                                 variable.symbol);
+        declaration->slot = variable.slot;
+        return declaration;
+    };
+
+    // sum(i) and the trip count for bounds only known at run time, as
+    // C(hi + 1) - C(lo) and hi + 1 - lo; computed once for all sums
+    std::unique_ptr<Expression> runtimeSum;
+    std::unique_ptr<Expression> runtimeCount;
+    auto prepareRuntimeSum = [&]() {
+        if (runtimeSum) return;
+        auto last = makeRead(*temporary(makeBinary(BinaryOp::ADD, node.end->clone(), makeNumber(1))));
+        auto lastHalf = makeRead(*temporary(makeBinary(BinaryOp::SHR, last->clone(), makeNumber(1))));
+        std::unique_ptr<Expression> first;
+        if (startNumber) {
+            first = combine(BinaryOp::ADD, makeNumber(choose2(static_cast<int64_t>(startNumber->value))), nullptr);
+        } else {
+            auto firstHalf = makeRead(*temporary(makeBinary(BinaryOp::SHR, node.start->clone(), makeNumber(1))));
+            first = choose2(*node.start, *firstHalf);
+        }
+        runtimeSum = combine(BinaryOp::SUB, choose2(*last, *lastHalf), std::move(first));
+        runtimeCount = combine(BinaryOp::SUB, last->clone(), node.start->clone());
+    };
+
+    std::vector<std::unique_ptr<Statement>> results;
+    for (auto& recurrence : recurrences) {
+        VariableDeclaration& update = *recurrence.update;
+        std::string stepText = recurrence.step ? expressionToString(*recurrence.step) : "0";
+        if (stepText.size() > 48) {
+            stepText = stepText.substr(0, 45) + "...";
+        }
+        if (dynamic_cast<BinaryExpression*>(recurrence.step.get())) {
+            stepText = "(" + stepText + ")";
+        }
+        std::unique_ptr<Expression> closed;
+        Affine affine;
+
+        if (recurrence.kind == Kind::STORE) {
+            // The value of the last iteration; with run-time bounds the
+            // loop must be known to run at least once
+            if (!literal && start.max > end.min) {
+                return nullptr;
+            }
+            std::vector<const Expression*> last(program->frameSize, nullptr);
+            last[node.slot] = node.end.get();
+            closed = substitute(*recurrence.step, last);
+        } else if (!recurrence.step) {
+            continue;
+        } else if (recurrence.kind == Kind::SUM && toAffine(*recurrence.step, loopSlot, affine)) {
+            // sum(a * i + b) = a * sum(i) + b * count
+            std::unique_ptr<Expression> sum;
+            std::unique_ptr<Expression> count;
+            if (literal) {
+                sum = makeNumber(BinaryOps::sub(choose2(static_cast<int64_t>(endNumber->value) + 1),
+                                                choose2(static_cast<int64_t>(startNumber->value))));
+                count = makeNumber(static_cast<int32_t>(static_cast<uint32_t>(tripCount)));
+            } else {
+                prepareRuntimeSum();
+                sum = copy(runtimeSum);
+                count = copy(runtimeCount);
+            }
+            closed = combine(BinaryOp::ADD, combine(BinaryOp::MUL, std::move(affine.coefficient), std::move(sum)),
+                             combine(BinaryOp::MUL, std::move(affine.offset), std::move(count)));
+            if (!closed) {
+                continue;
+            }
+        } else if (!literal) {
+            return nullptr;
+        } else if (recurrence.kind == Kind::PRODUCT && !readsSlot(*recurrence.step, loopSlot)) {
+            // step^tripCount, by squaring for steps only known at run time
+            auto* number = dynamic_cast<NumberExpression*>(recurrence.step.get());
+            if (number) {
+                closed = makeNumber(power(number->value, tripCount));
+            } else if (tripCount == 1) {
+                closed = std::move(recurrence.step);
+            } else {
+                auto base = std::move(recurrence.step);
+                if (!dynamic_cast<VariableExpression*>(base.get())) {
+                    base = makeRead(*temporary(std::move(base)));
+                }
+                int bit = 62;
+                while (!((tripCount >> bit) & 1)) bit--;
+                VariableDeclaration* result = temporary(base->clone());
+                for (bit--; bit >= 0; bit--) {
+                    block->statements.push_back(assign(*result,
+                        makeBinary(BinaryOp::MUL, makeRead(*result), makeRead(*result))));
+                    if ((tripCount >> bit) & 1) {
+                        block->statements.push_back(assign(*result,
+                            makeBinary(BinaryOp::MUL, makeRead(*result), base->clone())));
+                    }
+                }
+                closed = makeRead(*result);
+            }
+        } else if (tripCount <= maxEvaluatedIterations) {
+            // Any other step that only reads the loop variable
+            bool product = recurrence.kind == Kind::PRODUCT;
+            int32_t total = product ? 1 : 0;
+            for (int64_t i = startNumber->value; i <= endNumber->value; ++i) {
+                int32_t value = 0;
+                if (!evaluate(*recurrence.step, node.slot, static_cast<int32_t>(i), value)) {
+                    return nullptr;
+                }
+                total = product ? BinaryOps::mul(total, value) : BinaryOps::add(total, value);
+                if (product && total == 0) break;
+            }
+            closed = makeNumber(total);
+        } else {
+            return nullptr;
+        }
+
+        std::unique_ptr<VariableDeclaration> result;
+        if (recurrence.kind == Kind::STORE) {
+            result = assign(update, closed ? std::move(closed) : makeNumber(0));
+        } else {
+            BinaryOp op = recurrence.kind == Kind::PRODUCT ? BinaryOp::MUL : BinaryOp::ADD;
+            result = assign(update, makeBinary(op, makeRead(update), std::move(closed)));
+        }
+
+        Expression& after = *result->initializer;
+        results.push_back(std::move(result));
+        if (recurrence.kind == Kind::STORE) {
+            continue; // Temporaries and loop variables of inner loops
+        }
+        std::ostringstream oss;
+        oss << "Scalar evolution: " << update.name << " = " << update.name
+            << (recurrence.kind == Kind::PRODUCT ? " * " : " + ") << stepText
+            << " in the loop over " << node.variable << " from " << expressionToString(*node.start)
+            << " to " << expressionToString(*node.end) << " -> " << update.name << " = ";
+        std::string text = expressionToString(after);
+        if (text.size() <= 48) {
+            oss << text;
+        } else {
+            oss << "a closed form of " << countInstructions(after) << " instructions";
+        }
+        lines.push_back(oss.str());
+    }
+
+    for (auto& result : results) {
+        block->statements.push_back(std::move(result));
+    }
+    // The loop variable may be declared outside the loop
+    auto finalValue = combine(BinaryOp::ADD, node.end->clone(), makeNumber(1));
+    auto store = std::make_unique<VariableDeclaration>(node.variable,
+        finalValue ? std::move(finalValue) : makeNumber(0), node.symbol);
+    store->slot = node.slot;
+    block->statements.push_back(std::move(store));
+
+    // With run-time bounds the closed form must beat the loop when it runs
+    // half of its most iterations
+    if (!literal) {
+        int64_t mostIterations = static_cast<int64_t>(end.max) - start.min + 1;
+        int64_t perIteration = countInstructions(*node.body) + countInstructions(*node.end) + 8;
+        if (countInstructions(*block) * 2 >= perIteration * mostIterations) {
+            return nullptr;
+        }
+    }
+
+    return block;
+}
@@ -0,0 +1,68 @@
+#ifndef SCALAR_EVOLUTION_H
+#define SCALAR_EVOLUTION_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+
+// Replaces for loops that only accumulate into variables by the closed
+// form of the values they leave behind.
+//
+// A loop over i qualifies when its body is a list of assignments, each
+// one of
+//   let s = s + e;  (or any sum with s once, like let s = (s + e) - f;)
+//   let s = s * e;   let s = e * s;
+//   let v = e;
+// where no e can fail or reads a variable the body assigns, other than
+// values stored earlier in the same iteration (which are substituted).
+// Every s is then a recurrence over i that does not depend on the others:
+// - a sum of e = a * i + b, with a and b invariant, is
+//   a * (C(hi + 1) - C(lo)) + b * (hi + 1 - lo), where C(x) = x * (x - 1) / 2
+//   is computed by halving the even factor first, so it wraps around
+//   exactly like the loop would
+// - a product of an invariant e is e to the power of the trip count, by
+//   repeated squaring
+// - a sum or product of any other e that reads only i is computed at
+//   compile time, for up to maxEvaluatedIterations iterations
+// - a plain store keeps the value of the last iteration
+//
+// Products and compile-time sums need literal bounds. Sums also work when
+// the bounds are variables of enclosing loops whose ranges show that the
+// loop ends (its bound is below INT_MAX) and that lo <= hi + 1, if the
+// closed form is cheaper than the loop. Inner loops are replaced first,
+// so nested triangular loops collapse completely. The loop variable keeps
+// its final value, as in DeadCodeElimination.
+//   let sum = 0; for i = 1 to 10 { let sum = sum + i; }
+// becomes
+//   let sum = 0; { let sum = sum + 55; let i = 11; }
+class ScalarEvolution : public OptimizationPass, public ASTRewriter {
+private:
+    // Values a loop variable takes inside its loop
+    struct Range {
+        bool known;
+        int32_t min;
+        int32_t max;
+    };
+
+    Program* program;
+    std::vector<std::string>* log;
+    int rewrites;
+    std::vector<Range> ranges; // slot -> range, for variables of enclosing loops
+
+    Range rangeOf(const Expression& expr) const;
+    // Replacement for the loop, with one report line per update; nullptr
+    // if the loop does not qualify
+    std::unique_ptr<Statement> closedForm(ForStatement& node, std::vector<std::string>& lines);
+
+public:
+    static const int maxEvaluatedIterations = 100000;
+
+    ScalarEvolution() : program(nullptr), log(nullptr), rewrites(0) {}
+
+    std::string getName() const override { return "scalar-evolution"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+
+    using ASTRewriter::visit;
+    void visit(ForStatement& node) override;
+};
+
+#endif // SCALAR_EVOLUTION_H
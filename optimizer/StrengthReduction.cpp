@@ -0,0 +1,368 @@
+#include "StrengthReduction.h"
+#include <climits>
+#include <sstream>
+
+namespace {
+
+// k if value is 2^k with k >= 1, otherwise 0
+int powerOfTwo(int32_t value) {
+    if (value < 2 || (value & (value - 1)) != 0) {
+        return 0;
+    }
+    int k = 0;
+    while ((1 << k) != value) {
+        k++;
+    }
+    return k;
+}
+
+bool isCommutative(BinaryOp op) {
+    return op == BinaryOp::ADD || op == BinaryOp::MUL || op == BinaryOp::EQ;
+}
+
+std::unique_ptr<Expression> makeNumber(int32_t value) {
+    return std::make_unique<NumberExpression>(value);
+}
+
+std::unique_ptr<Expression> makeBinary(BinaryOp op, std::unique_ptr<Expression> left,
+                                       std::unique_ptr<Expression> right) {
+    return std::make_unique<BinaryExpression>(op, std::move(left), std::move(right));
+}
+
+std::unique_ptr<Expression> makeRead(const VariableDeclaration& variable) {
+    auto read = std::make_unique<VariableExpression>(variable.name, variable.symbol);
+    read->slot = variable.slot;
+    return read;
+}
+
+// Finds the products loopVariable * step in a loop body, where step is a
+// literal or a variable the loop does not assign
+class InductionProductFinder : public ASTVisitor {
+private:
+    int loopSlot;
+    const std::vector<bool>& assigned;
+    bool conditional; // Inside an if branch or a nested loop
+
+    // The per-iteration increment of expr if it is an induction product
+    std::unique_ptr<Expression> stepOf(const Expression& expr) const {
+        auto* binary = dynamic_cast<const BinaryExpression*>(&expr);
+        if (!binary || (binary->op != BinaryOp::MUL && binary->op != BinaryOp::SHL)) {
+            return nullptr;
+        }
+
+        const Expression* factor = nullptr;
+        if (isLoopVariable(*binary->left)) {
+            factor = binary->right.get();
+        } else if (binary->op == BinaryOp::MUL && isLoopVariable(*binary->right)) {
+            factor = binary->left.get();
+        } else {
+            return nullptr;
+        }
+
+        if (auto* number = dynamic_cast<const NumberExpression*>(factor)) {
+            if (binary->op == BinaryOp::SHL) {
+                return makeNumber(BinaryOps::shl(1, number->value));
+            }
+            return makeNumber(number->value);
+        }
+        auto* variable = dynamic_cast<const VariableExpression*>(factor);
+        if (variable && binary->op == BinaryOp::MUL && !assigned[variable->slot] &&
+            variable->slot != loopSlot) {
+            return variable->clone();
+        }
+        return nullptr;
+    }
+
+    bool isLoopVariable(const Expression& expr) const {
+        auto* variable = dynamic_cast<const VariableExpression*>(&expr);
+        return variable && variable->slot == loopSlot;
+    }
+
+    void scan(std::unique_ptr<Expression>& expr) {
+        if (auto step = stepOf(*expr)) {
+            add(expr, std::move(step));
+            return;
+        }
+        if (auto* binary = dynamic_cast<BinaryExpression*>(expr.get())) {
+            scan(binary->left);
+            scan(binary->right);
+        }
+    }
+
+    void add(std::unique_ptr<Expression>& site, std::unique_ptr<Expression> step) {
+        for (auto& group : groups) {
+            if (sameExpression(*group.step, *step)) {
+                group.sites.push_back(&site);
+                if (!conditional) group.savings += countInstructions(*site) - 1;
+                return;
+            }
+        }
+        groups.push_back({std::move(step), {&site}, conditional ? 0 : countInstructions(*site) - 1});
+    }
+
+    void scanConditional(Statement& stmt) {
+        bool outer = conditional;
+        conditional = true;
+        stmt.accept(*this);
+        conditional = outer;
+    }
+
+public:
+    // Products with the same step share one temporary
+    struct Group {
+        std::unique_ptr<Expression> step;
+        std::vector<std::unique_ptr<Expression>*> sites;
+        int savings; // Instructions saved per iteration, counting unconditional sites only
+    };
+    std::vector<Group> groups;
+
+    InductionProductFinder(int slot, const std::vector<bool>& assignedSlots)
+        : loopSlot(slot), assigned(assignedSlots), conditional(false) {}
+
+    void visit(NumberExpression& node) override {}
+    void visit(VariableExpression& node) override {}
+    void visit(BinaryExpression& node) override {}
+    void visit(VariableDeclaration& node) override { scan(node.initializer); }
+    void visit(PrintStatement& node) override { scan(node.expression); }
+    void visit(BlockStatement& node) override {
+        for (auto& stmt : node.statements) {
+            stmt->accept(*this);
+        }
+    }
+    void visit(IfStatement& node) override {
+        scan(node.condition);
+        scanConditional(*node.thenBranch);
+        if (node.elseBranch) {
+            scanConditional(*node.elseBranch);
+        }
+    }
+    void visit(ForStatement& node) override {
+        scan(node.start);
+        bool outer = conditional;
+        conditional = true;
+        scan(node.end);
+        node.body->accept(*this);
+        conditional = outer;
+    }
+    void visit(Program& node) override {}
+};
+
+}
+
+int StrengthReduction::run(Program& prog, std::vector<std::string>& passLog) {
+    program = &prog;
+    log = &passLog;
+    rewrites = 0;
+    nonNegative.assign(prog.frameSize, false);
+    prog.accept(*this);
+    return rewrites;
+}
+
+bool StrengthReduction::isNonNegative(const Expression& expr) const {
+    if (auto* number = dynamic_cast<const NumberExpression*>(&expr)) {
+        return number->value >= 0;
+    }
+    if (auto* variable = dynamic_cast<const VariableExpression*>(&expr)) {
+        return nonNegative[variable->slot];
+    }
+
+    auto& binary = static_cast<const BinaryExpression&>(expr);
+    switch (binary.op) {
+        case BinaryOp::GT:
+        case BinaryOp::LT:
+        case BinaryOp::EQ:
+            return true;
+        case BinaryOp::SHR:
+            return isNonNegative(*binary.left);
+        case BinaryOp::DIV:
+            return isNonNegative(*binary.left) && isNonNegative(*binary.right);
+        default:
+            // + - * << can overflow into negative values
+            return false;
+    }
+}
+
+void StrengthReduction::reduced(const std::string& before, const std::string& after) {
+    // Long operands would make every report line a copy of the statement
+    auto shorten = [](const std::string& text) {
+        const size_t limit = 48;
+        return text.size() <= limit ? text : "..." + text.substr(text.size() - limit);
+    };
+    std::ostringstream oss;
+    oss << "Strength reduction: " << shorten(before) << " -> " << shorten(after);
+    log->push_back(oss.str());
+    rewrites++;
+}
+
+void StrengthReduction::visit(BinaryExpression& node) {
+    ASTRewriter::visit(node);
+
+    auto* left = dynamic_cast<NumberExpression*>(node.left.get());
+    auto* right = dynamic_cast<NumberExpression*>(node.right.get());
+    if (left && right) {
+        return; // Left to constant folding
+    }
+
+    if (left && isCommutative(node.op)) {
+        std::string before = expressionToString(node);
+        std::swap(node.left, node.right);
+        std::swap(left, right);
+        reduced(before, expressionToString(node));
+    }
+    if (!right) {
+        return;
+    }
+
+    // Decide first, since building the result moves the left operand out
+    enum class Reduction { NONE, OPERAND, ZERO, NEGATE, SHIFT_LEFT, SHIFT_RIGHT };
+    Reduction reduction = Reduction::NONE;
+    int32_t value = right->value;
+    int k = powerOfTwo(value);
+    switch (node.op) {
+        case BinaryOp::ADD:
+        case BinaryOp::SUB:
+            if (value == 0) reduction = Reduction::OPERAND;
+            break;
+        case BinaryOp::MUL:
+            if (value == 1) reduction = Reduction::OPERAND;
+            else if (value == 0 && !canTrap(*node.left)) reduction = Reduction::ZERO;
+            else if (value == -1) reduction = Reduction::NEGATE;
+            else if (k != 0) reduction = Reduction::SHIFT_LEFT;
+            break;
+        case BinaryOp::DIV:
+            if (value == 1) reduction = Reduction::OPERAND;
+            else if (value == -1) reduction = Reduction::NEGATE;
+            else if (k != 0 && isNonNegative(*node.left)) reduction = Reduction::SHIFT_RIGHT;
+            break;
+        default:
+            break;
+    }
+    if (reduction == Reduction::NONE) {
+        return;
+    }
+
+    std::string before = expressionToString(node);
+    std::unique_ptr<Expression> result;
+    switch (reduction) {
+        case Reduction::OPERAND:
+            result = std::move(node.left);
+            break;
+        case Reduction::ZERO:
+            result = makeNumber(0);
+            break;
+        case Reduction::NEGATE:
+            result = makeBinary(BinaryOp::SUB, makeNumber(0), std::move(node.left));
+            break;
+        case Reduction::SHIFT_LEFT:
+            result = makeBinary(BinaryOp::SHL, std::move(node.left), makeNumber(k));
+            break;
+        case Reduction::SHIFT_RIGHT:
+            result = makeBinary(BinaryOp::SHR, std::move(node.left), makeNumber(k));
+            break;
+        case Reduction::NONE:
+            break;
+    }
+
+    reduced(before, expressionToString(*result));
+    replaceWith(std::move(result));
+}
+
+void StrengthReduction::visit(ForStatement& node) {
+    rewrite(node.start);
+    rewrite(node.end);
+
+    // A loop counting up from a non-negative literal to a literal bound
+    // keeps its variable non-negative, unless the body assigns it
+    auto* start = dynamic_cast<NumberExpression*>(node.start.get());
+    auto* end = dynamic_cast<NumberExpression*>(node.end.get());
+    bool countsUp = false;
+    if (start && end && start->value >= 0 && end->value < INT_MAX) {
+        std::vector<bool> assigned(program->frameSize, false);
+        collectAssignedSlots(*node.body, assigned);
+        countsUp = !assigned[node.slot];
+    }
+
+    bool outer = nonNegative[node.slot];
+    nonNegative[node.slot] = outer || countsUp;
+    rewriteRequired(node.body);
+    nonNegative[node.slot] = outer;
+
+    reduceInductionVariables(node);
+}
+
+void StrengthReduction::reduceInductionVariables(ForStatement& node) {
+    std::vector<bool> assigned(program->frameSize, false);
+    collectAssignedSlots(*node.body, assigned);
+    if (assigned[node.slot] || canTrap(*node.start)) {
+        return;
+    }
+
+    InductionProductFinder finder(node.slot, assigned);
+    node.body->accept(finder);
+
+    std::vector<std::unique_ptr<Statement>> initializers;
+    std::vector<std::unique_ptr<Statement>> updates;
+    for (auto& group : finder.groups) {
+        // let $t = $t + step costs LOAD, PUSH/LOAD, ADD, STORE every iteration
+        const int updateCost = 4;
+        if (group.savings <= updateCost) {
+            continue;
+        }
+
+        std::string name = "$t" + std::to_string(program->frameSize);
+        SymbolId symbol = program->symbols.intern(name);
+        int slot = program->frameSize++;
+
+        std::ostringstream oss;
+        oss << "Strength reduction: " << expressionToString(**group.sites.front()) << " -> "
+            << name << ", advanced by " << expressionToString(*group.step)
+            << " per iteration of the loop over " << node.variable << " ("
+            << group.sites.size() << " uses)";
+        log->push_back(oss.str());
+        rewrites++;
+
+        auto initializer = std::make_unique<VariableDeclaration>(name,
+            makeBinary(BinaryOp::MUL, node.start->clone(), group.step->clone()), symbol);
+        initializer->slot = slot;
+
+        for (auto* site : group.sites) {
+            *site = makeRead(*initializer);
+        }
+
+        auto update = std::make_unique<VariableDeclaration>(name,
+            makeBinary(BinaryOp::ADD, makeRead(*initializer), group.step->clone()), symbol);
+        update->slot = slot;
+
+        initializers.push_back(std::move(initializer));
+        updates.push_back(std::move(update));
+    }
+
+    if (initializers.empty()) {
+        return;
+    }
+
+    // The updates run last in every iteration, right before the loop
+    // variable is incremented
+    auto* body = dynamic_cast<BlockStatement*>(node.body.get());
+    if (!body) {
+        auto block = std::make_unique<BlockStatement>();
+        block->statements.push_back(std::move(node.body));
+        body = block.get();
+        node.body = std::move(block);
+    }
+    for (auto& update : updates) {
+        body->statements.push_back(std::move(update));
+    }
+
+    auto block = std::make_unique<BlockStatement>();
+    for (auto& initializer : initializers) {
+        block->statements.push_back(std::move(initializer));
+    }
+    auto loop = std::make_unique<ForStatement>(node.variable, std::move(node.start),
+                                               std::move(node.end), std::move(node.body),
+                                               node.symbol);
+    loop->slot = node.slot;
+    loop->location = node.location;
+    block->statements.push_back(std::move(loop));
+    replaceWith(std::move(block));
+}
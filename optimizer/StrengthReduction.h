@@ -0,0 +1,39 @@
+#ifndef STRENGTH_REDUCTION_H
+#define STRENGTH_REDUCTION_H
+
+#include "PassManager.h"
+#include "ASTRewriter.h"
+
+// Replaces operations by cheaper equivalents:
+// - x * 2^k becomes x << k, x * -1 and x / -1 become 0 - x (NEG), and
+//   multiplying by 1, dividing by 1, or adding or subtracting 0 disappears
+// - x / 2^k becomes x >> k when x cannot be negative (a comparison, or the
+//   variable of a loop counting up from a non-negative literal)
+// - literals move to the right of + * ==, where BytecodeEmitter can fold
+//   them into immediate instructions (MULI, DIVI, ...)
+// - an induction variable product i * c in a for loop over i becomes a
+//   temporary that starts at start * c and grows by c each iteration,
+//   when the saved instructions outweigh the added update
+class StrengthReduction : public OptimizationPass, public ASTRewriter {
+private:
+    Program* program;
+    std::vector<std::string>* log;
+    int rewrites;
+    std::vector<bool> nonNegative; // slot -> value is known to be >= 0
+
+    bool isNonNegative(const Expression& expr) const;
+    void reduced(const std::string& before, const std::string& after);
+    void reduceInductionVariables(ForStatement& node);
+
+public:
+    StrengthReduction() : program(nullptr), log(nullptr), rewrites(0) {}
+
+    std::string getName() const override { return "strength-reduction"; }
+    int run(Program& program, std::vector<std::string>& passLog) override;
+
+    using ASTRewriter::visit;
+    void visit(BinaryExpression& node) override;
+    void visit(ForStatement& node) override;
+};
+
+#endif // STRENGTH_REDUCTION_H
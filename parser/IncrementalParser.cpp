@@ -0,0 +1,223 @@
+#include "IncrementalParser.h"
+#include "Parser.h"
+#include "../lexer/Lexer.h"
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+
+// Moves the location of every if and for in statement that lies at or
+// behind the old position of the sync token along with the tokens
+void shiftLocations(Statement& statement, const SourceLocation& sync, int lineDelta,
+                    int columnDelta) {
+    auto shift = [&](SourceLocation& location) {
+        if (location.line < sync.line ||
+            (location.line == sync.line && location.column < sync.column)) {
+            return;
+        }
+        if (location.line == sync.line) {
+            location.column += columnDelta;
+        }
+        location.line += lineDelta;
+    };
+
+    if (auto* block = dynamic_cast<BlockStatement*>(&statement)) {
+        for (auto& stmt : block->statements) {
+            shiftLocations(*stmt, sync, lineDelta, columnDelta);
+        }
+    } else if (auto* ifStmt = dynamic_cast<IfStatement*>(&statement)) {
+        shift(ifStmt->location);
+        shiftLocations(*ifStmt->thenBranch, sync, lineDelta, columnDelta);
+        if (ifStmt->elseBranch) {
+            shiftLocations(*ifStmt->elseBranch, sync, lineDelta, columnDelta);
+        }
+    } else if (auto* forStmt = dynamic_cast<ForStatement*>(&statement)) {
+        shift(forStmt->location);
+        shiftLocations(*forStmt->body, sync, lineDelta, columnDelta);
+    }
+}
+
+}
+
+IncrementalParser::IncrementalParser() {
+    reset("");
+}
+
+void IncrementalParser::reset(const std::string& newSource) {
+    source = newSource;
+    parseAll();
+}
+
+void IncrementalParser::parseAll() {
+    Lexer lexer(source);
+    tokens = lexer.tokenize();
+
+    Parser parser(tokens, lexer.getSymbols());
+    program = parser.parse();
+    errors = parser.getErrors();
+    statementSpans = parser.getStatementSpans();
+
+    lastEdit = {true, tokens.size(), program->statements.size(), 0};
+}
+
+bool IncrementalParser::applyEdit(size_t offset, size_t removedLength,
+                                  const std::string& insertedText) {
+    if (offset > source.size() || removedLength > source.size() - offset) {
+        return false;
+    }
+
+    source.replace(offset, removedLength, insertedText);
+
+    if (!reparseEdit(offset, removedLength, insertedText.size())) {
+        parseAll();
+    }
+    return true;
+}
+
+size_t IncrementalParser::statementAt(size_t tokenIndex) const {
+    // Last statement starting at or before tokenIndex
+    auto it = std::upper_bound(statementSpans.begin(), statementSpans.end(), tokenIndex,
+        [](size_t index, const std::pair<size_t, size_t>& span) {
+            return index < span.first;
+        });
+    return (it - statementSpans.begin()) - 1;
+}
+
+bool IncrementalParser::reparseEdit(size_t offset, size_t removedLength,
+                                    size_t insertedLength) {
+    // Statement spans only describe error-free parses
+    if (!errors.empty() || statementSpans.empty()) {
+        return false;
+    }
+
+    const ptrdiff_t delta = static_cast<ptrdiff_t>(insertedLength) -
+                            static_cast<ptrdiff_t>(removedLength);
+    const size_t insertedEnd = offset + insertedLength;
+
+    // Restart at the last top-level statement beginning at or before the
+    // edit. Statements end in ';' or '}', which never combine with the
+    // character after them, so scanning from a statement start does not
+    // depend on anything in front of it. An edit before the first statement
+    // rescans from the top.
+    Lexer lexer(source, program->symbols);
+    size_t firstStatement = 0;
+    auto it = std::upper_bound(statementSpans.begin(), statementSpans.end(), offset,
+        [this](size_t off, const std::pair<size_t, size_t>& span) {
+            return off < tokens[span.first].offset;
+        });
+    if (it != statementSpans.begin()) {
+        firstStatement = (it - statementSpans.begin()) - 1;
+        const Token& start = tokens[statementSpans[firstStatement].first];
+        lexer.seek(start.offset, start.line, start.column);
+    }
+    const size_t firstToken = statementSpans[firstStatement].first;
+
+    // Re-lex until a token behind the edit starts exactly where an old token
+    // started; the text from there on is unchanged, so is the token stream.
+    std::vector<Token> fresh;
+    size_t syncIndex = firstToken;
+    Token syncToken;
+    while (true) {
+        Token token = lexer.nextToken();
+        if (token.offset >= insertedEnd) {
+            size_t oldOffset = static_cast<size_t>(static_cast<ptrdiff_t>(token.offset) - delta);
+            while (syncIndex < tokens.size() && tokens[syncIndex].offset < oldOffset) {
+                syncIndex++;
+            }
+            if (syncIndex < tokens.size() && tokens[syncIndex].offset == oldOffset) {
+                syncToken = token;
+                break;
+            }
+        }
+        if (token.type == TokenType::END_OF_FILE) {
+            return false;
+        }
+        fresh.push_back(std::move(token));
+    }
+
+    // Old tokens [firstToken, syncIndex) are replaced by fresh. The last of
+    // them decides how far the damaged statements reach.
+    const size_t lastToken = syncIndex > firstToken ? syncIndex - 1 : firstToken;
+    const size_t lastStatement = statementAt(lastToken);
+    const size_t oldEndToken = statementSpans[lastStatement].second;
+
+    bool sameStream = fresh.size() == syncIndex - firstToken;
+    for (size_t i = 0; sameStream && i < fresh.size(); ++i) {
+        const Token& old = tokens[firstToken + i];
+        sameStream = old.type == fresh[i].type && old.lexeme == fresh[i].lexeme;
+    }
+
+    // Shift the kept tokens. Columns only move on the line of the sync token.
+    const int lineDelta = syncToken.line - tokens[syncIndex].line;
+    const int columnDelta = syncToken.column - tokens[syncIndex].column;
+    const SourceLocation sync{tokens[syncIndex].line, tokens[syncIndex].column};
+    for (size_t i = syncIndex; i < tokens.size(); ++i) {
+        Token& token = tokens[i];
+        token.offset = static_cast<size_t>(static_cast<ptrdiff_t>(token.offset) + delta);
+        if (token.line == sync.line) {
+            token.column += columnDelta;
+        }
+        token.line += lineDelta;
+    }
+    // Reused statements keep their nodes, whose locations move the same way
+    if (lineDelta != 0 || columnDelta != 0) {
+        for (auto& stmt : program->statements) {
+            shiftLocations(*stmt, sync, lineDelta, columnDelta);
+        }
+    }
+
+    if (sameStream) {
+        // Only whitespace or comments changed: the AST stays valid
+        std::move(fresh.begin(), fresh.end(), tokens.begin() + firstToken);
+        lastEdit = {false, fresh.size(), 0, program->statements.size()};
+        return true;
+    }
+
+    const ptrdiff_t tokenDelta = static_cast<ptrdiff_t>(fresh.size()) -
+                                 static_cast<ptrdiff_t>(syncIndex - firstToken);
+    const size_t relexedCount = fresh.size();
+    if (tokenDelta == 0) {
+        std::move(fresh.begin(), fresh.end(), tokens.begin() + firstToken);
+    } else {
+        tokens.erase(tokens.begin() + firstToken, tokens.begin() + syncIndex);
+        tokens.insert(tokens.begin() + firstToken,
+                      std::make_move_iterator(fresh.begin()),
+                      std::make_move_iterator(fresh.end()));
+    }
+
+    // Parse the damaged statements on their own
+    const size_t endToken = static_cast<size_t>(static_cast<ptrdiff_t>(oldEndToken) + tokenDelta);
+    std::vector<Token> slice(tokens.begin() + firstToken, tokens.begin() + endToken);
+    const Token& next = tokens[endToken];
+    slice.push_back(Token(TokenType::END_OF_FILE, "", next.line, next.column, next.offset));
+
+    // Identifier tokens are already interned, so the parser needs no names
+    Parser parser(slice, SymbolInterner());
+    auto part = parser.parse();
+    if (parser.hasErrors()) {
+        return false;
+    }
+
+    auto& statements = program->statements;
+    statements.erase(statements.begin() + firstStatement,
+                     statements.begin() + lastStatement + 1);
+    statements.insert(statements.begin() + firstStatement,
+                      std::make_move_iterator(part->statements.begin()),
+                      std::make_move_iterator(part->statements.end()));
+
+    std::vector<std::pair<size_t, size_t>> spans = parser.getStatementSpans();
+    for (auto& span : spans) {
+        span.first += firstToken;
+        span.second += firstToken;
+    }
+    for (size_t i = lastStatement + 1; i < statementSpans.size(); ++i) {
+        statementSpans[i].first += tokenDelta;
+        statementSpans[i].second += tokenDelta;
+    }
+    statementSpans.erase(statementSpans.begin() + firstStatement,
+                         statementSpans.begin() + lastStatement + 1);
+    statementSpans.insert(statementSpans.begin() + firstStatement, spans.begin(), spans.end());
+
+    lastEdit = {false, relexedCount, spans.size(), statements.size() - spans.size()};
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef INCREMENTAL_PARSER_H
+#define INCREMENTAL_PARSER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <utility>
+#include "../lexer/Token.h"
+#include "../ast/AST.h"
+
+// What the last reset() or applyEdit() had to redo
+struct EditStats {
+    bool fullParse;
+    size_t tokensRelexed;
+    size_t statementsReparsed;
+    size_t statementsReused;
+};
+
+// Front end state for one source that is edited repeatedly, e.g. by the
+// web editor.
+//
+// An edit re-lexes from the start of the top-level statement it falls in
+// until a freshly scanned token lines up with an old token behind the edit;
+// from there on the old tokens are kept and only their positions shifted.
+// Only the top-level statements covering the re-lexed tokens are parsed
+// again; every other Statement subtree is reused as is.
+//
+// Whenever the old or the new text has syntax errors the session falls back
+// to a full parse, so tokens, AST and errors are always exactly what a
+// from-scratch Lexer and Parser would produce.
+class IncrementalParser {
+private:
+    std::string source;
+    std::vector<Token> tokens;
+    std::unique_ptr<Program> program; // program->symbols interns all names
+    std::vector<std::string> errors;
+    std::vector<std::pair<size_t, size_t>> statementSpans;
+    EditStats lastEdit;
+
+    void parseAll();
+    size_t statementAt(size_t tokenIndex) const;
+    bool reparseEdit(size_t offset, size_t removedLength, size_t insertedLength);
+
+public:
+    IncrementalParser();
+
+    // Starts over with a new source
+    void reset(const std::string& newSource);
+
+    // Replaces removedLength bytes at offset with insertedText. Returns false
+    // without changing anything if the range lies outside the source.
+    bool applyEdit(size_t offset, size_t removedLength, const std::string& insertedText);
+
+    const std::string& getSource() const { return source; }
+    const std::vector<Token>& getTokens() const { return tokens; }
+    const Program& getProgram() const { return *program; }
+    // Lends the tree to a caller that does not change its shape (the
+    // compiler at level 0 only resolves its frame slots again) until
+    // restoreProgram hands it back; no edit may come in between
+    std::unique_ptr<Program> releaseProgram() { return std::move(program); }
+    void restoreProgram(std::unique_ptr<Program> tree) { program = std::move(tree); }
+    const std::vector<std::string>& getErrors() const { return errors; }
+    bool hasErrors() const { return !errors.empty(); }
+    const EditStats& getLastEdit() const { return lastEdit; }
+};
+
+#endif // INCREMENTAL_PARSER_H
@@ -1,18 +1,27 @@
 #include "Parser.h"
+#include <algorithm>
 #include <sstream>
+#include <stdexcept>
 
-Parser::Parser(const std::vector<Token>& toks) 
-    : tokens(toks), current(0) {}
+// The later stages walk the tree recursively, so nesting is limited here,
+// with room to spare on a worker thread's stack: blocks (also those of if
+// and for) and the depth of an expression tree, whether that comes from
+// parentheses or from a long chain of operators
+static const int MAX_BLOCK_DEPTH = 256;
+static const int MAX_EXPRESSION_DEPTH = 1000;
 
-Token Parser::peek() {
+Parser::Parser(const std::vector<Token>& toks, const SymbolInterner& syms) 
+    : tokens(toks), current(0), symbols(syms), blockDepth(0) {}
+
+const Token& Parser::peek() {
     return tokens[current];
 }
 
-Token Parser::previous() {
+const Token& Parser::previous() {
     return tokens[current - 1];
 }
 
-Token Parser::advance() {
+const Token& Parser::advance() {
     if (!isAtEnd()) current++;
     return previous();
 }
@@ -50,6 +59,12 @@ Token Parser::consume(TokenType type, const std::string& message) {
     return peek();
 }
 
+SymbolId Parser::symbolOf(const Token& token) {
+    // Tokens from the Lexer are already interned; intern anything else here
+    if (token.symbol != INVALID_SYMBOL) return token.symbol;
+    return symbols.intern(token.lexeme);
+}
+
 void Parser::error(const std::string& message) {
     Token token = peek();
     std::ostringstream oss;
@@ -59,16 +74,20 @@ void Parser::error(const std::string& message) {
 }
 
 std::unique_ptr<Program> Parser::parse() {
-    return parseProgram();
+    auto program = parseProgram();
+    program->symbols = symbols;
+    return program;
 }
 
 std::unique_ptr<Program> Parser::parseProgram() {
     auto program = std::make_unique<Program>();
     
     while (!isAtEnd()) {
+        size_t start = current;
         auto stmt = parseStatement();
         if (stmt) {
             program->statements.push_back(std::move(stmt));
+            statementSpans.emplace_back(start, current);
         } else {
             // Skip to next statement on error
             advance();
@@ -105,7 +124,7 @@ std::unique_ptr<Statement> Parser::parseVariableDeclaration() {
     auto initializer = parseExpression();
     consume(TokenType::SEMICOLON, "Expected ';' after variable declaration");
     
-    return std::make_unique<VariableDeclaration>(name.lexeme, std::move(initializer));
+    return std::make_unique<VariableDeclaration>(name.lexeme, std::move(initializer), symbolOf(name));
 }
 
 std::unique_ptr<Statement> Parser::parsePrintStatement() {
@@ -115,6 +134,8 @@ std::unique_ptr<Statement> Parser::parsePrintStatement() {
 }
 
 std::unique_ptr<Statement> Parser::parseIfStatement() {
+    const Token& keyword = previous();
+    SourceLocation location{keyword.line, keyword.column};
     auto condition = parseExpression();
     consume(TokenType::LBRACE, "Expected '{' after if condition");
     auto thenBranch = parseBlock();
@@ -125,12 +146,16 @@ std::unique_ptr<Statement> Parser::parseIfStatement() {
         elseBranch = parseBlock();
     }
     
-    return std::make_unique<IfStatement>(std::move(condition), 
-                                         std::move(thenBranch), 
-                                         std::move(elseBranch));
+    auto statement = std::make_unique<IfStatement>(std::move(condition), 
+                                                   std::move(thenBranch), 
+                                                   std::move(elseBranch));
+    statement->location = location;
+    return statement;
 }
 
 std::unique_ptr<Statement> Parser::parseForStatement() {
+    const Token& keyword = previous();
+    SourceLocation location{keyword.line, keyword.column};
     Token varName = consume(TokenType::IDENTIFIER, "Expected variable name in for loop");
     consume(TokenType::ASSIGN, "Expected '=' in for loop");
     auto start = parseExpression();
@@ -139,80 +164,183 @@ std::unique_ptr<Statement> Parser::parseForStatement() {
     consume(TokenType::LBRACE, "Expected '{' after for loop header");
     auto body = parseBlock();
     
-    return std::make_unique<ForStatement>(varName.lexeme, 
-                                          std::move(start), 
-                                          std::move(end), 
-                                          std::move(body));
+    auto statement = std::make_unique<ForStatement>(varName.lexeme, 
+                                                    std::move(start), 
+                                                    std::move(end), 
+                                                    std::move(body),
+                                                    symbolOf(varName));
+    statement->location = location;
+    return statement;
 }
 
 std::unique_ptr<Statement> Parser::parseBlock() {
     auto block = std::make_unique<BlockStatement>();
+    if (blockDepth >= MAX_BLOCK_DEPTH) {
+        error("Blocks nested more than " + std::to_string(MAX_BLOCK_DEPTH) + " deep");
+        // Skip to the matching '}' without parsing what is inside
+        int open = 1;
+        while (open > 0 && !isAtEnd()) {
+            if (check(TokenType::LBRACE)) open++;
+            if (check(TokenType::RBRACE)) open--;
+            advance();
+        }
+        return block;
+    }
     
+    blockDepth++;
     while (!check(TokenType::RBRACE) && !isAtEnd()) {
         auto stmt = parseStatement();
         if (stmt) {
             block->statements.push_back(std::move(stmt));
+        } else {
+            // Skip to next statement on error
+            advance();
         }
     }
     
+    blockDepth--;
+    
     consume(TokenType::RBRACE, "Expected '}' after block");
     return block;
 }
 
-std::unique_ptr<Expression> Parser::parseExpression() {
-    return parseComparison();
-}
+// Binary operator table for the expression parser, indexed by TokenType.
+// Higher precedence binds tighter; 0 means the token is not a binary operator.
+// All operators are left-associative. Comparisons are non-associative:
+// at most one may appear per parenthesis level, as in
+//   Comparison -> Term (('>' | '<' | '==') Term)?
+struct OperatorInfo {
+    int precedence;
+    BinaryOp op;
+};
 
-std::unique_ptr<Expression> Parser::parseComparison() {
-    auto expr = parseTerm();
-    
-    if (match({TokenType::GREATER, TokenType::LESS, TokenType::EQUAL})) {
-        Token op = previous();
-        auto right = parseTerm();
-        expr = std::make_unique<BinaryExpression>(op.lexeme, std::move(expr), std::move(right));
-    }
-    
-    return expr;
-}
+static const int COMPARISON_PRECEDENCE = 1;
 
-std::unique_ptr<Expression> Parser::parseTerm() {
-    auto expr = parseFactor();
-    
-    while (match({TokenType::PLUS, TokenType::MINUS})) {
-        Token op = previous();
-        auto right = parseFactor();
-        expr = std::make_unique<BinaryExpression>(op.lexeme, std::move(expr), std::move(right));
-    }
-    
-    return expr;
+static const OperatorInfo& operatorInfo(TokenType type) {
+    static const OperatorInfo table[] = {
+        {0, BinaryOp::ADD},                     // LET
+        {0, BinaryOp::ADD},                     // PRINT
+        {0, BinaryOp::ADD},                     // IF
+        {0, BinaryOp::ADD},                     // ELSE
+        {0, BinaryOp::ADD},                     // FOR
+        {0, BinaryOp::ADD},                     // TO
+        {0, BinaryOp::ADD},                     // IDENTIFIER
+        {0, BinaryOp::ADD},                     // NUMBER
+        {2, BinaryOp::ADD},                     // PLUS
+        {2, BinaryOp::SUB},                     // MINUS
+        {3, BinaryOp::MUL},                     // MULTIPLY
+        {3, BinaryOp::DIV},                     // DIVIDE
+        {0, BinaryOp::ADD},                     // ASSIGN
+        {COMPARISON_PRECEDENCE, BinaryOp::EQ},  // EQUAL
+        {COMPARISON_PRECEDENCE, BinaryOp::GT},  // GREATER
+        {COMPARISON_PRECEDENCE, BinaryOp::LT},  // LESS
+        {0, BinaryOp::ADD},                     // SEMICOLON
+        {0, BinaryOp::ADD},                     // LBRACE
+        {0, BinaryOp::ADD},                     // RBRACE
+        {0, BinaryOp::ADD},                     // LPAREN
+        {0, BinaryOp::ADD},                     // RPAREN
+        {0, BinaryOp::ADD},                     // END_OF_FILE
+        {0, BinaryOp::ADD}                      // INVALID
+    };
+    static_assert(sizeof(table) / sizeof(table[0]) == static_cast<int>(TokenType::INVALID) + 1,
+                  "operator table must cover every TokenType");
+    return table[static_cast<int>(type)];
 }
 
-std::unique_ptr<Expression> Parser::parseFactor() {
-    auto expr = parsePrimary();
+// Precedence climbing with explicit operand and operator stacks instead of
+// one recursive call per precedence level and per parenthesis, so deeply
+// nested or very long expressions use bounded native stack. A subtree
+// deeper than MAX_EXPRESSION_DEPTH is reported and replaced by 0.
+std::unique_ptr<Expression> Parser::parseExpression() {
+    // An entry with precedence 0 marks an open parenthesis
+    std::vector<OperatorInfo> operators;
+    std::vector<std::unique_ptr<Expression>> operands;
+    // Tree depth of each operand
+    std::vector<int> depths;
+    // Whether a comparison was already used at each parenthesis level
+    std::vector<bool> comparisonSeen(1, false);
+    bool tooDeep = false;
     
-    while (match({TokenType::MULTIPLY, TokenType::DIVIDE})) {
-        Token op = previous();
-        auto right = parsePrimary();
-        expr = std::make_unique<BinaryExpression>(op.lexeme, std::move(expr), std::move(right));
-    }
+    auto reduce = [&]() {
+        BinaryOp op = operators.back().op;
+        operators.pop_back();
+        auto right = std::move(operands.back());
+        operands.pop_back();
+        int depth = std::max(depths[depths.size() - 2], depths.back()) + 1;
+        depths.pop_back();
+        if (depth > MAX_EXPRESSION_DEPTH) {
+            if (!tooDeep) {
+                error("Expression nested more than " + std::to_string(MAX_EXPRESSION_DEPTH) + " deep");
+                tooDeep = true;
+            }
+            operands.back() = std::make_unique<NumberExpression>(0); // Error recovery
+            depths.back() = 1;
+            return;
+        }
+        auto left = std::move(operands.back());
+        operands.back() = std::make_unique<BinaryExpression>(op, std::move(left), std::move(right));
+        depths.back() = depth;
+    };
     
-    return expr;
+    while (true) {
+        // Operand position: any number of '(' followed by a primary
+        while (match(TokenType::LPAREN)) {
+            operators.push_back({0, BinaryOp::ADD});
+            comparisonSeen.push_back(false);
+        }
+        operands.push_back(parsePrimary());
+        depths.push_back(1);
+        
+        // Operator position: close parentheses until a binary operator
+        // continues the expression or nothing can
+        bool expectOperand = false;
+        while (!expectOperand) {
+            const OperatorInfo& info = operatorInfo(peek().type);
+            bool isComparison = info.precedence == COMPARISON_PRECEDENCE;
+            
+            if (!isAtEnd() && info.precedence > 0 && !(isComparison && comparisonSeen.back())) {
+                while (!operators.empty() && operators.back().precedence >= info.precedence) {
+                    reduce();
+                }
+                if (isComparison) comparisonSeen.back() = true;
+                operators.push_back(info);
+                advance();
+                expectOperand = true;
+            } else if (comparisonSeen.size() > 1) {
+                while (operators.back().precedence > 0) {
+                    reduce();
+                }
+                operators.pop_back();
+                comparisonSeen.pop_back();
+                consume(TokenType::RPAREN, "Expected ')' after expression");
+            } else {
+                while (!operators.empty()) {
+                    reduce();
+                }
+                return std::move(operands.back());
+            }
+        }
+    }
 }
 
 std::unique_ptr<Expression> Parser::parsePrimary() {
     if (match(TokenType::NUMBER)) {
-        int value = std::stoi(previous().lexeme);
-        return std::make_unique<NumberExpression>(value);
+        const Token& literal = previous();
+        try {
+            return std::make_unique<NumberExpression>(std::stoi(literal.lexeme));
+        } catch (const std::out_of_range&) {
+            // Reported like any other syntax error so that parsing never throws
+            std::ostringstream oss;
+            oss << "Parse error at line " << literal.line << ", column " << literal.column 
+                << ": Number literal out of range";
+            errors.push_back(oss.str());
+            return std::make_unique<NumberExpression>(0); // Error recovery
+        }
     }
     
     if (match(TokenType::IDENTIFIER)) {
-        return std::make_unique<VariableExpression>(previous().lexeme);
-    }
-    
-    if (match(TokenType::LPAREN)) {
-        auto expr = parseExpression();
-        consume(TokenType::RPAREN, "Expected ')' after expression");
-        return expr;
+        Token name = previous();
+        return std::make_unique<VariableExpression>(name.lexeme, symbolOf(name));
     }
     
     error("Expected expression");
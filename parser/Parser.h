@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <utility>
 #include "../lexer/Token.h"
 #include "../ast/AST.h"
 
@@ -12,15 +13,21 @@ private:
     std::vector<Token> tokens;
     size_t current;
     std::vector<std::string> errors;
+    SymbolInterner symbols;
+    // Token range [first, second) of each top-level statement
+    std::vector<std::pair<size_t, size_t>> statementSpans;
+    // Blocks open around the statement being parsed
+    int blockDepth;
     
-    Token peek();
-    Token previous();
-    Token advance();
+    const Token& peek();
+    const Token& previous();
+    const Token& advance();
     bool isAtEnd();
     bool check(TokenType type);
     bool match(TokenType type);
     bool match(const std::vector<TokenType>& types);
     Token consume(TokenType type, const std::string& message);
+    SymbolId symbolOf(const Token& token);
     void error(const std::string& message);
     
     // Parsing methods
@@ -33,16 +40,14 @@ private:
     std::unique_ptr<Statement> parseBlock();
     
     std::unique_ptr<Expression> parseExpression();
-    std::unique_ptr<Expression> parseComparison();
-    std::unique_ptr<Expression> parseTerm();
-    std::unique_ptr<Expression> parseFactor();
     std::unique_ptr<Expression> parsePrimary();
     
 public:
-    Parser(const std::vector<Token>& toks);
+    Parser(const std::vector<Token>& toks, const SymbolInterner& syms);
     std::unique_ptr<Program> parse();
     const std::vector<std::string>& getErrors() const { return errors; }
     bool hasErrors() const { return !errors.empty(); }
+    const std::vector<std::pair<size_t, size_t>>& getStatementSpans() const { return statementSpans; }
 };
 
 #endif // PARSER_H
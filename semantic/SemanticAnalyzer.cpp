@@ -1,15 +1,43 @@
 #include "SemanticAnalyzer.h"
 #include <sstream>
+#include <algorithm>
 
-void SemanticAnalyzer::defineVariable(const std::string& name) {
-    if (symbolTable.find(name) != symbolTable.end()) {
-        warning("Variable '" + name + "' redeclared");
+void SemanticAnalyzer::reset(size_t symbolCount) {
+    errors.clear();
+    warnings.clear();
+    symbolSlots.assign(symbolCount, -1);
+    scopeSymbols.clear();
+    scopeStarts.clear();
+    frameSize = 0;
+}
+
+void SemanticAnalyzer::enterScope() {
+    scopeStarts.push_back(scopeSymbols.size());
+}
+
+void SemanticAnalyzer::exitScope() {
+    size_t start = scopeStarts.back();
+    scopeStarts.pop_back();
+    
+    while (scopeSymbols.size() > start) {
+        symbolSlots[scopeSymbols.back()] = -1;
+        scopeSymbols.pop_back();
     }
-    symbolTable[name] = true;
 }
 
-bool SemanticAnalyzer::isVariableDefined(const std::string& name) {
-    return symbolTable.find(name) != symbolTable.end();
+int SemanticAnalyzer::bindVariable(SymbolId symbol, const std::string& name) {
+    int slot = symbolSlots[symbol];
+    if (slot >= 0) {
+        warning("Variable '" + name + "' redeclared");
+        return slot;
+    }
+    
+    // New variable in the innermost scope
+    slot = scopeSymbols.size();
+    symbolSlots[symbol] = slot;
+    scopeSymbols.push_back(symbol);
+    frameSize = std::max(frameSize, slot + 1);
+    return slot;
 }
 
 void SemanticAnalyzer::error(const std::string& message) {
@@ -21,10 +49,9 @@ void SemanticAnalyzer::warning(const std::string& message) {
 }
 
 void SemanticAnalyzer::analyze(Program& program) {
-    errors.clear();
-    warnings.clear();
-    symbolTable.clear();
+    reset(program.symbols.size());
     program.accept(*this);
+    program.frameSize = frameSize;
 }
 
 void SemanticAnalyzer::visit(NumberExpression& node) {
@@ -32,7 +59,8 @@ void SemanticAnalyzer::visit(NumberExpression& node) {
 }
 
 void SemanticAnalyzer::visit(VariableExpression& node) {
-    if (!isVariableDefined(node.name)) {
+    node.slot = resolveVariable(node.symbol);
+    if (node.slot < 0) {
         error("Undefined variable '" + node.name + "'");
     }
 }
@@ -45,8 +73,8 @@ void SemanticAnalyzer::visit(BinaryExpression& node) {
 void SemanticAnalyzer::visit(VariableDeclaration& node) {
     // First check the initializer
     node.initializer->accept(*this);
-    // Then define the variable
-    defineVariable(node.name);
+    // Then define the variable (or assign it if already visible)
+    node.slot = bindVariable(node.symbol, node.name);
 }
 
 void SemanticAnalyzer::visit(PrintStatement& node) {
@@ -54,9 +82,11 @@ void SemanticAnalyzer::visit(PrintStatement& node) {
 }
 
 void SemanticAnalyzer::visit(BlockStatement& node) {
+    enterScope();
     for (auto& stmt : node.statements) {
         stmt->accept(*this);
     }
+    exitScope();
 }
 
 void SemanticAnalyzer::visit(IfStatement& node) {
@@ -71,17 +101,21 @@ void SemanticAnalyzer::visit(ForStatement& node) {
     node.start->accept(*this);
     node.end->accept(*this);
     
-    // Define loop variable
-    defineVariable(node.variable);
+    // Define loop variable, scoped to the loop
+    enterScope();
+    node.slot = bindVariable(node.symbol, node.variable);
     
     // Analyze body
     node.body->accept(*this);
+    exitScope();
 }
 
 void SemanticAnalyzer::visit(Program& node) {
+    enterScope();
     for (auto& stmt : node.statements) {
         stmt->accept(*this);
     }
+    exitScope();
 }
 
 std::string SemanticAnalyzer::getReport() const {
@@ -3,24 +3,35 @@
 
 #include <string>
 #include <vector>
-#include <map>
 #include <memory>
 #include "../ast/AST.h"
 
 class SemanticAnalyzer : public ASTVisitor {
 private:
-    std::map<std::string, bool> symbolTable; // variable name -> is defined
+    // Scope stack. 'let' or 'for' on a visible name assigns to that variable
+    // instead of shadowing it, so each symbol has at most one visible binding
+    // and a table indexed by symbol id resolves names in O(1).
+    // Every open declaration owns the frame slot equal to its position in
+    // scopeSymbols, so closing a scope frees its slots for the next one.
+    std::vector<int> symbolSlots;       // symbol id -> frame slot, -1 if not visible
+    std::vector<SymbolId> scopeSymbols; // declarations of the open scopes, innermost last
+    std::vector<size_t> scopeStarts;    // scopeSymbols size when each scope was opened
+    int frameSize;
     std::vector<std::string> errors;
     std::vector<std::string> warnings;
     
-    void defineVariable(const std::string& name);
-    bool isVariableDefined(const std::string& name);
+    void reset(size_t symbolCount);
+    void enterScope();
+    void exitScope();
+    int bindVariable(SymbolId symbol, const std::string& name);
+    int resolveVariable(SymbolId symbol) const { return symbolSlots[symbol]; }
     void error(const std::string& message);
     void warning(const std::string& message);
     
 public:
-    SemanticAnalyzer() = default;
+    SemanticAnalyzer() : frameSize(0) {}
     
+    // Records the resolved frame slot of every variable on the tree
     void analyze(Program& program);
     
     // Visitor methods
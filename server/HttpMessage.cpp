@@ -0,0 +1,114 @@
+#include "HttpMessage.h"
+#include <algorithm>
+#include <cctype>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Whether the comma-separated list has token (lowercase) in it, in any case
+bool hasToken(std::string list, const std::string& token) {
+    std::transform(list.begin(), list.end(), list.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    size_t pos = 0;
+    while (pos <= list.length()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.length();
+        }
+        std::string item = list.substr(pos, end - pos);
+        size_t first = item.find_first_not_of(" \t");
+        size_t last = item.find_last_not_of(" \t");
+        if (first != std::string::npos && item.compare(first, last - first + 1, token) == 0) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+}
+
+std::string HttpRequest::getHeader(const std::string& name) const {
+    for (const auto& header : headers) {
+        if (header.first == name) {
+            return header.second;
+        }
+    }
+    return "";
+}
+
+bool HttpRequest::keepAlive() const {
+    std::string connection = getHeader("connection");
+    if (version == "HTTP/1.0") {
+        return hasToken(connection, "keep-alive");
+    }
+    return !hasToken(connection, "close");
+}
+
+HttpResponse::HttpResponse(int statusCode, const std::string& contentType, std::string content)
+    : status(statusCode), body(std::move(content)) {
+    headers.emplace_back("Content-Type", contentType);
+}
+
+std::string HttpResponse::head(bool keepAlive) const {
+    std::string text = "HTTP/1.1 " + std::to_string(status) + " " + httpReasonPhrase(status) + "\r\n";
+    for (const auto& header : headers) {
+        text += header.first + ": " + header.second + "\r\n";
+    }
+    text += headerBlock;
+    if (status != 304) {
+        text += "Content-Length: " + std::to_string(bodyLength()) + "\r\n";
+    }
+    text += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    text += "\r\n";
+    return text;
+}
+
+SharedBody::SharedBody(std::string content) : bytes(std::move(content)), file(-1) {
+#ifdef __linux__
+    file = memfd_create("shared-body", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    size_t written = 0;
+    while (file >= 0 && written < bytes.length()) {
+        ssize_t n = write(file, bytes.data() + written, bytes.length() - written);
+        if (n <= 0) {
+            close(file);
+            file = -1;
+        } else {
+            written += static_cast<size_t>(n);
+        }
+    }
+    if (file >= 0) {
+        // Whatever shares the file can count on its bytes staying these
+        fcntl(file, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    }
+#endif
+}
+
+SharedBody::~SharedBody() {
+#ifdef __linux__
+    if (file >= 0) {
+        close(file);
+    }
+#endif
+}
+
+const char* httpReasonPhrase(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        case 505: return "HTTP Version Not Supported";
+        default: return "Unknown";
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef HTTP_MESSAGE_H
+#define HTTP_MESSAGE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using HttpHeaders = std::vector<std::pair<std::string, std::string>>;
+
+// A request as HttpRequestParser read it. Header names are lowercase and
+// values are trimmed; the body is exactly Content-Length bytes.
+struct HttpRequest {
+    std::string method;
+    std::string target;  // As sent, e.g. "/examples/01_arithmetic.txt"
+    std::string version; // "HTTP/1.0" or "HTTP/1.1"
+    HttpHeaders headers;
+    std::string body;
+
+    // The value of the first header of that (lowercase) name; "" if none
+    std::string getHeader(const std::string& name) const;
+
+    // Whether the client wants the connection kept open after the
+    // response: HTTP/1.1 unless "Connection: close", HTTP/1.0 only with
+    // "Connection: keep-alive"
+    bool keepAlive() const;
+};
+
+// A body that many responses send as it is, such as a cached file. Where
+// there is memfd_create (Linux) the bytes are also put in a sealed
+// anonymous file, which the server hands to sendfile(2) so that the
+// kernel sends them without copying them out of user space first.
+class SharedBody {
+private:
+    std::string bytes;
+    int file; // -1 if there is none
+
+public:
+    explicit SharedBody(std::string content);
+    ~SharedBody();
+
+    SharedBody(const SharedBody&) = delete;
+    SharedBody& operator=(const SharedBody&) = delete;
+
+    const std::string& getBytes() const { return bytes; }
+    int getFile() const { return file; }
+};
+
+// A response as a handler builds it. The server adds Content-Length and
+// Connection when it writes the response.
+struct HttpResponse {
+    int status;
+    HttpHeaders headers;
+    // Header lines formatted ahead of time, each ending in CRLF, for
+    // responses that are sent again and again
+    std::string headerBlock;
+    std::string body;
+    // Sent instead of body if set
+    std::shared_ptr<const SharedBody> sharedBody;
+
+    HttpResponse() : status(200) {}
+    HttpResponse(int statusCode, const std::string& contentType, std::string content);
+
+    // The status line and headers, with the blank line that ends them. A
+    // 304 has no Content-Length: it would have to be that of the 200.
+    std::string head(bool keepAlive) const;
+
+    size_t bodyLength() const { return sharedBody ? sharedBody->getBytes().length() : body.length(); }
+};
+
+// "OK", "Not Found" and so on
+const char* httpReasonPhrase(int status);
+
+#endif // HTTP_MESSAGE_H
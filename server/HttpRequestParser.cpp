@@ -0,0 +1,154 @@
+#include "HttpRequestParser.h"
+#include <algorithm>
+#include <cctype>
+
+HttpRequestParser::HttpRequestParser(size_t maxBody)
+    : maxBodySize(maxBody), scanned(0), headDone(false), contentLength(0),
+      status(Status::INCOMPLETE), errorStatus(0) {}
+
+HttpRequestParser::Status HttpRequestParser::feed(const char* data, size_t length) {
+    if (status != Status::INCOMPLETE) {
+        pending.append(data, length);
+        return status;
+    }
+    if (headDone && pending.empty()) {
+        // Body bytes go straight to the request
+        size_t take = std::min(length, contentLength - request.body.length());
+        request.body.append(data, take);
+        pending.append(data + take, length - take);
+    } else {
+        pending.append(data, length);
+    }
+    return parse();
+}
+
+HttpRequestParser::Status HttpRequestParser::next() {
+    if (status == Status::BAD) {
+        return status; // The framing is lost; so is the connection
+    }
+    scanned = 0;
+    headDone = false;
+    contentLength = 0;
+    request = HttpRequest();
+    status = Status::INCOMPLETE;
+    return parse();
+}
+
+HttpRequestParser::Status HttpRequestParser::parse() {
+    if (!headDone) {
+        // Empty lines before a request line are ignored (RFC 9112 2.2)
+        size_t start = 0;
+        while (pending.compare(start, 2, "\r\n") == 0) {
+            start += 2;
+        }
+        if (start > 0) {
+            pending.erase(0, start);
+            scanned = 0;
+        }
+
+        size_t end = pending.find("\r\n\r\n", scanned);
+        if (end == std::string::npos) {
+            if (pending.length() > MAX_HEAD_SIZE) {
+                return fail(431);
+            }
+            // The blank line may straddle these bytes and the next
+            scanned = pending.length() >= 3 ? pending.length() - 3 : 0;
+            return status;
+        }
+        if (end + 4 > MAX_HEAD_SIZE) {
+            return fail(431);
+        }
+        if (!parseHead(pending.substr(0, end + 2))) {
+            return status;
+        }
+        pending.erase(0, end + 4);
+        headDone = true;
+        request.body.reserve(contentLength);
+    }
+
+    size_t take = std::min(pending.length(), contentLength - request.body.length());
+    request.body.append(pending, 0, take);
+    pending.erase(0, take);
+    if (request.body.length() == contentLength) {
+        status = Status::COMPLETE;
+    }
+    return status;
+}
+
+// Reads the request line and the header lines, each ending in CRLF
+bool HttpRequestParser::parseHead(const std::string& head) {
+    size_t lineEnd = head.find("\r\n");
+    std::string line = head.substr(0, lineEnd);
+    size_t space1 = line.find(' ');
+    size_t space2 = space1 == std::string::npos ? space1 : line.find(' ', space1 + 1);
+    if (space1 == 0 || space2 == std::string::npos || space2 == space1 + 1 ||
+        line.find(' ', space2 + 1) != std::string::npos) {
+        fail(400);
+        return false;
+    }
+    request.method = line.substr(0, space1);
+    request.target = line.substr(space1 + 1, space2 - space1 - 1);
+    request.version = line.substr(space2 + 1);
+    if (request.version.compare(0, 5, "HTTP/") != 0) {
+        fail(400);
+        return false;
+    }
+    if (request.version != "HTTP/1.0" && request.version != "HTTP/1.1") {
+        fail(505);
+        return false;
+    }
+
+    bool hasLength = false;
+    for (size_t pos = lineEnd + 2; pos < head.length(); pos = lineEnd + 2) {
+        lineEnd = head.find("\r\n", pos);
+        line = head.substr(pos, lineEnd - pos);
+
+        // Folded lines (obsolete) and spaces before the colon are refused
+        size_t colon = line.find(':');
+        if (colon == std::string::npos || colon == 0 ||
+            line.find_first_of(" \t") < colon) {
+            fail(400);
+            return false;
+        }
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        size_t first = line.find_first_not_of(" \t", colon + 1);
+        size_t last = line.find_last_not_of(" \t");
+        std::string value = first == std::string::npos ? "" : line.substr(first, last - first + 1);
+
+        if (name == "transfer-encoding") {
+            // Chunked request bodies are not supported
+            fail(501);
+            return false;
+        }
+        if (name == "content-length") {
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos ||
+                value.length() > 18) {
+                fail(400);
+                return false;
+            }
+            size_t length = std::stoull(value);
+            if (hasLength && length != contentLength) {
+                fail(400);
+                return false;
+            }
+            hasLength = true;
+            contentLength = length;
+        }
+        request.headers.emplace_back(std::move(name), std::move(value));
+    }
+
+    if (contentLength > maxBodySize) {
+        fail(413);
+        return false;
+    }
+    return true;
+}
+
+HttpRequestParser::Status HttpRequestParser::fail(int statusCode) {
+    status = Status::BAD;
+    errorStatus = statusCode;
+    pending.clear();
+    return status;
+}
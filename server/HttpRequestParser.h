@@ -0,0 +1,51 @@
+#ifndef HTTP_REQUEST_PARSER_H
+#define HTTP_REQUEST_PARSER_H
+
+#include "HttpMessage.h"
+#include <cstddef>
+#include <string>
+#include <utility>
+
+// Reads the requests of one connection from its bytes as they arrive.
+// Only new bytes are searched for the blank line that ends the headers;
+// after it the body is appended to the request as it comes, up to
+// Content-Length (none without the header). Bytes past the end of a
+// request are kept for the next one, so pipelined requests are not lost.
+class HttpRequestParser {
+public:
+    enum class Status { INCOMPLETE, COMPLETE, BAD };
+
+    // Request line and headers; more is answered 431
+    static const size_t MAX_HEAD_SIZE = 64 * 1024;
+
+private:
+    size_t maxBodySize; // A larger Content-Length is answered 413
+    std::string pending; // Bytes received but not yet part of the request
+    size_t scanned;      // Bytes of pending known to hold no blank line
+    bool headDone;
+    size_t contentLength;
+    HttpRequest request;
+    Status status;
+    int errorStatus;
+
+    Status parse();
+    bool parseHead(const std::string& head);
+    Status fail(int statusCode);
+
+public:
+    explicit HttpRequestParser(size_t maxBody);
+
+    // Adds the next bytes of the connection
+    Status feed(const char* data, size_t length);
+    // Starts on the next request, with the bytes left over from the last
+    Status next();
+
+    Status getStatus() const { return status; }
+
+    // Moves the request out, once COMPLETE
+    HttpRequest takeRequest() { return std::move(request); }
+    // The status to answer a BAD request with: 400, 413, 431, 501 or 505
+    int getErrorStatus() const { return errorStatus; }
+};
+
+#endif // HTTP_REQUEST_PARSER_H
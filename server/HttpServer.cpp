@@ -0,0 +1,545 @@
+#include "HttpServer.h"
+#include "HttpRequestParser.h"
+#include "WorkerPool.h"
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+
+// The answer to a request the server turns away itself
+HttpResponse errorResponse(int status) {
+    HttpResponse response(status, "text/plain", httpReasonPhrase(status));
+    if (status == 503) {
+        response.headers.emplace_back("Retry-After", "1");
+    }
+    return response;
+}
+
+// A response on its way out. The head and the body are kept apart, so the
+// body is never copied to put the head in front of it: both go out in one
+// writev, or the head is sent and then a shared body with sendfile.
+struct Outgoing {
+    std::string head;
+    std::string body;
+    std::shared_ptr<const SharedBody> sharedBody;
+
+    const std::string& getBody() const { return sharedBody ? sharedBody->getBytes() : body; }
+    size_t length() const { return head.length() + getBody().length(); }
+};
+
+// The answer to a HEAD request has the head of a GET but no body
+Outgoing frame(HttpResponse response, bool keepAlive, bool headOnly = false) {
+    Outgoing outgoing;
+    outgoing.head = response.head(keepAlive);
+    if (!headOnly) {
+        outgoing.body = std::move(response.body);
+        outgoing.sharedBody = std::move(response.sharedBody);
+    }
+    return outgoing;
+}
+
+void closeSocket(int socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+#ifdef __linux__
+
+using Clock = std::chrono::steady_clock;
+
+struct Connection;
+using IdleList = std::list<Connection*>;
+
+// A connection alternates between reading a request, waiting for a worker
+// to answer it (busy) and writing the response (output, whose head is
+// empty while there is none), then starts over if the client keeps it
+// alive.
+struct Connection {
+    int fd;
+    unsigned long long id; // fds are reused; ids are not
+    HttpRequestParser parser;
+    bool busy;
+    bool keepAlive;        // Of the request being answered
+    Outgoing output;
+    size_t written;
+
+    Clock::time_point lastActive;
+    IdleList::iterator idlePosition;
+
+    Connection(int socket, unsigned long long connectionId, size_t maxBodySize)
+        : fd(socket), id(connectionId), parser(maxBodySize), busy(false), keepAlive(false),
+          written(0) {}
+};
+
+// A response a worker computed, on its way back to the loop
+struct Completion {
+    int fd;
+    unsigned long long id;
+    Outgoing response;
+};
+
+class EventLoop {
+private:
+    enum class Io { DONE, AGAIN, FAILED };
+
+    int epollFd;
+    int listenFd;
+    int wakeFd; // eventfd the workers signal when they complete a response
+    const HttpServer::Handler& handler;
+    const HttpServerOptions& options;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    unsigned long long nextId;
+
+    // Connections by the time they last sent or took a byte, oldest first
+    IdleList idle;
+
+    std::mutex completionsMutex;
+    std::vector<Completion> completions;
+
+    // Last, so that it is destroyed first: its queued jobs still complete
+    WorkerPool pool;
+
+    void acceptAll();
+    void advance(Connection& connection);
+    Io readSome(Connection& connection);
+    Io writeSome(Connection& connection);
+    void dispatch(Connection& connection);
+    void collectCompletions();
+    void touch(Connection& connection);
+    void closeIdle();
+    int waitTimeout() const;
+    void closeConnection(Connection& connection);
+
+public:
+    EventLoop(int listenSocket, const HttpServer::Handler& requestHandler,
+              const HttpServerOptions& serverOptions)
+        : epollFd(-1), listenFd(listenSocket), wakeFd(-1), handler(requestHandler),
+          options(serverOptions), nextId(1), pool(serverOptions.threadCount, serverOptions.backlog) {}
+    ~EventLoop();
+
+    int run();
+};
+
+EventLoop::~EventLoop() {
+    for (auto& entry : connections) {
+        close(entry.first);
+    }
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+int EventLoop::run() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        std::cerr << "Event loop setup failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    std::vector<epoll_event> events(256);
+    while (true) {
+        int ready = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), waitTimeout());
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "epoll_wait failed: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptAll();
+                continue;
+            }
+            if (fd == wakeFd) {
+                uint64_t count;
+                while (read(wakeFd, &count, sizeof(count)) > 0) {}
+                collectCompletions();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            if (events[i].events & EPOLLERR) {
+                closeConnection(*it->second);
+                continue;
+            }
+            advance(*it->second);
+        }
+        closeIdle();
+    }
+}
+
+void EventLoop::acceptAll() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // Out of file descriptors: new connections wait in the
+                // kernel until one is closed and the next arrives
+                std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        // Registered once for both directions; with edge triggering a
+        // writable socket only wakes the loop after it was full
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            close(fd);
+            continue;
+        }
+        auto connection = std::make_unique<Connection>(fd, nextId++, options.maxBodySize);
+        connection->lastActive = Clock::now();
+        connection->idlePosition = idle.insert(idle.end(), connection.get());
+        connections[fd] = std::move(connection);
+    }
+}
+
+// Takes the connection as far as it goes without waiting: writes the rest
+// of its response, then reads the next request and hands it to a worker.
+// A request is only read once the last one is answered, so a client that
+// sends faster than it is served fills its socket buffer, not ours.
+void EventLoop::advance(Connection& connection) {
+    while (!connection.busy) {
+        if (!connection.output.head.empty()) {
+            Io io = writeSome(connection);
+            if (io == Io::AGAIN) {
+                return;
+            }
+            if (io == Io::FAILED || !connection.keepAlive) {
+                closeConnection(connection);
+                return;
+            }
+            connection.output = Outgoing();
+            connection.written = 0;
+            connection.parser.next();
+        }
+
+        Io io = readSome(connection);
+        if (io == Io::AGAIN) {
+            return;
+        }
+        if (io == Io::FAILED) {
+            closeConnection(connection);
+            return;
+        }
+        if (connection.parser.getStatus() == HttpRequestParser::Status::COMPLETE) {
+            dispatch(connection);
+        } else {
+            // The framing is lost, so the connection ends with the answer
+            connection.keepAlive = false;
+            connection.output = frame(errorResponse(connection.parser.getErrorStatus()), false);
+        }
+    }
+}
+
+// Reads until the parser has a whole request (or a bad one): DONE, AGAIN
+// if the socket ran dry first, FAILED if the client closed or failed
+EventLoop::Io EventLoop::readSome(Connection& connection) {
+    char buffer[16384];
+    while (connection.parser.getStatus() == HttpRequestParser::Status::INCOMPLETE) {
+        ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            touch(connection);
+            connection.parser.feed(buffer, static_cast<size_t>(received));
+            continue;
+        }
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return Io::AGAIN;
+        return Io::FAILED;
+    }
+    return Io::DONE;
+}
+
+// Writes as much of the response as the socket takes; the rest waits for
+// the next EPOLLOUT. A body in memory goes out with the head in one
+// writev; a shared body is sent from its file with sendfile, the head
+// before it marked MSG_MORE so that the two can share packets.
+EventLoop::Io EventLoop::writeSome(Connection& connection) {
+    const Outgoing& output = connection.output;
+    const std::string& head = output.head;
+    const std::string& body = output.getBody();
+    int file = output.sharedBody ? output.sharedBody->getFile() : -1;
+    size_t total = output.length();
+
+    while (connection.written < total) {
+        size_t written = connection.written;
+        ssize_t sent;
+        if (file >= 0 && written >= head.length()) {
+            off_t offset = static_cast<off_t>(written - head.length());
+            sent = sendfile(connection.fd, file, &offset, total - written);
+        } else if (file >= 0) {
+            sent = send(connection.fd, head.data() + written, head.length() - written,
+                        MSG_NOSIGNAL | (body.empty() ? 0 : MSG_MORE));
+        } else {
+            iovec parts[2];
+            int count = 0;
+            if (written < head.length()) {
+                parts[count].iov_base = const_cast<char*>(head.data() + written);
+                parts[count++].iov_len = head.length() - written;
+            }
+            size_t bodyWritten = written > head.length() ? written - head.length() : 0;
+            if (bodyWritten < body.length()) {
+                parts[count].iov_base = const_cast<char*>(body.data() + bodyWritten);
+                parts[count++].iov_len = body.length() - bodyWritten;
+            }
+            sent = writev(connection.fd, parts, count);
+        }
+        if (sent > 0) {
+            touch(connection);
+            connection.written += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return Io::AGAIN;
+        return Io::FAILED;
+    }
+    return Io::DONE;
+}
+
+// Hands the request to a worker, or answers 503 if none will be free soon
+void EventLoop::dispatch(Connection& connection) {
+    HttpRequest request = connection.parser.takeRequest();
+    bool keepAlive = request.keepAlive();
+    connection.keepAlive = keepAlive;
+    connection.busy = true;
+    int fd = connection.fd;
+    unsigned long long id = connection.id;
+    bool queued = pool.submit([this, fd, id, keepAlive, request = std::move(request)] {
+        Completion completion{fd, id, frame(handler(request), keepAlive, request.method == "HEAD")};
+        {
+            std::lock_guard<std::mutex> lock(completionsMutex);
+            completions.push_back(std::move(completion));
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    });
+    if (!queued) {
+        connection.busy = false;
+        connection.output = frame(errorResponse(503), keepAlive);
+    }
+}
+
+void EventLoop::collectCompletions() {
+    std::vector<Completion> done;
+    {
+        std::lock_guard<std::mutex> lock(completionsMutex);
+        done.swap(completions);
+    }
+    for (auto& completion : done) {
+        auto it = connections.find(completion.fd);
+        if (it == connections.end() || it->second->id != completion.id) {
+            continue; // The client went away meanwhile
+        }
+        Connection& connection = *it->second;
+        connection.busy = false;
+        connection.output = std::move(completion.response);
+        connection.written = 0;
+        touch(connection);
+        advance(connection);
+    }
+}
+
+void EventLoop::touch(Connection& connection) {
+    connection.lastActive = Clock::now();
+    idle.splice(idle.end(), idle, connection.idlePosition);
+}
+
+// Closes the connections that were quiet for the idle timeout. One whose
+// request a worker is still answering is not waiting on its client, so its
+// time starts over instead.
+void EventLoop::closeIdle() {
+    Clock::time_point now = Clock::now();
+    auto timeout = std::chrono::seconds(options.idleTimeoutSeconds);
+    while (!idle.empty() && now - idle.front()->lastActive >= timeout) {
+        Connection& connection = *idle.front();
+        if (connection.busy) {
+            touch(connection);
+        } else {
+            closeConnection(connection);
+        }
+    }
+}
+
+// Milliseconds until the oldest connection times out; -1 with none
+int EventLoop::waitTimeout() const {
+    if (idle.empty()) {
+        return -1;
+    }
+    auto deadline = idle.front()->lastActive + std::chrono::seconds(options.idleTimeoutSeconds);
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+    return left.count() > 0 ? static_cast<int>(left.count()) + 1 : 0;
+}
+
+void EventLoop::closeConnection(Connection& connection) {
+    int fd = connection.fd;
+    idle.erase(connection.idlePosition);
+    close(fd); // Also removes it from the epoll set
+    connections.erase(fd);
+}
+
+#endif // __linux__
+
+bool sendAll(int clientSocket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.length()) {
+        int n = send(clientSocket, data.data() + sent, static_cast<int>(data.length() - sent), 0);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendAll(int clientSocket, const Outgoing& output) {
+    return sendAll(clientSocket, output.head) && sendAll(clientSocket, output.getBody());
+}
+
+// Answers the requests of a blocking connection until the client closes it
+// or stays quiet for the idle timeout; it holds its worker all the while
+void serveClient(int clientSocket, const HttpServer::Handler& handler,
+                 const HttpServerOptions& options) {
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(options.idleTimeoutSeconds) * 1000;
+#else
+    timeval timeout{options.idleTimeoutSeconds, 0};
+#endif
+    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
+
+    HttpRequestParser parser(options.maxBodySize);
+    char buffer[16384];
+    while (true) {
+        while (parser.getStatus() == HttpRequestParser::Status::INCOMPLETE) {
+            int received = recv(clientSocket, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                closeSocket(clientSocket);
+                return;
+            }
+            parser.feed(buffer, static_cast<size_t>(received));
+        }
+        if (parser.getStatus() == HttpRequestParser::Status::BAD) {
+            sendAll(clientSocket, frame(errorResponse(parser.getErrorStatus()), false));
+            break;
+        }
+
+        HttpRequest request = parser.takeRequest();
+        bool keepAlive = request.keepAlive();
+        Outgoing output = frame(handler(request), keepAlive, request.method == "HEAD");
+        if (!sendAll(clientSocket, output) || !keepAlive) {
+            break;
+        }
+        parser.next();
+    }
+    closeSocket(clientSocket);
+}
+
+}
+
+int HttpServer::run() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#else
+    // A client that hangs up must not kill the server with SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (serverSocket < 0) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return 1;
+    }
+
+    sockaddr_in serverAddr;
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_addr.s_addr = INADDR_ANY;
+    serverAddr.sin_port = htons(static_cast<unsigned short>(options.port));
+
+    int opt = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+
+    if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) < 0) {
+        std::cerr << "Bind failed" << std::endl;
+        closeSocket(serverSocket);
+        return 1;
+    }
+
+    listen(serverSocket, static_cast<int>(options.backlog));
+
+    int status = runEventLoop(serverSocket);
+
+    closeSocket(serverSocket);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return status;
+}
+
+// Falls back to runBlocking where there is no epoll
+int HttpServer::runEventLoop(int listenSocket) {
+#ifdef __linux__
+    fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL, 0) | O_NONBLOCK);
+    EventLoop loop(listenSocket, handler, options);
+    return loop.run();
+#else
+    return runBlocking(listenSocket);
+#endif
+}
+
+// Connections wait in the kernel's accept queue (backlog) and then in the
+// pool's queue (backlog again); beyond that a client gets 503 at once
+int HttpServer::runBlocking(int listenSocket) {
+    WorkerPool pool(options.threadCount, options.backlog);
+    while (true) {
+        sockaddr_in clientAddr;
+        socklen_t clientLen = sizeof(clientAddr);
+        int clientSocket = accept(listenSocket, (sockaddr*)&clientAddr, &clientLen);
+
+        if (clientSocket < 0) continue;
+
+        if (!pool.submit([this, clientSocket] { serveClient(clientSocket, handler, options); })) {
+            sendAll(clientSocket, frame(errorResponse(503), false));
+            closeSocket(clientSocket);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include "HttpMessage.h"
+#include <cstddef>
+#include <functional>
+
+struct HttpServerOptions {
+    int port = 8080;
+    size_t threadCount = 4;
+
+    // Requests that may wait for a worker (and connections that may wait
+    // to be accepted); more are answered 503 at once
+    size_t backlog = 128;
+
+    // Request bodies of more bytes are answered 413 unread
+    size_t maxBodySize = 1024 * 1024;
+
+    // A connection is closed once it has sent or taken no bytes for this
+    // long while the server waits on it: between keep-alive requests, in
+    // the middle of one, or while its response is being written
+    int idleTimeoutSeconds = 5;
+};
+
+// Serves HTTP/1.1 on a port. Every request is answered by the handler.
+// Handlers run on a WorkerPool of threadCount threads, so they must be
+// safe to call concurrently. The server reads each request in full (see
+// HttpRequestParser), frames the response with Content-Length and keeps
+// the connection open for the next request unless the client asks not to.
+//
+// On Linux one thread runs an edge-triggered epoll loop that owns every
+// socket: it accepts connections, reads and assembles requests without
+// blocking, hands complete ones to the workers and writes their responses
+// back as far as each socket takes them, continuing when it has room
+// again. An idle or slow client therefore costs a socket and a buffer
+// instead of a thread. Elsewhere a worker reads and answers each
+// connection with blocking calls.
+class HttpServer {
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest& request)>;
+
+private:
+    HttpServerOptions options;
+    Handler handler;
+
+    int runEventLoop(int listenSocket);
+    int runBlocking(int listenSocket);
+
+public:
+    HttpServer(const HttpServerOptions& serverOptions, Handler requestHandler)
+        : options(serverOptions), handler(std::move(requestHandler)) {}
+
+    // Serves until a fatal error; returns nonzero if the port could not be
+    // opened or the event loop failed
+    int run();
+};
+
+#endif // HTTP_SERVER_H
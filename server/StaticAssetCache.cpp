@@ -0,0 +1,290 @@
+#include "StaticAssetCache.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Set by SIGHUP, taken by the watcher
+volatile std::sig_atomic_t reloadRequested = 0;
+
+#ifdef SIGHUP
+void onHangup(int) {
+    reloadRequested = 1;
+}
+#endif
+
+const char* contentTypeOf(const std::string& extension) {
+    if (extension == ".html") return "text/html; charset=utf-8";
+    if (extension == ".css") return "text/css; charset=utf-8";
+    if (extension == ".js") return "application/javascript; charset=utf-8";
+    if (extension == ".txt") return "text/plain; charset=utf-8";
+    if (extension == ".json") return "application/json";
+    if (extension == ".svg") return "image/svg+xml";
+    if (extension == ".png") return "image/png";
+    if (extension == ".ico") return "image/x-icon";
+    return "application/octet-stream";
+}
+
+// 64-bit FNV-1a, as 16 hex digits
+std::string contentHash(const std::string& data) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    std::ostringstream oss;
+    oss << std::hex;
+    oss.width(16);
+    oss.fill('0');
+    oss << hash;
+    return oss.str();
+}
+
+// Empty if compressing failed or zlib is missing
+std::string gzipCompress(const std::string& data) {
+#ifdef HAVE_ZLIB
+    z_stream stream{};
+    // 15 + 16: the largest window, with a gzip header and trailer
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return "";
+    }
+    std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    int result = deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return result == Z_STREAM_END ? compressed : "";
+#else
+    (void)data;
+    return "";
+#endif
+}
+
+StaticAsset::Variant makeVariant(std::string body, const std::string& etag,
+                                 const std::string& contentType, const char* encoding) {
+    StaticAsset::Variant variant;
+    variant.etag = etag;
+    variant.body = std::make_shared<SharedBody>(std::move(body));
+    // No fingerprinted URLs and files that may change at any time: always
+    // revalidate, which costs a 304 while the file is unchanged
+    variant.notModifiedBlock = "ETag: " + etag + "\r\n"
+                               "Cache-Control: no-cache\r\n"
+                               "Vary: Accept-Encoding\r\n";
+    variant.headerBlock = "Content-Type: " + contentType + "\r\n" +
+                          (encoding ? std::string("Content-Encoding: ") + encoding + "\r\n" : "") +
+                          variant.notModifiedBlock +
+                          "Access-Control-Allow-Origin: *\r\n";
+    return variant;
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return "";
+    }
+    return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        items.push_back(trim(item));
+    }
+    return items;
+}
+
+// Whether Accept-Encoding lists gzip (or *) without q=0
+bool acceptsGzip(const std::string& acceptEncoding) {
+    for (const std::string& item : splitList(lowercase(acceptEncoding))) {
+        size_t semicolon = item.find(';');
+        std::string coding = trim(item.substr(0, semicolon));
+        if (coding != "gzip" && coding != "*") {
+            continue;
+        }
+        if (semicolon == std::string::npos) {
+            return true;
+        }
+        std::string parameter = trim(item.substr(semicolon + 1));
+        return parameter.compare(0, 2, "q=") != 0 || std::strtod(parameter.c_str() + 2, nullptr) > 0;
+    }
+    return false;
+}
+
+// Whether If-None-Match names etag; weak tags (W/) match by their value
+bool matchesEtag(const std::string& ifNoneMatch, const std::string& etag) {
+    for (std::string tag : splitList(ifNoneMatch)) {
+        if (tag.compare(0, 2, "W/") == 0) {
+            tag.erase(0, 2);
+        }
+        if (tag == "*" || tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+StaticAssetCache::StaticAssetCache(Logger logger)
+    : log(std::move(logger)), table(std::make_shared<AssetTable>()), stopping(false) {}
+
+StaticAssetCache::~StaticAssetCache() {
+    {
+        std::lock_guard<std::mutex> lock(watcherMutex);
+        stopping = true;
+    }
+    watcherWake.notify_all();
+    if (watcher.joinable()) {
+        watcher.join();
+    }
+}
+
+void StaticAssetCache::mount(const std::string& urlPrefix, const std::string& directory) {
+    mounts.push_back({urlPrefix, directory});
+}
+
+std::shared_ptr<const StaticAssetCache::AssetTable> StaticAssetCache::getTable() {
+    std::lock_guard<std::mutex> lock(tableMutex);
+    return table;
+}
+
+// One line per mounted file with its size and modification time; any
+// change to the files changes it
+std::string StaticAssetCache::scanState() const {
+    std::vector<std::string> lines;
+    for (const Mount& mount : mounts) {
+        std::error_code error;
+        for (fs::directory_iterator it(mount.directory, error), end; !error && it != end;
+             it.increment(error)) {
+            std::error_code statError;
+            if (!it->is_regular_file(statError)) {
+                continue;
+            }
+            auto size = it->file_size(statError);
+            auto modified = it->last_write_time(statError).time_since_epoch().count();
+            lines.push_back(it->path().string() + " " + std::to_string(size) + " " +
+                            std::to_string(modified));
+        }
+    }
+    std::sort(lines.begin(), lines.end());
+    std::string state;
+    for (const std::string& line : lines) {
+        state += line + "\n";
+    }
+    return state;
+}
+
+size_t StaticAssetCache::load() {
+    // Scanned first: a file changed while it is read shows up next time
+    loadedState = scanState();
+
+    auto loaded = std::make_shared<AssetTable>();
+    size_t count = 0;
+    for (const Mount& mount : mounts) {
+        std::error_code error;
+        for (fs::directory_iterator it(mount.directory, error), end; !error && it != end;
+             it.increment(error)) {
+            std::error_code statError;
+            if (!it->is_regular_file(statError)) {
+                continue;
+            }
+            std::ifstream file(it->path(), std::ios::binary);
+            if (!file) {
+                continue;
+            }
+            std::ostringstream content;
+            content << file.rdbuf();
+            std::string body = content.str();
+
+            auto asset = std::make_shared<StaticAsset>();
+            std::string contentType = contentTypeOf(it->path().extension().string());
+            std::string hash = contentHash(body);
+            std::string compressed = gzipCompress(body);
+            if (!compressed.empty() && compressed.length() < body.length()) {
+                asset->gzip = makeVariant(std::move(compressed), "\"" + hash + "-gzip\"",
+                                          contentType, "gzip");
+            }
+            asset->plain = makeVariant(std::move(body), "\"" + hash + "\"", contentType, nullptr);
+
+            std::string name = it->path().filename().string();
+            (*loaded)[mount.urlPrefix + name] = asset;
+            if (name == "index.html") {
+                (*loaded)[mount.urlPrefix] = asset;
+            }
+            ++count;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+    table = loaded;
+    return count;
+}
+
+void StaticAssetCache::watch(int intervalMilliseconds) {
+#ifdef SIGHUP
+    std::signal(SIGHUP, onHangup);
+#endif
+    watcher = std::thread([this, intervalMilliseconds] { watchLoop(intervalMilliseconds); });
+}
+
+void StaticAssetCache::watchLoop(int intervalMilliseconds) {
+    std::unique_lock<std::mutex> lock(watcherMutex);
+    while (!watcherWake.wait_for(lock, std::chrono::milliseconds(intervalMilliseconds),
+                                 [this] { return stopping; })) {
+        bool hangup = reloadRequested != 0;
+        reloadRequested = 0;
+        if (hangup || scanState() != loadedState) {
+            size_t count = load();
+            log(std::string(hangup ? "SIGHUP: " : "Files changed: ") + "reloaded " +
+                std::to_string(count) + " static files");
+        }
+    }
+}
+
+bool StaticAssetCache::serve(const HttpRequest& request, HttpResponse& response) {
+    if (request.method != "GET" && request.method != "HEAD") {
+        return false;
+    }
+    auto current = getTable();
+    auto it = current->find(request.target.substr(0, request.target.find('?')));
+    if (it == current->end()) {
+        return false;
+    }
+
+    const StaticAsset& asset = *it->second;
+    const StaticAsset::Variant& variant =
+        asset.gzip.body && acceptsGzip(request.getHeader("accept-encoding"))
+            ? asset.gzip : asset.plain;
+    if (matchesEtag(request.getHeader("if-none-match"), variant.etag)) {
+        response.status = 304;
+        response.headerBlock = variant.notModifiedBlock;
+        return true;
+    }
+    response.status = 200;
+    response.headerBlock = variant.headerBlock;
+    response.sharedBody = variant.body;
+    return true;
+}
@@ -0,0 +1,93 @@
+#ifndef STATIC_ASSET_CACHE_H
+#define STATIC_ASSET_CACHE_H
+
+#include "HttpMessage.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// One file as it is served, with everything about its responses worked
+// out when it was loaded
+struct StaticAsset {
+    struct Variant {
+        std::string etag;             // Quoted, from a hash of the content
+        std::shared_ptr<const SharedBody> body;
+        std::string headerBlock;      // Of a 200: Content-Type, ETag, Cache-Control, ...
+        std::string notModifiedBlock; // Of a 304: ETag, Cache-Control and Vary only
+    };
+
+    Variant plain;
+    // Without a body unless the build has zlib and compressing makes the
+    // file smaller
+    Variant gzip;
+};
+
+// Serves the files of some directories from memory. The files are read
+// (and gzip-compressed when the build has zlib) when the cache is loaded;
+// a request then costs a table lookup, and its response shares the body
+// with the cache (see SharedBody). Responses carry an ETag and
+// "Cache-Control: no-cache", so browsers revalidate and get 304 Not
+// Modified while the file is unchanged.
+//
+// watch() reloads the whole table whenever a file is added, removed or
+// modified, and on SIGHUP where there are signals. Requests in flight keep
+// the table they started with.
+class StaticAssetCache {
+public:
+    using Logger = std::function<void(const std::string& line)>;
+
+private:
+    using AssetTable = std::unordered_map<std::string, std::shared_ptr<const StaticAsset>>;
+
+    struct Mount {
+        std::string urlPrefix; // Ends in '/'
+        std::string directory;
+    };
+
+    std::vector<Mount> mounts;
+    Logger log;
+
+    std::mutex tableMutex;
+    std::shared_ptr<const AssetTable> table;
+
+    // Sizes and modification times of the files the table was loaded from
+    std::string loadedState;
+
+    std::thread watcher;
+    std::mutex watcherMutex;
+    std::condition_variable watcherWake;
+    bool stopping;
+
+    std::shared_ptr<const AssetTable> getTable();
+    std::string scanState() const;
+    void watchLoop(int intervalMilliseconds);
+
+public:
+    explicit StaticAssetCache(Logger logger);
+    ~StaticAssetCache();
+
+    StaticAssetCache(const StaticAssetCache&) = delete;
+    StaticAssetCache& operator=(const StaticAssetCache&) = delete;
+
+    // Serves the regular files directly in directory under urlPrefix,
+    // which ends in '/'; its index.html also answers urlPrefix itself.
+    // Takes effect with the next load().
+    void mount(const std::string& urlPrefix, const std::string& directory);
+
+    // Reads every mounted file into a new table; returns how many
+    size_t load();
+
+    // Checks the files every intervalMilliseconds from a thread of its own
+    void watch(int intervalMilliseconds);
+
+    // Answers a GET or HEAD of a cached file, honoring If-None-Match and
+    // Accept-Encoding; false if the target is not one
+    bool serve(const HttpRequest& request, HttpResponse& response);
+};
+
+#endif // STATIC_ASSET_CACHE_H
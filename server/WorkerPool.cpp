@@ -0,0 +1,47 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(size_t threadCount, size_t queueCapacity)
+    : capacity(queueCapacity), stopping(false) {
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool WorkerPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || jobs.size() >= capacity) {
+            return false;
+        }
+        jobs.push_back(std::move(job));
+    }
+    ready.notify_one();
+    return true;
+}
+
+void WorkerPool::work() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs jobs on a fixed number of threads. Jobs wait for a thread in a
+// queue of bounded length: submit() refuses a job when the queue is full,
+// so that an overloaded server can turn a client away at once instead of
+// queueing it for longer than it would wait.
+class WorkerPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    size_t capacity;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable ready;
+
+    void work();
+
+public:
+    WorkerPool(size_t threadCount, size_t queueCapacity);
+    // Runs the jobs still queued, then joins the threads
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Queues job for the next free thread; false if the queue is full
+    bool submit(std::function<void()> job);
+
+    size_t getThreadCount() const { return workers.size(); }
+    size_t getCapacity() const { return capacity; }
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,43 @@
+#include "PartialEvaluator.h"
+#include "VirtualMachine.h"
+#include <sstream>
+#include <stdexcept>
+
+bool PartialEvaluator::evaluate(Bytecode& bytecode) {
+    VirtualMachine vm;
+    vm.setFuel(instructionFuel, memoryFuel);
+    executedInstructions = 0;
+    std::ostringstream oss;
+    oss << "Partial evaluation: ";
+
+    try {
+        vm.execute(bytecode);
+        executedInstructions = vm.getExecutedInstructions();
+    } catch (const std::exception& e) {
+        oss << "program fails at run time (" << e.what() << "), bytecode kept\n";
+        report = oss.str();
+        return false;
+    }
+
+    if (vm.ranOutOfFuel()) {
+        oss << "out of fuel after " << vm.getExecutedInstructions() << " instructions (limits: "
+            << instructionFuel << " instructions, " << memoryFuel << " bytes), bytecode kept\n";
+        report = oss.str();
+        return false;
+    }
+
+    // Printed values are the decimal form of an int
+    Bytecode residual;
+    for (const auto& line : vm.getOutput()) {
+        residual.emit(OpCode::PUSH, std::stoi(line));
+        residual.emit(OpCode::PRINT);
+    }
+    residual.emit(OpCode::HALT);
+
+    oss << "program halts after " << vm.getExecutedInstructions() << " instructions, "
+        << bytecode.getInstructions().size() << " instructions replaced by "
+        << residual.getInstructions().size() << " that print its output\n";
+    report = oss.str();
+    bytecode = std::move(residual);
+    return true;
+}
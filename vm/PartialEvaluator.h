@@ -0,0 +1,37 @@
+#ifndef PARTIAL_EVALUATOR_H
+#define PARTIAL_EVALUATOR_H
+
+#include <string>
+#include "../codegen/Bytecode.h"
+
+// Runs a program at compile time.
+//
+// Programs take no input, so a program that halts prints the same values
+// every time it runs. The program is run once on the VM with a limited
+// amount of fuel: a number of instructions and a number of bytes for the
+// frame, the stack and the printed output. If it halts within both, its
+// bytecode is replaced by one PUSH and PRINT per printed value. A program
+// that runs out of fuel or fails (division by zero) keeps its bytecode, so
+// it runs and fails exactly as before. The compiler takes the fuel from
+// CompilerOptions.
+class PartialEvaluator {
+private:
+    long long instructionFuel;
+    size_t memoryFuel;
+    long long executedInstructions;
+    std::string report;
+
+public:
+    explicit PartialEvaluator(long long instructions = 1000000, size_t memoryBytes = 64 * 1024)
+        : instructionFuel(instructions), memoryFuel(memoryBytes), executedInstructions(0) {}
+
+    // Returns whether bytecode was replaced
+    bool evaluate(Bytecode& bytecode);
+
+    // Instructions the original bytecode ran at compile time
+    long long getExecutedInstructions() const { return executedInstructions; }
+    // One line on what the last evaluate() did
+    const std::string& getReport() const { return report; }
+};
+
+#endif // PARTIAL_EVALUATOR_H
@@ -0,0 +1,103 @@
+#include "Profile.h"
+#include <fstream>
+#include <sstream>
+
+void Profile::add(SourceLocation location, ProfileSite::Kind kind, long long executions,
+                  long long taken) {
+    auto it = sites.find(location);
+    if (it == sites.end() || it->second.kind != kind) {
+        sites[location] = {kind, executions, taken};
+        return;
+    }
+    it->second.executions += executions;
+    it->second.taken += taken;
+}
+
+void Profile::addRun(const Bytecode& bytecode, const std::vector<long long>& executions,
+                     const std::vector<long long>& jumps) {
+    const auto& instructions = bytecode.getInstructions();
+    for (const BranchProbe& probe : bytecode.getProbes()) {
+        size_t address = static_cast<size_t>(probe.address);
+        if (address >= executions.size() || address >= jumps.size()) {
+            continue;
+        }
+        long long ran = executions[address];
+        bool jumpsWhenTrue = instructions[address].opcode == OpCode::JMP_IF_TRUE;
+        long long held = jumpsWhenTrue ? jumps[address] : ran - jumps[address];
+        if (probe.loop) {
+            // The test holds once per entry, when the loop is done
+            add(probe.location, ProfileSite::Kind::FOR, held, ran - held);
+        } else {
+            add(probe.location, ProfileSite::Kind::IF, ran, held);
+        }
+    }
+}
+
+const ProfileSite* Profile::find(SourceLocation location, ProfileSite::Kind kind) const {
+    auto it = sites.find(location);
+    if (it == sites.end() || it->second.kind != kind) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+std::string Profile::toString() const {
+    std::ostringstream oss;
+    for (const auto& entry : sites) {
+        const ProfileSite& site = entry.second;
+        oss << (site.kind == ProfileSite::Kind::IF ? "if " : "for ") << entry.first.line << ":"
+            << entry.first.column << " " << site.executions << " " << site.taken << "\n";
+    }
+    return oss.str();
+}
+
+bool Profile::parse(const std::string& text, std::string& error) {
+    std::map<SourceLocation, ProfileSite> parsed;
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string kind;
+        SourceLocation location;
+        char colon = 0;
+        long long executions = -1, taken = -1;
+        fields >> kind >> location.line >> colon >> location.column >> executions >> taken;
+        std::string rest;
+        if (!fields || (kind != "if" && kind != "for") || colon != ':' ||
+            !location.isKnown() || executions < 0 || taken < 0 || (fields >> rest)) {
+            error = "Malformed profile line " + std::to_string(lineNumber) + ": " + line;
+            return false;
+        }
+        parsed[location] = {kind == "if" ? ProfileSite::Kind::IF : ProfileSite::Kind::FOR,
+                            executions, taken};
+    }
+    sites = std::move(parsed);
+    return true;
+}
+
+bool Profile::load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "Cannot read profile " + path;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str(), error);
+}
+
+bool Profile::save(const std::string& path, std::string& error) const {
+    std::ofstream file(path);
+    file << "# Mini compiler profile: kind line:column executions taken\n" << toString();
+    if (!file) {
+        error = "Cannot write profile " + path;
+        return false;
+    }
+    return true;
+}
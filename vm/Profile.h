@@ -0,0 +1,65 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "../ast/SourceLocation.h"
+#include "../codegen/Bytecode.h"
+
+// What one if or for statement did in the profiled runs
+struct ProfileSite {
+    enum class Kind { IF, FOR };
+
+    Kind kind;
+    long long executions; // IF: conditions evaluated; FOR: loops entered
+    long long taken;      // IF: conditions that held; FOR: iterations run
+
+    // IF: fraction of the conditions that held
+    double takenRatio() const {
+        return executions > 0 ? static_cast<double>(taken) / executions : 0.0;
+    }
+    // FOR: iterations per entry
+    double averageTripCount() const {
+        return executions > 0 ? static_cast<double>(taken) / executions : 0.0;
+    }
+};
+
+// Branch and loop counts of an instrumented build (see BranchProbe), keyed
+// by the source location of each if and for statement, so that a later
+// compile of the same source can look them up from the AST whatever its
+// optimization level. Saved as text, one statement per line:
+//   if 3:5 100 90     condition at line 3, column 5 held 90 times of 100
+//   for 7:1 10 1000   loop at line 7, column 1 entered 10 times, 1000 iterations
+// Lines starting with # are comments.
+// A statement the optimizer copied has a probe per copy; the counts of
+// all copies are added up.
+class Profile {
+private:
+    std::map<SourceLocation, ProfileSite> sites;
+
+    void add(SourceLocation location, ProfileSite::Kind kind, long long executions,
+             long long taken);
+
+public:
+    // Adds one run of bytecode, given how often each of its instructions
+    // ran and, for conditional jumps, how often they jumped
+    void addRun(const Bytecode& bytecode, const std::vector<long long>& executions,
+                const std::vector<long long>& jumps);
+
+    // The counts of the statement of that kind at location, or nullptr
+    // if the profiled runs never compiled such a statement there
+    const ProfileSite* find(SourceLocation location, ProfileSite::Kind kind) const;
+
+    bool empty() const { return sites.empty(); }
+    size_t size() const { return sites.size(); }
+
+    std::string toString() const;
+    // Reads toString()'s format; on failure error names the bad line
+    bool parse(const std::string& text, std::string& error);
+
+    bool load(const std::string& path, std::string& error);
+    bool save(const std::string& path, std::string& error) const;
+};
+
+#endif // PROFILE_H
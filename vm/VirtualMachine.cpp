@@ -22,17 +22,34 @@ int VirtualMachine::peek() {
     return stack.back();
 }
 
+size_t VirtualMachine::memoryInUse() const {
+    return (variables.size() + stack.size()) * sizeof(int) + outputBytes;
+}
+
 void VirtualMachine::execute(const Bytecode& bytecode) {
     stack.clear();
-    variables.clear();
+    variables.assign(bytecode.getFrameSize(), 0);
     output.clear();
     programCounter = 0;
     halted = false;
+    executedInstructions = 0;
+    outputBytes = 0;
+    outOfFuel = memoryFuel > 0 && memoryInUse() > memoryFuel;
     
     const auto& instructions = bytecode.getInstructions();
+    instructionCounts.assign(profiling ? instructions.size() : 0, 0);
+    jumpCounts.assign(profiling ? instructions.size() : 0, 0);
     
-    while (programCounter < instructions.size() && !halted) {
+    while (programCounter < instructions.size() && !halted && !outOfFuel) {
+        if (instructionFuel > 0 && executedInstructions >= instructionFuel) {
+            outOfFuel = true;
+            break;
+        }
         const Instruction& instr = instructions[programCounter];
+        executedInstructions++;
+        if (profiling) {
+            instructionCounts[programCounter]++;
+        }
         
         switch (instr.opcode) {
             case OpCode::PUSH:
@@ -52,10 +69,15 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
                 break;
             }
                 
+            case OpCode::DUP:
+                push(peek());
+                programCounter++;
+                break;
+                
             case OpCode::ADD: {
                 int right = pop();
                 int left = pop();
-                push(left + right);
+                push(BinaryOps::add(left, right));
                 programCounter++;
                 break;
             }
@@ -63,7 +85,7 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
             case OpCode::SUB: {
                 int right = pop();
                 int left = pop();
-                push(left - right);
+                push(BinaryOps::sub(left, right));
                 programCounter++;
                 break;
             }
@@ -71,7 +93,7 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
             case OpCode::MUL: {
                 int right = pop();
                 int left = pop();
-                push(left * right);
+                push(BinaryOps::mul(left, right));
                 programCounter++;
                 break;
             }
@@ -82,7 +104,7 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
                 if (right == 0) {
                     throw std::runtime_error("Division by zero");
                 }
-                push(left / right);
+                push(BinaryOps::div(left, right));
                 programCounter++;
                 break;
             }
@@ -90,7 +112,7 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
             case OpCode::GT: {
                 int right = pop();
                 int left = pop();
-                push(left > right ? 1 : 0);
+                push(BinaryOps::gt(left, right));
                 programCounter++;
                 break;
             }
@@ -98,7 +120,7 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
             case OpCode::LT: {
                 int right = pop();
                 int left = pop();
-                push(left < right ? 1 : 0);
+                push(BinaryOps::lt(left, right));
                 programCounter++;
                 break;
             }
@@ -106,11 +128,37 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
             case OpCode::EQ: {
                 int right = pop();
                 int left = pop();
-                push(left == right ? 1 : 0);
+                push(BinaryOps::eq(left, right));
                 programCounter++;
                 break;
             }
                 
+            case OpCode::NEG:
+                push(BinaryOps::neg(pop()));
+                programCounter++;
+                break;
+                
+            case OpCode::SHL:
+                push(BinaryOps::shl(pop(), instr.operand));
+                programCounter++;
+                break;
+                
+            case OpCode::SHR:
+                push(BinaryOps::shr(pop(), instr.operand));
+                programCounter++;
+                break;
+                
+            case OpCode::MULI:
+                push(BinaryOps::mul(pop(), instr.operand));
+                programCounter++;
+                break;
+                
+            case OpCode::DIVI:
+                // The code generator only emits DIVI for non-zero divisors
+                push(divideByMagic(pop(), instr.operand, instr.magic));
+                programCounter++;
+                break;
+                
             case OpCode::JMP:
                 programCounter = instr.operand;
                 break;
@@ -118,6 +166,22 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
             case OpCode::JMP_IF_FALSE: {
                 int condition = pop();
                 if (condition == 0) {
+                    if (profiling) {
+                        jumpCounts[programCounter]++;
+                    }
+                    programCounter = instr.operand;
+                } else {
+                    programCounter++;
+                }
+                break;
+            }
+                
+            case OpCode::JMP_IF_TRUE: {
+                int condition = pop();
+                if (condition != 0) {
+                    if (profiling) {
+                        jumpCounts[programCounter]++;
+                    }
                     programCounter = instr.operand;
                 } else {
                     programCounter++;
@@ -130,6 +194,10 @@ void VirtualMachine::execute(const Bytecode& bytecode) {
                 std::ostringstream oss;
                 oss << value;
                 output.push_back(oss.str());
+                outputBytes += output.back().size() + 1;
+                // The stack only grows within one expression, so the
+                // output is the only part that can keep growing
+                outOfFuel = memoryFuel > 0 && memoryInUse() > memoryFuel;
                 programCounter++;
                 break;
             }
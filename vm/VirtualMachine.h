@@ -3,27 +3,63 @@
 
 #include <vector>
 #include <string>
-#include <map>
 #include "../codegen/Bytecode.h"
+#include "../ast/BinaryOp.h"
 
 class VirtualMachine {
 private:
     std::vector<int> stack;
-    std::map<int, int> variables; // variable index -> value
+    std::vector<int> variables; // frame slot -> value
     std::vector<std::string> output;
     int programCounter;
     bool halted;
+    long long executedInstructions;
+    
+    // Limits of a run; 0 means unlimited
+    long long instructionFuel;
+    size_t memoryFuel;
+    size_t outputBytes;
+    bool outOfFuel;
+    
+    // Per instruction of a profiled run: how often it ran and, for
+    // conditional jumps, how often it jumped
+    bool profiling;
+    std::vector<long long> instructionCounts;
+    std::vector<long long> jumpCounts;
     
     void push(int value);
     int pop();
     int peek();
+    size_t memoryInUse() const;
     
 public:
-    VirtualMachine() : programCounter(0), halted(false) {}
+    VirtualMachine()
+        : programCounter(0), halted(false), executedInstructions(0),
+          instructionFuel(0), memoryFuel(0), outputBytes(0), outOfFuel(false),
+          profiling(false) {}
+    
+    // Makes execute() stop early once it has run the given number of
+    // instructions, or once the frame, the stack and the printed output
+    // together take more than the given number of bytes
+    void setFuel(long long instructions, size_t memoryBytes) {
+        instructionFuel = instructions;
+        memoryFuel = memoryBytes;
+    }
+    
+    // Makes execute() count instructions and jumps for a Profile
+    void setProfiling(bool enabled) { profiling = enabled; }
     
     void execute(const Bytecode& bytecode);
     const std::vector<std::string>& getOutput() const { return output; }
     
+    // Dynamic instruction count of the last execute()
+    long long getExecutedInstructions() const { return executedInstructions; }
+    // Whether the last execute() stopped because of setFuel's limits
+    bool ranOutOfFuel() const { return outOfFuel; }
+    // Counts of the last profiled execute(), indexed by address
+    const std::vector<long long>& getInstructionCounts() const { return instructionCounts; }
+    const std::vector<long long>& getJumpCounts() const { return jumpCounts; }
+    
     std::string getOutputString() const;
 };
 
@@ -10,6 +10,10 @@ document.querySelectorAll('.tab-btn').forEach(btn => {
         // Add active class to clicked tab and corresponding panel
         btn.classList.add('active');
         document.getElementById(tabId).classList.add('active');
+        
+        if (syntaxStale && syntaxShown()) {
+            fetchSyntax();
+        }
     });
 });
 
@@ -32,42 +36,143 @@ document.getElementById('examples').addEventListener('change', async (e) => {
     }
 });
 
-// Compile button
-document.getElementById('compileBtn').addEventListener('click', async () => {
-    const sourceCode = document.getElementById('sourceCode').value;
-    
-    if (!sourceCode.trim()) {
-        alert('Please enter some code first!');
-        return;
+// Incremental compilation: the server keeps the tokens and AST of the last
+// source this page sent, so later requests only carry the edited range
+const sessionId = Math.random().toString(36).slice(2) + Date.now().toString(36);
+let lastSentSource = null;
+
+// Tokens and AST cover the whole source, so they are only requested while
+// their tab is shown, and fetched for the last compile when it is opened
+let syntaxStale = false;
+
+function syntaxShown() {
+    const tab = document.querySelector('.tab-btn.active').dataset.tab;
+    return tab === 'tokens' || tab === 'ast';
+}
+
+function showSyntax(result) {
+    // result.tokens is already an array and result.ast an object from JSON.parse
+    if (result.tokens) {
+        const tokens = Array.isArray(result.tokens) ? result.tokens : JSON.parse(result.tokens);
+        let tokensHtml = '';
+        tokens.forEach((token, idx) => {
+            tokensHtml += `Token ${idx + 1}: ${token.type.padEnd(15)} | "${token.lexeme}"${token.lexeme ? ' '.repeat(Math.max(1, 10 - token.lexeme.length)) : '          '} | Line ${token.line}, Col ${token.column}\n`;
+        });
+        document.getElementById('tokensOutput').textContent = tokensHtml;
     }
     
+    if (result.ast) {
+        const ast = typeof result.ast === 'object' ? result.ast : JSON.parse(result.ast);
+        document.getElementById('astOutput').textContent = JSON.stringify(ast, null, 2);
+    }
+}
+
+async function fetchSyntax() {
     try {
         const response = await fetch('/compile', {
             method: 'POST',
             headers: {
                 'Content-Type': 'application/x-www-form-urlencoded',
             },
-            body: 'source=' + encodeURIComponent(sourceCode)
+            body: 'session=' + encodeURIComponent(sessionId) + '&view=syntax'
         });
-        
-        const responseText = await response.text();
-        const result = JSON.parse(responseText);
-        
-        // Display tokens (result.tokens is already an array from JSON.parse)
-        if (result.tokens) {
-            const tokens = Array.isArray(result.tokens) ? result.tokens : JSON.parse(result.tokens);
-            let tokensHtml = '';
-            tokens.forEach((token, idx) => {
-                tokensHtml += `Token ${idx + 1}: ${token.type.padEnd(15)} | "${token.lexeme}"${token.lexeme ? ' '.repeat(Math.max(1, 10 - token.lexeme.length)) : '          '} | Line ${token.line}, Col ${token.column}\n`;
-            });
-            document.getElementById('tokensOutput').textContent = tokensHtml;
+        if (response.ok) {
+            showSyntax(await response.json());
+            syntaxStale = false;
         }
+    } catch (error) {
+        console.error('Error loading tokens and AST:', error);
+    }
+}
+
+// Offsets are sent in UTF-8 bytes, as the server sees the source
+function utf8Length(text) {
+    return new TextEncoder().encode(text).length;
+}
+
+function isHighSurrogate(code) {
+    return code >= 0xD800 && code <= 0xDBFF;
+}
+
+function isLowSurrogate(code) {
+    return code >= 0xDC00 && code <= 0xDFFF;
+}
+
+function buildCompileBody(sourceCode) {
+    const session = 'session=' + encodeURIComponent(sessionId) +
+        '&opt=' + document.getElementById('optLevel').value +
+        '&syntax=' + (syntaxShown() ? 1 : 0);
+    if (lastSentSource === null) {
+        return session + '&source=' + encodeURIComponent(sourceCode);
+    }
+    
+    // The edit is everything between the common prefix and common suffix
+    const oldSource = lastSentSource;
+    const shorter = Math.min(oldSource.length, sourceCode.length);
+    let prefix = 0;
+    while (prefix < shorter && oldSource[prefix] === sourceCode[prefix]) {
+        prefix++;
+    }
+    // The strings are compared in UTF-16 code units; neither end of the
+    // edit may split a surrogate pair, which has no UTF-8 encoding
+    if (prefix > 0 && isHighSurrogate(oldSource.charCodeAt(prefix - 1))) {
+        prefix--;
+    }
+    let suffix = 0;
+    while (suffix < shorter - prefix &&
+           oldSource[oldSource.length - 1 - suffix] === sourceCode[sourceCode.length - 1 - suffix]) {
+        suffix++;
+    }
+    if (suffix > 0 && isLowSurrogate(oldSource.charCodeAt(oldSource.length - suffix))) {
+        suffix--;
+    }
+    
+    const removed = oldSource.slice(prefix, oldSource.length - suffix);
+    const inserted = sourceCode.slice(prefix, sourceCode.length - suffix);
+    return session +
+        '&offset=' + utf8Length(oldSource.slice(0, prefix)) +
+        '&removed=' + utf8Length(removed) +
+        '&inserted=' + encodeURIComponent(inserted) +
+        '&length=' + utf8Length(sourceCode);
+}
+
+async function postCompile(sourceCode) {
+    const send = () => fetch('/compile', {
+        method: 'POST',
+        headers: {
+            'Content-Type': 'application/x-www-form-urlencoded',
+        },
+        body: buildCompileBody(sourceCode)
+    });
+    
+    let response = await send();
+    if (response.status === 409) {
+        // The server does not know this session (e.g. it restarted)
+        lastSentSource = null;
+        response = await send();
+    }
+    
+    const responseText = await response.text();
+    lastSentSource = sourceCode;
+    const result = JSON.parse(responseText);
+    syntaxStale = result.tokens === undefined;
+    return result;
+}
+
+// Compile button
+document.getElementById('compileBtn').addEventListener('click', async () => {
+    const sourceCode = document.getElementById('sourceCode').value;
+    
+    if (!sourceCode.trim()) {
+        alert('Please enter some code first!');
+        return;
+    }
+    
+    try {
+        const result = await postCompile(sourceCode);
         
-        // Display AST (result.ast is already an object from JSON.parse)
-        if (result.ast) {
-            const ast = typeof result.ast === 'object' ? result.ast : JSON.parse(result.ast);
-            document.getElementById('astOutput').textContent = JSON.stringify(ast, null, 2);
-        }
+        // Display tokens and AST, if their tab is shown
+        showSyntax(result);
         
         // Display semantic analysis
         if (result.semantic) {
@@ -124,31 +229,10 @@ document.getElementById('runBtn').addEventListener('click', async () => {
     }
     
     try {
-        const response = await fetch('/compile', {
-            method: 'POST',
-            headers: {
-                'Content-Type': 'application/x-www-form-urlencoded',
-            },
-            body: 'source=' + encodeURIComponent(sourceCode)
-        });
+        const result = await postCompile(sourceCode);
         
-        const responseText = await response.text();
-        const result = JSON.parse(responseText);
-        
-        // Display all stages (result.tokens, result.ast, result.bytecode are already parsed)
-        if (result.tokens) {
-            const tokens = Array.isArray(result.tokens) ? result.tokens : JSON.parse(result.tokens);
-            let tokensHtml = '';
-            tokens.forEach((token, idx) => {
-                tokensHtml += `Token ${idx + 1}: ${token.type.padEnd(15)} | "${token.lexeme}"${token.lexeme ? ' '.repeat(Math.max(1, 10 - token.lexeme.length)) : '          '} | Line ${token.line}, Col ${token.column}\n`;
-            });
-            document.getElementById('tokensOutput').textContent = tokensHtml;
-        }
-        
-        if (result.ast) {
-            const ast = typeof result.ast === 'object' ? result.ast : JSON.parse(result.ast);
-            document.getElementById('astOutput').textContent = JSON.stringify(ast, null, 2);
-        }
+        // Display all stages (result.bytecode is already parsed)
+        showSyntax(result);
         
         if (result.semantic) {
             document.getElementById('semanticOutput').textContent = result.semantic;